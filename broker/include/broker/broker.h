@@ -13,6 +13,7 @@ extern "C" {
 
 #include <dslink/storage/storage.h>
 #include <dslink/socket.h>
+#include <dslink/timer_wheel.h>
 
 #include <broker/extension.h>
 
@@ -43,6 +44,9 @@ typedef struct Broker {
 
     uv_timer_t *saveDataHandler;
 
+    // Drives the coarse per-link timers, like pings and handshake deadlines
+    DSLinkTimerWheel timerWheel;
+
     List extensions;
 
     struct ExtensionConfig extensionConfig;
@@ -12,6 +12,15 @@ json_t *broker_config_get();
 extern uint8_t broker_enable_token;
 extern size_t broker_max_qos_queue_size;
 extern size_t broker_max_ws_send_queue_size;
+extern size_t broker_max_ws_queued_bytes;
+extern long broker_ack_delay;
+extern size_t broker_qos_log_segment_size;
+extern size_t broker_max_qos_log_size;
+extern long broker_qos_log_sync_interval;
+extern size_t broker_max_qos_spill_size;
+extern size_t broker_max_sub_batch_size;
+extern size_t broker_resync_budget;
+extern char *broker_storage_path;
 
 int broker_config_load(json_t *json);
 int broker_change_default_permissions(json_t* json);
@@ -20,8 +20,6 @@ int broker_handshake_handle_ws(Broker *broker,
 
 DownstreamNode *broker_init_downstream_node(BrokerNode *parentNode, const char *name);
 
-void dslink_handle_ping(uv_timer_t* handle);
-
 #ifdef __cplusplus
 }
 #endif
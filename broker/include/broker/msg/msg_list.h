@@ -32,6 +32,9 @@ void broker_list_dslink_response(RemoteDSLink *link,
 
 void broker_stream_list_disconnect(BrokerListStream *stream);
 void broker_stream_list_connect(BrokerListStream *stream, DownstreamNode *node);
+// Lists the streams again in one message after the responder reconnected
+void broker_stream_list_connect_all(BrokerListStream **streams, size_t count,
+                                    DownstreamNode *node);
 
 #ifdef __cplusplus
 }
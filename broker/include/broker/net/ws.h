@@ -11,8 +11,16 @@ extern "C" {
 
 void broker_ws_send_init(Socket *sock, const char *accept);
 uint32_t broker_ws_send_obj(RemoteDSLink *link, json_t *obj);
+// Sends an object serialized already, members is its content without the
+// braces. The msg id and the pending ack are added like broker_ws_send_obj
+// does, messages is counted as the output throughput.
+uint32_t broker_ws_send_members(RemoteDSLink *link, const char *members,
+                                size_t len, int messages);
 uint32_t broker_ws_send_obj_link_id(struct Broker* broker, const char *link_name, int upstream, json_t *obj);
 int broker_ws_send(RemoteDSLink *link, const char *data);
+// Acks the received message msg. Acks are cumulative, only the last msg id
+// is sent after broker_ack_delay, or piggybacked on the next message.
+void broker_ws_send_ack(RemoteDSLink *link, uint32_t msg);
 int broker_ws_generate_accept_key(const char *buf, size_t bufLen,
                                   char *out, size_t outLen);
 int broker_count_json_msg(json_t *json);
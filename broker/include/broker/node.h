@@ -8,6 +8,8 @@ extern "C" {
 #include "broker/remote_dslink.h"
 
 #include <dslink/col/vector.h>
+#include <dslink/col/list.h>
+#include <dslink/col/ringbuffer.h>
 
 struct RemoteDSLink;
 struct BrokerNode;
@@ -60,6 +62,20 @@ typedef struct VirtualDownstreamNode {
     json_t *meta;
 } VirtualDownstreamNode;
 
+// Streams of a reconnected responder which aren't re-established yet,
+// broker_resync_budget of them are sent per loop iteration
+typedef struct StreamResync {
+    // Vector<char *> of list stream paths
+    Vector listPaths;
+    uint32_t listPos;
+    // Vector<uint32_t> of sub stream sids
+    Vector subSids;
+    uint32_t subPos;
+    uint64_t start;
+    // Runs a step per loop iteration, I/O is polled in between
+    uv_idle_t *idle;
+} StreamResync;
+
 typedef struct DownstreamNode {
     BROKER_NODE_FIELDS;
 
@@ -95,7 +111,14 @@ typedef struct DownstreamNode {
     Dispatcher on_link_connected;
     Dispatcher on_link_disconnected;
 
-    Vector* pendingAcks;
+    // Ringbuffer<PendingAck> of the sent subscription updates in the order
+    // of their msg ids
+    Ringbuffer* pendingAcks;
+
+    // List<SubRequester *> holding a conflated value, oldest first
+    List dirtySubs;
+
+    StreamResync *resync;
 } DownstreamNode;
 
 BrokerNode *broker_node_get(BrokerNode *root,
@@ -115,6 +138,8 @@ uint32_t broker_node_incr_rid(DownstreamNode *node);
 uint32_t broker_node_incr_sid(DownstreamNode *node);
 
 void broker_dslink_disconnect(DownstreamNode *node);
+// Drops the streams not re-established yet after a reconnect
+void broker_stop_resync(DownstreamNode *node);
 void broker_dslink_connect(DownstreamNode *node, struct RemoteDSLink *link);
 
 // add a timer to save downstream nodes
@@ -0,0 +1,104 @@
+#ifndef BROKER_QOS_LOG_H
+#define BROKER_QOS_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <jansson.h>
+#include <uv.h>
+
+#include <dslink/col/list.h>
+
+// Append-only log of the values queued for a QoS 3 subscription. Values are
+// appended as records "<seq> <json>\n" to segment files named by the seq of
+// their first record, a new segment is started once the current one reaches
+// broker_qos_log_segment_size. Appends are fsynced in batches by a timer,
+// segments are deleted once the requester acked all of their records.
+//
+// Opening a log recovers it from its directory, a partly written record at
+// the end is cut off. The seq of the first record not acked yet is kept in
+// the file "head", so only records acked since its last write are sent
+// again after a restart.
+
+typedef struct QosLogSegment {
+    uint64_t first;
+    uint64_t size;
+} QosLogSegment;
+
+typedef struct QosLog {
+    char *dir;
+
+    // Oldest first, the last one is open for appends
+    QosLogSegment *segments;
+    uint32_t segmentCount;
+    uint32_t segmentCapacity;
+    uv_file fd;
+
+    // First seq not acked yet and seq of the next appended record
+    uint64_t head;
+    uint64_t next;
+    // Bytes of all segments, the oldest are dropped beyond maxBytes
+    uint64_t bytes;
+    uint64_t maxBytes;
+    // Nothing is fsynced, for logs which don't outlive the process like
+    // the spills deleted at startup
+    uint8_t noSync;
+
+    // Position of the next record to read
+    uint64_t readSeq;
+    uint32_t readSegment;
+    uint64_t readOffset;
+
+    // Appended since the last fsync, the fsync in flight if any
+    uint8_t dirty;
+    struct QosLogSync *sync;
+    uint8_t closing;
+
+    // In the list of open logs, see broker_qos_log_shutdown
+    ListNode logsNode;
+} QosLog;
+
+// Opens or recovers the log in dir, the directories are created if needed.
+// Its cap is broker_max_qos_log_size.
+QosLog *broker_qos_log_open(const char *dir);
+// Closes the log, its files are deleted if remove is set.
+void broker_qos_log_close(QosLog *log, uint8_t remove);
+
+int broker_qos_log_append(QosLog *log, json_t *varray);
+
+// Appends up to max records following the read position to the array out
+// and returns their count, lastSeq is set to the seq of the last one.
+size_t broker_qos_log_read(QosLog *log, json_t *out, size_t max, uint64_t *lastSeq);
+// Moves the read position behind the record appended last if it was the
+// only one not read yet, so it can be sent without reading it back.
+uint8_t broker_qos_log_read_appended(QosLog *log);
+// Reads the records not acked yet again, e.g. after a reconnect.
+void broker_qos_log_rewind(QosLog *log);
+
+// All records up to seq were acked, fully acked segments are deleted.
+void broker_qos_log_ack(QosLog *log, uint64_t seq);
+
+static inline
+uint64_t broker_qos_log_size(QosLog *log) {
+    return log->next - log->head;
+}
+
+static inline
+uint64_t broker_qos_log_unread(QosLog *log) {
+    return log->next - log->readSeq;
+}
+
+// Deletes dir with the logs below it.
+void broker_qos_log_remove_dir(const char *dir);
+
+// Syncs and closes the files of all open logs, they are kept on disk when
+// the logs are closed afterwards.
+void broker_qos_log_shutdown();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BROKER_QOS_LOG_H
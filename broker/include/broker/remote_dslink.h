@@ -13,6 +13,7 @@ extern "C" {
 #include <dslink/col/map.h>
 #include <dslink/col/listener.h>
 #include <dslink/socket.h>
+#include <dslink/timer_wheel.h>
 
 #include "broker/net/server.h"
 #include "broker/permission/permission.h"
@@ -22,6 +23,8 @@ typedef struct RemoteAuth {
     char salt[48];
     mbedtls_ecdh_context tempKey;
     const char *pubKey;
+    // Key of the link in client_connecting
+    char *dsId;
 
 } RemoteAuth;
 
@@ -34,7 +37,23 @@ typedef struct RemoteDSLink {
     uint32_t msgId;
 
     struct timeval *lastWriteTime;
-    uv_timer_t *pingTimerHandle;
+    // Heartbeat timers on the timer wheel of the broker, pings are only
+    // sent if nothing else was written within the ping interval.
+    DSLinkTimer pingTimer;
+    DSLinkTimer idleTimer;
+    // Called when nothing was received within the idle timeout
+    void (*onIdleTimeout)(struct RemoteDSLink *link);
+    // Deadline of the web socket handshake while the link is connecting
+    DSLinkTimer handshakeTimer;
+    // Highest received msg id that wasn't acked yet, 0 if none.
+    // See broker_ws_send_ack
+    uint32_t pendingAck;
+    uv_timer_t *ackTimerHandle;
+    // Subscribe paths and unsubscribe sids for the responder collected
+    // within a loop iteration, see send_subscribe_request
+    json_t *pendingSubs;
+    json_t *pendingUnsubs;
+    uv_timer_t *subRequestTimerHandle;
     struct timeval *lastReceiveTime;
 
     wslay_event_context_ptr ws;
@@ -66,6 +85,10 @@ typedef struct RemoteDSLink {
 int broker_remote_dslink_init(RemoteDSLink *link);
 void broker_remote_dslink_free(RemoteDSLink *link);
 
+// Starts the ping and idle timers of a connected link.
+void broker_remote_dslink_start_timers(RemoteDSLink *link,
+                                       void (*onIdleTimeout)(RemoteDSLink *link));
+
 #ifdef __cplusplus
 }
 #endif
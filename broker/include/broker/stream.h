@@ -12,6 +12,7 @@ extern "C" {
 #include "broker/remote_dslink.h"
 
 struct BrokerNode;
+struct SubValue;
 
 typedef void (*continuous_invoke_cb)(RemoteDSLink *link, json_t *params);
 typedef void (*invoke_close_cb)(void *stream);
@@ -70,7 +71,8 @@ typedef struct BrokerSubStream {
 
     char *remote_path;
 
-    json_t *last_value;
+    // Shared with the queues of the subscriptions
+    struct SubValue *last_value;
     json_t *last_pending_responder_msg_id;
 
     // Map<DownstreamNode *, SubRequester *>
@@ -0,0 +1,44 @@
+#ifndef BROKER_SUB_VALUE_H
+#define BROKER_SUB_VALUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <jansson.h>
+
+// A value update of a sub stream, [sid, value, ts, ...] as received from the
+// responder. Records are immutable and shared by reference between the last
+// value of the stream and the queues of all of its subscriptions. The part
+// following the sid is serialized once, when the value is sent first, and
+// the update of every requester is built from these bytes.
+typedef struct SubValue {
+    json_t *varray;
+    // ",<value>,<ts>...]", NULL until it was sent
+    char *data;
+    size_t len;
+    uint32_t refs;
+} SubValue;
+
+// Creates a record with a reference count of 1, it takes a reference to
+// varray which may not be changed afterwards.
+SubValue *broker_sub_value_create(json_t *varray);
+
+static inline
+SubValue *broker_sub_value_ref(SubValue *value) {
+    ++value->refs;
+    return value;
+}
+
+void broker_sub_value_unref(SubValue *value);
+
+// Returns the serialized value, NULL if it couldn't be allocated.
+const char *broker_sub_value_data(SubValue *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BROKER_SUB_VALUE_H
@@ -7,10 +7,24 @@ extern "C" {
 
 #include <broker/stream.h>
 #include <broker/node.h>
+#include <broker/sub_value.h>
 
 #include <dslink/col/vector.h>
 #include <dslink/col/ringbuffer.h>
 
+// Optional filter of a subscribe request, see broker_sub_filter_parse
+typedef struct SubFilter {
+    // Numeric values which moved by no more than deadband since the last
+    // value passed are dropped, deadband is in percent of that value if
+    // deadbandPercent is set
+    double deadband;
+    uint8_t deadbandPercent;
+    // Values equal to the last value passed are dropped
+    uint8_t onChange;
+    // Values are sampled, the latest one goes out once per interval ms if
+    // it passes the deadband and onChange filters then
+    uint32_t interval;
+} SubFilter;
 
 typedef struct SubRequester {
     char *path;
@@ -18,31 +32,70 @@ typedef struct SubRequester {
     BrokerSubStream *stream;
     uint32_t reqSid;
     uint8_t qos;
-    json_t *qosQueue;
+    // QoS 3 only: the values not acked yet are kept on disk, qosBatches
+    // holds the messages sent from it which wait for their ack
+    struct QosLog *qosLog;
+    Ringbuffer *qosBatches;
     char *qosKey1;
     char *qosKey2;
     // pending list node
     ListNode *pendingNode;
     Ringbuffer* messageQueue;
     uint32_t messageOutputQueueCount;
+    // QoS 2 only: values queued while messageQueue is full, they move into
+    // it in order as the requester acks
+    struct QosLog *spill;
+    // QoS 0 and 1 only: the latest value that couldn't be sent yet because
+    // the requester is behind, newer values replace it. While set the
+    // subscription is linked into dirtySubs of the requester node.
+    SubValue *pendingValue;
+    ListNode dirtyNode;
+    // Shared with the pending acks of the messages sent for it
+    struct SubAckRef *ackRef;
+    // Updates of the stream are checked against the value sent or queued
+    // last before they are queued
+    SubFilter filter;
+    SubValue *lastValue;
+    // The latest value passed while sampling, it's sent on the next tick of
+    // the timer shared by the subscriptions of the same interval
+    SubValue *sampledValue;
+    ListNode sampleNode;
 } SubRequester;
 
+// Outlives a subscription freed while acks are pending, sub is NULL then and
+// the acks are dropped once they arrive.
+typedef struct SubAckRef {
+    SubRequester *sub;
+    uint32_t refs;
+} SubAckRef;
 
 typedef struct PendingAck {
-    SubRequester* subscription;
+    SubAckRef* subscription;
     uint32_t msg_id;
 } PendingAck;
 
+// Values of a QoS 3 log sent in one message, up to last_seq
+typedef struct QosBatch {
+    uint32_t msg_id;
+    uint64_t last_seq;
+} QosBatch;
+
 typedef struct QueuedMessage {
-    json_t* message;
+    SubValue *value;
     uint32_t msg_id;
 } QueuedMessage;
 
 
+// Subscribe and unsubscribe requests to a responder are collected and sent
+// as one request each at the end of the loop iteration, or once
+// broker_max_sub_batch_size paths are pending.
 void send_subscribe_request(DownstreamNode *node,
                             const char *path,
                             uint32_t sid,
                             uint8_t qos);
+void send_unsubscribe_request(DownstreamNode *node, uint32_t sid);
+void broker_flush_sub_requests(RemoteDSLink *link);
+void broker_clear_sub_requests(RemoteDSLink *link);
 
 
 SubRequester *broker_create_sub_requester(DownstreamNode * node, const char *path, uint32_t reqSid, uint8_t qos, json_t *qosQueue);
@@ -51,10 +104,24 @@ void broker_clear_messsage_ids(SubRequester *req);
 
 uint32_t sendQueuedMessages(SubRequester *subReq);
 
-void clear_qos_queue(SubRequester *subReq, uint8_t serialize);
+// Sends the conflated values of the requester once its socket took the
+// queued data.
+void broker_send_dirty_subs(struct RemoteDSLink *link);
 
+// Sends the values of the QoS 3 log which weren't sent yet as far as the
+// ack window of the subscription allows.
 void broker_update_sub_req_qos(SubRequester *subReq);
 int broker_update_sub_req(SubRequester *subReq, json_t *varray);
+// Queues or sends a value shared with other subscriptions
+int broker_update_sub_req_value(SubRequester *subReq, SubValue *value);
+
+// Reads the filter of a path of a subscribe request:
+// "deadband": number, "deadbandType": "absolute" or "percent",
+// "onChange": true and "minInterval": ms. A filter without these keys
+// passes every value right away.
+void broker_sub_filter_parse(SubFilter *filter, json_t *sub);
+// Whether an update of the stream goes out to the subscription
+uint8_t broker_sub_filter_pass(SubRequester *subReq, SubValue *value);
 
 int broker_update_sub_stream(BrokerSubStream *stream, json_t *array, json_t *responder_msg_id);
 int broker_update_sub_stream_value(BrokerSubStream *stream, json_t *value, json_t *ts, json_t *responder_msg_id);
@@ -64,6 +131,10 @@ void broker_update_sub_qos(SubRequester *req, uint8_t qos);
 void serialize_qos_queue(SubRequester *subReq, uint8_t deleteFlag);
 
 int check_subscription_ack(RemoteDSLink *link, uint32_t ack);
+// Drops the pending acks of a requester, e.g. when it disconnected
+void broker_clear_pending_acks(DownstreamNode *node);
+// Deletes the spilled queues left by a previous run
+void broker_clear_qos_spill();
 
 #ifdef __cplusplus
 }
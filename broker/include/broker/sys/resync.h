@@ -0,0 +1,24 @@
+#ifndef BROKER_RESYNC_H
+#define BROKER_RESYNC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+struct BrokerNode;
+
+// Progress of re-establishing the streams of reconnected responders,
+// see broker_dslink_connect
+int init_resync(struct BrokerNode *sysNode);
+
+void resync_add_pending(int64_t streams);
+void resync_add_done(uint64_t streams);
+void resync_finished(uint64_t ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BROKER_RESYNC_H
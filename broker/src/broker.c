@@ -10,6 +10,8 @@
 #include "broker/config.h"
 #include "broker/data/data.h"
 #include "broker/sys/sys.h"
+#include "broker/qos_log.h"
+#include "broker/subscription.h"
 
 #define LOG_TAG "broker"
 #include <dslink/log.h>
@@ -298,6 +300,8 @@ void broker_close_link(RemoteDSLink *link) {
 
 static
 void broker_free(Broker *broker) {
+    // the QoS 3 logs stay on disk for the next start
+    broker_qos_log_shutdown();
     if (broker->storage) {
         dslink_storage_destroy(broker->storage);
     }
@@ -408,6 +412,8 @@ int broker_init(Broker *broker, json_t *defaultPermission) {
     listener_add(&broker->downstream->on_child_added, extension_on_child_added, broker);
 
     broker_load_downstream_nodes(broker);
+    // QoS 2 queues don't outlive the broker
+    broker_clear_qos_spill();
     broker_load_qos_storage(broker);
 
     if (broker_sys_node_populate(broker->sys)) {
@@ -475,6 +481,8 @@ void broker_stop(Broker* broker) {
     }
     dslink_free((void*)broker->extensionConfig.brokerUrl);
     dslink_list_free_all_nodes(&broker->extensions);
+
+    dslink_timer_wheel_close(&broker->timerWheel, NULL);
 }
 
 int broker_init_extensions(Broker* broker, json_t* config) {
@@ -613,6 +621,7 @@ int broker_start() {
     mainLoop = dslink_calloc(1, sizeof(uv_loop_t));
     uv_loop_init(mainLoop);
     mainLoop->data = &broker;
+    dslink_timer_wheel_init(&broker.timerWheel, mainLoop, 1000);
 
     json_t *defaultPermission = json_object_get(config, "defaultPermission");
 
@@ -65,6 +65,11 @@ json_t *broker_config_gen() {
     json_object_set_new_nocheck(broker_config, "allowAllLinks", json_true());
     json_object_set_new_nocheck(broker_config, "maxQueue", json_integer(1024));
     json_object_set_new_nocheck(broker_config, "maxSendQueue", json_integer(8));
+    json_object_set_new_nocheck(broker_config, "maxSendQueueBytes", json_integer(1048576));
+    json_object_set_new_nocheck(broker_config, "maxQosLogSize", json_integer(67108864));
+    json_object_set_new_nocheck(broker_config, "maxQosSpillSize", json_integer(268435456));
+    json_object_set_new_nocheck(broker_config, "maxSubscribeBatch", json_integer(1000));
+    json_object_set_new_nocheck(broker_config, "resyncBudget", json_integer(1000));
     json_object_set_new_nocheck(broker_config, "defaultPermission", json_null());
 
     json_t *storage = json_object();
@@ -127,6 +132,27 @@ json_t *broker_config_get() {
 uint8_t broker_enable_token = 1;
 size_t broker_max_qos_queue_size = 1024;
 size_t broker_max_ws_send_queue_size = 8;
+// Bytes queued in the web socket of a requester above which the values of
+// QoS 0 and 1 subscriptions are conflated until the socket took them.
+size_t broker_max_ws_queued_bytes = 1048576;
+// Delay of acks in ms, 0 acks once per loop iteration and a negative
+// value acks every message right away.
+long broker_ack_delay = 0;
+// Size of a segment of the on-disk queue of a QoS 3 subscription.
+size_t broker_qos_log_segment_size = 1048576;
+// Bytes kept on disk for a QoS 3 subscription, the oldest values are
+// dropped beyond it.
+size_t broker_max_qos_log_size = 67108864;
+// Interval of the fsyncs of the QoS 3 queues in ms, 0 syncs every append.
+long broker_qos_log_sync_interval = 1000;
+// Bytes a QoS 2 queue spills to disk once maxQueue values are in memory.
+size_t broker_max_qos_spill_size = 268435456;
+// Paths of a subscribe or unsubscribe request the broker sends to a
+// responder, the pending ones are sent at the end of the loop iteration.
+size_t broker_max_sub_batch_size = 1000;
+// Streams of a reconnected responder listed or subscribed again per loop
+// iteration.
+size_t broker_resync_budget = 1000;
 char *broker_storage_path = ".";
 
 int broker_change_default_permissions(json_t* json) {
@@ -177,6 +203,17 @@ int broker_config_load(json_t* json) {
       }
     }
 
+    {
+      // load max queued bytes of the send queue
+      json_t* maxSendQueueBytes = json_object_get(json, "maxSendQueueBytes");
+      if (json_is_integer(maxSendQueueBytes)) {
+        broker_max_ws_queued_bytes = (size_t)json_integer_value(maxSendQueueBytes);
+        if (broker_max_ws_queued_bytes < 65536) {
+	  broker_max_ws_queued_bytes = 65536;
+        }
+      }
+    }
+
     {
       // load maxQueue
       json_t* maxQueue = json_object_get(json, "maxQueue");
@@ -194,6 +231,65 @@ int broker_config_load(json_t* json) {
       }
     }
 
+    {
+      // load the limits of the QoS 3 queues on disk
+      json_t* segmentSize = json_object_get(json, "qosLogSegmentSize");
+      if (json_is_integer(segmentSize)) {
+        broker_qos_log_segment_size = (size_t)json_integer_value(segmentSize);
+        if (broker_qos_log_segment_size < 4096) {
+	  broker_qos_log_segment_size = 4096;
+        }
+      }
+      json_t* maxLogSize = json_object_get(json, "maxQosLogSize");
+      if (json_is_integer(maxLogSize)) {
+        broker_max_qos_log_size = (size_t)json_integer_value(maxLogSize);
+        if (broker_max_qos_log_size < 2 * broker_qos_log_segment_size) {
+	  broker_max_qos_log_size = 2 * broker_qos_log_segment_size;
+        }
+      }
+      json_t* maxSpillSize = json_object_get(json, "maxQosSpillSize");
+      if (json_is_integer(maxSpillSize)) {
+        broker_max_qos_spill_size = (size_t)json_integer_value(maxSpillSize);
+        if (broker_max_qos_spill_size < 2 * broker_qos_log_segment_size) {
+	  broker_max_qos_spill_size = 2 * broker_qos_log_segment_size;
+        }
+      }
+      json_t* syncInterval = json_object_get(json, "qosLogSyncInterval");
+      if (json_is_integer(syncInterval)) {
+        broker_qos_log_sync_interval = (long)json_integer_value(syncInterval);
+        if (broker_qos_log_sync_interval < 0) {
+	  broker_qos_log_sync_interval = 0;
+        }
+      }
+    }
+
+    {
+      json_t* maxSubscribeBatch = json_object_get(json, "maxSubscribeBatch");
+      if (json_is_integer(maxSubscribeBatch)) {
+        broker_max_sub_batch_size = (size_t)json_integer_value(maxSubscribeBatch);
+        if (broker_max_sub_batch_size < 1) {
+	  broker_max_sub_batch_size = 1;
+        }
+      }
+    }
+
+    {
+      json_t* resyncBudget = json_object_get(json, "resyncBudget");
+      if (json_is_integer(resyncBudget)) {
+        broker_resync_budget = (size_t)json_integer_value(resyncBudget);
+        if (broker_resync_budget < 1) {
+	  broker_resync_budget = 1;
+        }
+      }
+    }
+
+    {
+      json_t* ackDelay = json_object_get(json, "ackDelay");
+      if (json_is_integer(ackDelay)) {
+        broker_ack_delay = (long)json_integer_value(ackDelay);
+      }
+    }
+
     json_t *storage = json_object_get(json, "storage");
 
     if (json_is_object(storage)) {
@@ -18,6 +18,21 @@
 #include "broker/msg/msg_list.h"
 #include "broker/handshake.h"
 
+// Time a link has to open the web socket after the http handshake
+#define BROKER_HANDSHAKE_TIMEOUT 60000
+
+static
+void broker_handshake_expired(DSLinkTimer *timer) {
+    RemoteDSLink *link = timer->data;
+    Broker *broker = link->broker;
+    log_info("DSLink `%s` didn't open the web socket in time\n", link->name);
+
+    dslink_map_remove(&broker->client_connecting, link->auth->dsId);
+    dslink_map_remove(&broker->client_connecting, (void *) link->name);
+    broker_remote_dslink_free(link);
+    dslink_free(link);
+}
+
 static
 int generate_salt(unsigned char *salt, size_t len) {
     unsigned char buf[32];
@@ -65,7 +80,7 @@ json_t *broker_handshake_handle_conn(Broker *broker,
     }
 
     link->broker = broker;
-    link->auth = dslink_malloc(sizeof(RemoteAuth));
+    link->auth = dslink_calloc(1, sizeof(RemoteAuth));
     if (!link->auth) {
         goto fail;
     }
@@ -239,6 +254,13 @@ json_t *broker_handshake_handle_conn(Broker *broker,
         }
     }
 
+    link->auth->dsId = dslink_strdup(dsId);
+    if (link->auth->dsId) {
+        dslink_timer_init(&link->handshakeTimer, broker_handshake_expired, link);
+        dslink_timer_start(&broker->timerWheel, &link->handshakeTimer,
+                           BROKER_HANDSHAKE_TIMEOUT, 0);
+    }
+
     return resp;
 fail:
     if (link) {
@@ -250,29 +272,9 @@ fail:
     return NULL;
 }
 
-void dslink_handle_ping(uv_timer_t* handle) {
-    RemoteDSLink *link = handle->data;
-    if (link->lastWriteTime) {
-        struct timeval current_time;
-        gettimeofday(&current_time, NULL);
-        long time_diff = current_time.tv_sec - link->lastWriteTime->tv_sec;
-        if (time_diff >= 60) {
-            log_debug("dslink_handle_ping send heartbeat to %s\n", link->name );
-            broker_ws_send_obj(link, json_object());
-        }
-    } else {
-        broker_ws_send_obj(link, json_object());
-    }
-
-    if (link->lastReceiveTime) {
-        struct timeval current_time;
-        gettimeofday(&current_time, NULL);
-        long time_diff = current_time.tv_sec - link->lastReceiveTime->tv_sec;
-        if (time_diff >= 90) {
-            log_debug("dslink_handle_ping: Disconnecting %s due to missing receive\n", link->name );
-            broker_close_link(link);
-        }
-    }
+static
+void broker_handshake_idle_timeout(RemoteDSLink *link) {
+    broker_close_link(link);
 }
 
 int broker_handshake_handle_ws(Broker *broker,
@@ -289,6 +291,7 @@ int broker_handshake_handle_ws(Broker *broker,
     }
     RemoteDSLink *link = ref->data;
     dslink_decref(ref);
+    dslink_timer_stop(&link->handshakeTimer);
     if (link->name) {
         dslink_map_remove(&broker->client_connecting,
                           (char *) link->name);
@@ -297,7 +300,6 @@ int broker_handshake_handle_ws(Broker *broker,
         return 1;
     }
 
-    uv_timer_t *ping_timer = NULL;
     int ret = 0;
     { // Perform auth check
         char expectedAuth[90];
@@ -373,11 +375,7 @@ int broker_handshake_handle_ws(Broker *broker,
     link->ws = ws;
     broker_ws_send_init(client->sock, wsAccept);
 
-    ping_timer = dslink_malloc(sizeof(uv_timer_t));
-    ping_timer->data = link;
-    uv_timer_init(link->client->poll->loop, ping_timer);
-    uv_timer_start(ping_timer, dslink_handle_ping, 1000, 10000);
-    link->pingTimerHandle = ping_timer;
+    broker_remote_dslink_start_timers(link, broker_handshake_idle_timeout);
 
     // set the ->link and update all existing stream
     broker_dslink_connect(node, link);
@@ -393,18 +391,17 @@ int broker_handshake_handle_ws(Broker *broker,
 exit:
     mbedtls_ecdh_free(&link->auth->tempKey);
     dslink_free((void *) link->auth->pubKey);
+    dslink_free(link->auth->dsId);
     dslink_free(link->auth);
     link->auth = NULL;
     if (ret != 0) {
+        dslink_timer_stop(&link->pingTimer);
+        dslink_timer_stop(&link->idleTimer);
+
         dslink_map_free(&link->requester_streams);
         dslink_map_free(&link->responder_streams);
         dslink_free((char *)link->path);
         dslink_free(link);
-
-        if (ping_timer) {
-            uv_timer_stop(ping_timer);
-            uv_close((uv_handle_t *) ping_timer, broker_free_handle);
-        }
     }
 
     return ret;
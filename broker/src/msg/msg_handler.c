@@ -210,12 +210,7 @@ void broker_msg_handle(RemoteDSLink *link,
     }
 
     if (sendAckOk) {
-        json_t *obj = json_object();
-        if (obj) {
-            json_object_set_nocheck(obj, "ack", msg);
-            broker_ws_send_obj(link, obj);
-            json_decref(obj);
-        }
+        broker_ws_send_ack(link, (uint32_t) json_integer_value(msg));
     }
 
     json_decref(data);
@@ -20,6 +20,20 @@ BrokerListStream *init_remote_list_stream(DownstreamNode *node, const char *path
     return stream;
 }
 
+static
+json_t *create_list_request(DownstreamNode *node, const char *path,
+                            uint32_t *rid) {
+    json_t *req = json_object();
+    json_object_set_new_nocheck(req, "method", json_string_nocheck("list"));
+    json_object_set_new_nocheck(req, "path", json_string_nocheck(path));
+
+    *rid = broker_node_incr_rid(node);
+
+    json_object_set_new_nocheck(req, "rid",
+                                json_integer(*rid));
+    return req;
+}
+
 static
 void send_list_request(BrokerListStream *stream,
                        DownstreamNode *node,
@@ -31,15 +45,8 @@ void send_list_request(BrokerListStream *stream,
     json_t *reqs = json_array();
     json_object_set_new_nocheck(top, "requests", reqs);
 
-    json_t *req = json_object();
-    json_array_append_new(reqs, req);
-    json_object_set_new_nocheck(req, "method", json_string_nocheck("list"));
-    json_object_set_new_nocheck(req, "path", json_string_nocheck(path));
-
-    uint32_t rid = broker_node_incr_rid(node);
-
-    json_object_set_new_nocheck(req, "rid",
-                                json_integer(rid));
+    uint32_t rid;
+    json_array_append_new(reqs, create_list_request(node, path, &rid));
 
     broker_ws_send_obj(node->link, top);
     json_decref(top);
@@ -206,3 +213,25 @@ void broker_stream_list_disconnect(BrokerListStream *stream) {
 void broker_stream_list_connect(BrokerListStream *stream, DownstreamNode *node) {
     send_list_request(stream, node, NULL, stream->remote_path, 0);
 }
+
+void broker_stream_list_connect_all(BrokerListStream **streams, size_t count,
+                                    DownstreamNode *node) {
+    if (count == 0) {
+        return;
+    }
+    json_t *top = json_object();
+    json_t *reqs = json_array();
+    json_object_set_new_nocheck(top, "requests", reqs);
+
+    for (size_t i = 0; i < count; ++i) {
+        BrokerListStream *stream = streams[i];
+        uint32_t rid;
+        json_array_append_new(reqs, create_list_request(node, stream->remote_path, &rid));
+        stream->responder_rid = rid;
+        dslink_map_set(&node->link->responder_streams, dslink_int_ref(rid),
+                       dslink_ref(stream, NULL));
+    }
+
+    broker_ws_send_obj(node->link, top);
+    json_decref(top);
+}
@@ -9,6 +9,7 @@
 #include "broker/net/ws.h"
 #include "broker/broker.h"
 #include "broker/msg/msg_subscribe.h"
+#include "broker/qos_log.h"
 
 void broker_handle_local_subscribe(BrokerNode *respNode,
                                    SubRequester *subreq) {
@@ -27,7 +28,7 @@ void broker_handle_local_subscribe(BrokerNode *respNode,
     subreq->stream = respNode->sub_stream;
     dslink_map_set(&respNode->sub_stream->reqSubs, dslink_ref(reqNode, NULL), dslink_ref(subreq, NULL));
     if (respNode->sub_stream->last_value) {
-        broker_update_sub_req(subreq, respNode->sub_stream->last_value);
+        broker_update_sub_req_value(subreq, respNode->sub_stream->last_value);
     }
 }
 
@@ -58,7 +59,7 @@ void broker_subscribe_remote(DownstreamNode *respNode, SubRequester *subreq,
 
     broker_update_stream_qos(bss);
     if (bss->last_value) {
-        broker_update_sub_req(subreq, bss->last_value);
+        broker_update_sub_req_value(subreq, bss->last_value);
     }
 }
 
@@ -173,14 +174,18 @@ void handle_subscribe(RemoteDSLink *link, json_t *sub) {
         qos = (uint8_t) json_integer_value(jQos);
     }
 
+    SubFilter filter;
+    broker_sub_filter_parse(&filter, sub);
+
     // TODO check if sid or path already exist
 
     ref_t *idsub = dslink_map_get(&reqNode->req_sub_sids, &sid);
     ref_t *pathsub = dslink_map_get(&reqNode->req_sub_paths, (void*)path);
 
     if (idsub && pathsub && idsub->data == pathsub->data) {
-        // update qos only
+        // update qos and filter only
         SubRequester *reqsub = idsub->data;
+        reqsub->filter = filter;
         broker_update_sub_qos(reqsub, qos);
         return;
     }
@@ -199,19 +204,21 @@ void handle_subscribe(RemoteDSLink *link, json_t *sub) {
         }
         reqsub->reqSid = sid;
         dslink_map_set(&reqNode->req_sub_sids, dslink_int_ref(sid), dslink_ref(reqsub, NULL));
+        reqsub->filter = filter;
         broker_update_sub_qos(reqsub, qos);
-        if (json_array_size(reqsub->qosQueue) > 0) {
+        if (reqsub->qosLog && broker_qos_log_unread(reqsub->qosLog) > 0) {
             // send qos data
             broker_update_sub_req_qos(reqsub);
         } else if (reqsub->qos == 2) {
   	    sendQueuedMessages( reqsub);
 	} else if (reqsub->stream && reqsub->stream->last_value) {
-            broker_update_sub_req(reqsub, reqsub->stream->last_value);
+            broker_update_sub_req_value(reqsub, reqsub->stream->last_value);
         }
         return;
     }
 
     SubRequester *subreq = broker_create_sub_requester(reqNode, path, sid, qos, NULL);
+    subreq->filter = filter;
     if (qos > 2) {
         serialize_qos_queue(subreq, 0);
     }
@@ -6,30 +6,11 @@
 #include "broker/msg/msg_unsubscribe.h"
 
 void broker_msg_send_unsubscribe(BrokerSubStream *bss, RemoteDSLink *link) {
+    (void) link;
     if (!((DownstreamNode*)bss->respNode)->link) {
         return;
     }
-    json_t *top = json_object();
-    json_t *reqs = json_array();
-    json_object_set_new_nocheck(top, "requests", reqs);
-
-    json_t *req = json_object();
-    json_array_append_new(reqs, req);
-    json_object_set_new_nocheck(req, "method",
-                                json_string_nocheck("unsubscribe"));
-
-    uint32_t rid = broker_node_incr_rid(link->node);
-    json_object_set_new_nocheck(req, "rid",
-                                json_integer(rid));
-
-    {
-        json_t *sids = json_array();
-        json_array_append_new(sids, json_integer(bss->respSid));
-        json_object_set_new_nocheck(req, "sids", sids);
-    }
-
-    broker_ws_send_obj(((DownstreamNode*)bss->respNode)->link, top);
-    json_decref(top);
+    send_unsubscribe_request((DownstreamNode*)bss->respNode, bss->respSid);
 }
 
 static
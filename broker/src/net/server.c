@@ -10,6 +10,7 @@
 
 #include "broker/utils.h"
 #include "broker/broker.h"
+#include "broker/subscription.h"
 
 #include "mbedtls/error.h"
 #include "mbedtls/debug.h"
@@ -89,6 +90,9 @@ void broker_server_client_ready(uv_poll_t *poll,
                         broker_close_link(link);
                         client = NULL;
                     }
+                    if (client) {
+                        broker_send_dirty_subs(link);
+                    }
                 }
             }
         }
@@ -141,6 +145,9 @@ void broker_ssl_server_client_ready(uv_poll_t *poll,
                     broker_close_link(link);
                     client = NULL;
                 }
+                if (client) {
+                    broker_send_dirty_subs(link);
+                }
             }
         }
     }
@@ -12,6 +12,7 @@
 #include "broker/remote_dslink.h"
 #include "broker/net/ws.h"
 #include "broker/net/server.h"
+#include "broker/config.h"
 
 #include <dslink/utils.h>
 
@@ -69,14 +70,30 @@ uint32_t broker_ws_send_obj_link_id(struct Broker* broker, const char *link_name
     return -1;
 }
 
-uint32_t broker_ws_send_obj(RemoteDSLink *link, json_t *obj) {
+static
+uint32_t broker_ws_next_msg_id(RemoteDSLink *link) {
     uint32_t id = ++link->msgId;
     if(link->msgId == 2147483647) {
         link->msgId = 0;
     }
+    return id;
+}
+
+uint32_t broker_ws_send_obj(RemoteDSLink *link, json_t *obj) {
+    uint32_t id = broker_ws_next_msg_id(link);
     json_object_set_new_nocheck(obj, "msg", json_integer(id));
+    // piggyback the pending ack
+    uint8_t ack = 0;
+    if (link->pendingAck && !json_object_get(obj, "ack")) {
+        json_object_set_new_nocheck(obj, "ack", json_integer(link->pendingAck));
+        link->pendingAck = 0;
+        ack = 1;
+    }
     char *data = json_dumps(obj, JSON_PRESERVE_ORDER | JSON_COMPACT);
     json_object_del(obj, "msg");
+    if (ack) {
+        json_object_del(obj, "ack");
+    }
 
     if (!data) {
         return DSLINK_ALLOC_ERR;
@@ -90,6 +107,75 @@ uint32_t broker_ws_send_obj(RemoteDSLink *link, json_t *obj) {
     return id;
 }
 
+uint32_t broker_ws_send_members(RemoteDSLink *link, const char *members,
+                                size_t len, int messages) {
+    // {<members>,"msg":<id>,"ack":<ack>}
+    size_t size = len + 48;
+    char *data = dslink_malloc(size);
+    if (!data) {
+        return DSLINK_ALLOC_ERR;
+    }
+    uint32_t id = broker_ws_next_msg_id(link);
+    data[0] = '{';
+    memcpy(data + 1, members, len);
+    size_t pos = len + 1;
+    pos += snprintf(data + pos, size - pos, ",\"msg\":%u", id);
+    if (link->pendingAck) {
+        pos += snprintf(data + pos, size - pos, ",\"ack\":%u", link->pendingAck);
+        link->pendingAck = 0;
+    }
+    snprintf(data + pos, size - pos, "}");
+
+    int sentBytes = broker_ws_send(link, data);
+    if (throughput_output_needed()) {
+        throughput_add_output(sentBytes, messages);
+    }
+    dslink_free(data);
+    return id;
+}
+
+static
+void broker_ws_flush_ack(RemoteDSLink *link) {
+    if (!link->pendingAck) {
+        return;
+    }
+    // the ack is added by broker_ws_send_obj
+    json_t *obj = json_object();
+    if (obj) {
+        broker_ws_send_obj(link, obj);
+        json_decref(obj);
+    }
+}
+
+static
+void broker_ws_ack_timer(uv_timer_t *timer) {
+    broker_ws_flush_ack(timer->data);
+}
+
+void broker_ws_send_ack(RemoteDSLink *link, uint32_t msg) {
+    uint8_t armed = link->pendingAck != 0;
+    link->pendingAck = msg;
+
+    if (broker_ack_delay < 0) {
+        broker_ws_flush_ack(link);
+        return;
+    }
+
+    if (!link->ackTimerHandle) {
+        link->ackTimerHandle = dslink_malloc(sizeof(uv_timer_t));
+        if (!link->ackTimerHandle) {
+            broker_ws_flush_ack(link);
+            return;
+        }
+        uv_timer_init(mainLoop, link->ackTimerHandle);
+        link->ackTimerHandle->data = link;
+    }
+    if (!armed) {
+        uv_timer_start(link->ackTimerHandle, broker_ws_ack_timer,
+                       (uint64_t) broker_ack_delay, 0);
+    }
+}
+
 int broker_ws_send(RemoteDSLink *link, const char *data) {
     if (!link->ws || !link->client) {
         return -1;
@@ -9,12 +9,19 @@
 #include <dslink/utils.h>
 #include <broker/upstream/upstream_handshake.h>
 #include <broker/subscription.h>
+#include <broker/config.h>
+#include <broker/utils.h>
+#include <broker/sys/resync.h>
 
 #include "broker/broker.h"
 #include "broker/msg/msg_subscribe.h"
 #include "broker/stream.h"
 #include "broker/msg/msg_list.h"
 
+#define LOG_TAG "node"
+#include <dslink/log.h>
+#include <inttypes.h>
+
 BrokerNode *broker_node_get(BrokerNode *root,
                             const char *path, char **out) {
     uint8_t strippedLeadingSlash = 0;
@@ -187,6 +194,7 @@ DownstreamNode *broker_init_downstream_node(BrokerNode *parentNode, const char *
     }
     node->parent = parentNode;
     node->pendingAcks = NULL;
+    list_init(&node->dirtySubs);
     broker_node_update_child(parentNode, name);
 
     return node;
@@ -281,8 +289,8 @@ void broker_node_free(BrokerNode *node) {
         dslink_map_free(&dnode->resp_sub_streams);
         listener_remove_all(&dnode->on_link_connected);
         listener_remove_all(&dnode->on_link_disconnected);
-        vector_free(dnode->pendingAcks);
-        dslink_free(dnode->pendingAcks);
+        broker_clear_pending_acks(dnode);
+        broker_stop_resync(dnode);
     } else {
         // TODO: add a new type for these listeners
         // they shouldn't be part of base node type
@@ -337,7 +345,137 @@ void broker_node_update_value(BrokerNode *node, json_t *value, uint8_t isNewValu
     listener_dispatch_message(&node->on_value_update, node);
 }
 
+void broker_stop_resync(DownstreamNode *node) {
+    StreamResync *resync = node->resync;
+    if (!resync) {
+        return;
+    }
+    resync_add_pending(-(int64_t) (vector_count(&resync->listPaths) - resync->listPos
+                                   + vector_count(&resync->subSids) - resync->subPos));
+    dslink_vector_foreach(&resync->listPaths) {
+        dslink_free(*(char **) data);
+    }
+    dslink_vector_foreach_end();
+    vector_free(&resync->listPaths);
+    vector_free(&resync->subSids);
+    if (resync->idle) {
+        uv_idle_stop(resync->idle);
+        uv_close((uv_handle_t *) resync->idle, broker_free_handle);
+    }
+    dslink_free(resync);
+    node->resync = NULL;
+}
+
+// Sends list and subscribe requests for up to broker_resync_budget streams
+// of the snapshot, streams closed or reopened meanwhile are skipped
+static
+void broker_resync_step(uv_idle_t *idle) {
+    DownstreamNode *dsn = idle->data;
+    StreamResync *resync = dsn->resync;
+    size_t budget = broker_resync_budget;
+    uint32_t listPos = resync->listPos;
+    uint32_t subPos = resync->subPos;
+
+    uint32_t listCount = vector_count(&resync->listPaths);
+    if (resync->listPos < listCount) {
+        size_t count = 0;
+        BrokerListStream **streams = dslink_malloc(budget * sizeof(BrokerListStream *));
+        if (!streams) {
+            log_warn("Failed to batch the list requests of %s\n", dsn->path);
+        }
+        while (count < budget && resync->listPos < listCount) {
+            char *path = *(char **) vector_get(&resync->listPaths, resync->listPos++);
+            ref_t *ref = dslink_map_get(&dsn->list_streams, path);
+            if (!ref) {
+                continue;
+            }
+            // reopened meanwhile, it was requested on this connection already
+            BrokerListStream *stream = ref->data;
+            ref_t *live = dslink_map_get(&dsn->link->responder_streams,
+                                         &stream->responder_rid);
+            if (live && live->data == stream) {
+                continue;
+            }
+            if (streams) {
+                streams[count] = stream;
+            } else {
+                // a request each, the resync still moves on
+                broker_stream_list_connect(stream, dsn);
+            }
+            ++count;
+        }
+        if (streams) {
+            broker_stream_list_connect_all(streams, count, dsn);
+            dslink_free(streams);
+        }
+        budget -= count;
+    }
+
+    uint32_t subCount = vector_count(&resync->subSids);
+    size_t sent = 0;
+    while (sent < budget && resync->subPos < subCount) {
+        uint32_t sid = *(uint32_t *) vector_get(&resync->subSids, resync->subPos++);
+        ref_t *ref = dslink_map_get(&dsn->resp_sub_sids, &sid);
+        if (ref) {
+            BrokerSubStream *stream = ref->data;
+            send_subscribe_request(dsn, stream->remote_path, stream->respSid, stream->respQos);
+            ++sent;
+        }
+    }
+    broker_flush_sub_requests(dsn->link);
+    resync_add_done(resync->listPos - listPos + resync->subPos - subPos);
+
+    if (resync->listPos < listCount || resync->subPos < subCount) {
+        uv_idle_start(resync->idle, broker_resync_step);
+        return;
+    }
+    uint64_t ms = uv_now(mainLoop) - resync->start;
+    log_info("Re-established %u streams of %s in %" PRIu64 " ms\n",
+             listCount + subCount, dsn->path, ms);
+    resync_finished(ms);
+    broker_stop_resync(dsn);
+}
+
+// Takes a snapshot of the streams to re-establish, the requests are spread
+// over the following loop iterations
+static
+void broker_start_resync(DownstreamNode *dsn) {
+    broker_stop_resync(dsn);
+    if (dsn->list_streams.size == 0 && dsn->resp_sub_streams.size == 0) {
+        return;
+    }
+    StreamResync *resync = dslink_calloc(1, sizeof(StreamResync));
+    if (!resync) {
+        return;
+    }
+    vector_init(&resync->listPaths, dsn->list_streams.size + 1, sizeof(char *));
+    vector_init(&resync->subSids, dsn->resp_sub_streams.size + 1, sizeof(uint32_t));
+    dslink_map_foreach(&dsn->list_streams) {
+        BrokerListStream *stream = entry->value->data;
+        char *path = dslink_strdup(stream->remote_path);
+        vector_append(&resync->listPaths, &path);
+    }
+    dslink_map_foreach(&dsn->resp_sub_streams) {
+        BrokerSubStream *stream = entry->value->data;
+        vector_append(&resync->subSids, &stream->respSid);
+    }
+    resync->start = uv_now(mainLoop);
+    resync->idle = dslink_malloc(sizeof(uv_idle_t));
+    if (!resync->idle) {
+        dslink_free(resync);
+        return;
+    }
+    uv_idle_init(mainLoop, resync->idle);
+    resync->idle->data = dsn;
+    dsn->resync = resync;
+    resync_add_pending(vector_count(&resync->listPaths) + vector_count(&resync->subSids));
+
+    // the first batch goes out right away
+    broker_resync_step(resync->idle);
+}
+
 void broker_dslink_disconnect(DownstreamNode *node) {
+    broker_stop_resync(node);
     dslink_map_foreach(&node->list_streams) {
         BrokerListStream *stream = entry->value->data;
         broker_stream_list_disconnect(stream);
@@ -353,15 +491,7 @@ void broker_dslink_disconnect(DownstreamNode *node) {
 void broker_dslink_connect(DownstreamNode *dsn, RemoteDSLink *link) {
     dsn->link = link;
     json_object_del(dsn->meta, "$disconnectedTs");
-    dslink_map_foreach(&dsn->list_streams) {
-        BrokerListStream *stream = entry->value->data;
-        broker_stream_list_connect(stream, dsn);
-    }
-
-    dslink_map_foreach(&dsn->resp_sub_streams) {
-        BrokerSubStream *stream = entry->value->data;
-        send_subscribe_request(dsn, stream->remote_path, stream->respSid, stream->respQos);
-    }
+    broker_start_resync(dsn);
 
     ref_t *ref = dslink_map_remove_get(&link->broker->remote_pending_sub,
                                        (char *) dsn->path);
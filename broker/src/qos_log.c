@@ -0,0 +1,846 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fcntl.h>
+
+#define LOG_TAG "qos_log"
+#include <dslink/log.h>
+#include <dslink/err.h>
+#include <dslink/mem/mem.h>
+#include <dslink/utils.h>
+
+#include "broker/qos_log.h"
+#include "broker/config.h"
+#include "broker/broker.h"
+#include "broker/utils.h"
+
+#define QOS_LOG_SUFFIX ".log"
+#define QOS_LOG_SEQ_DIGITS 20
+#define QOS_LOG_READ_SIZE 65536
+
+typedef struct QosLogSync {
+    uv_fs_t req;
+    QosLog *log;
+    uv_file fd;
+} QosLogSync;
+
+// Reads the records of a segment line by line
+typedef struct QosLogReader {
+    uv_file fd;
+    // file offset of buf[0]
+    uint64_t offset;
+    char *buf;
+    size_t len;
+    size_t pos;
+    size_t cap;
+    uint8_t eof;
+} QosLogReader;
+
+static List openLogs;
+static uint8_t openLogsInit = 0;
+static uv_timer_t *syncTimer = NULL;
+static uint8_t logsShutdown = 0;
+
+static
+char *qos_log_path(QosLog *log, const char *name) {
+    size_t size = strlen(log->dir) + strlen(name) + 2;
+    char *path = dslink_malloc(size);
+    if (path) {
+        snprintf(path, size, "%s/%s", log->dir, name);
+    }
+    return path;
+}
+
+static
+char *segment_path(QosLog *log, uint64_t first) {
+    char name[QOS_LOG_SEQ_DIGITS + sizeof(QOS_LOG_SUFFIX)];
+    snprintf(name, sizeof(name), "%020" PRIu64 QOS_LOG_SUFFIX, first);
+    return qos_log_path(log, name);
+}
+
+static
+int fs_open(const char *path, int flags) {
+    uv_fs_t req;
+    int fd = uv_fs_open(NULL, &req, path, flags, 0660, NULL);
+    uv_fs_req_cleanup(&req);
+    return fd;
+}
+
+static
+void fs_close(uv_file fd) {
+    uv_fs_t req;
+    uv_fs_close(NULL, &req, fd, NULL);
+    uv_fs_req_cleanup(&req);
+}
+
+static
+void fs_fsync(uv_file fd) {
+    uv_fs_t req;
+    uv_fs_fsync(NULL, &req, fd, NULL);
+    uv_fs_req_cleanup(&req);
+}
+
+static
+void fs_unlink(const char *path) {
+    uv_fs_t req;
+    uv_fs_unlink(NULL, &req, path, NULL);
+    uv_fs_req_cleanup(&req);
+}
+
+static
+int fs_write(uv_file fd, const char *data, size_t len, int64_t offset) {
+    while (len > 0) {
+        uv_fs_t req;
+        uv_buf_t buf = uv_buf_init((char *) data, (unsigned int) len);
+        int written = uv_fs_write(NULL, &req, fd, &buf, 1, offset, NULL);
+        uv_fs_req_cleanup(&req);
+        if (written <= 0) {
+            return written < 0 ? written : DSLINK_CANNOT_WRITE_FILE;
+        }
+        data += written;
+        len -= (size_t) written;
+        if (offset >= 0) {
+            offset += written;
+        }
+    }
+    return 0;
+}
+
+// Creates dir and the missing parent directories
+static
+int mkdirs(const char *dir) {
+    char *path = dslink_strdup(dir);
+    if (!path) {
+        return DSLINK_ALLOC_ERR;
+    }
+    int ret = 0;
+    for (char *p = path + 1; ; ++p) {
+        if (*p != '/' && *p != '\0') {
+            continue;
+        }
+        char c = *p;
+        *p = '\0';
+        uv_fs_t req;
+        ret = uv_fs_mkdir(NULL, &req, path, 0770, NULL);
+        uv_fs_req_cleanup(&req);
+        if (ret == UV_EEXIST) {
+            ret = 0;
+        }
+        *p = c;
+        if (c == '\0') {
+            break;
+        }
+    }
+    dslink_free(path);
+    return ret;
+}
+
+static
+int reader_init(QosLogReader *r, QosLog *log, uint64_t first, uint64_t offset, int flags) {
+    memset(r, 0, sizeof(QosLogReader));
+    char *path = segment_path(log, first);
+    if (!path) {
+        return DSLINK_ALLOC_ERR;
+    }
+    r->fd = fs_open(path, flags);
+    dslink_free(path);
+    if (r->fd < 0) {
+        return r->fd;
+    }
+    r->offset = offset;
+    r->cap = QOS_LOG_READ_SIZE;
+    r->buf = dslink_malloc(r->cap);
+    if (!r->buf) {
+        fs_close(r->fd);
+        return DSLINK_ALLOC_ERR;
+    }
+    return 0;
+}
+
+static
+void reader_free(QosLogReader *r) {
+    fs_close(r->fd);
+    dslink_free(r->buf);
+}
+
+// Returns 1 with the next complete line, without its '\n', and 0 once
+// the rest of the file has no '\n'
+static
+int reader_next(QosLogReader *r, const char **line, size_t *lineLen, uint64_t *lineOffset) {
+    while (1) {
+        char *nl = memchr(r->buf + r->pos, '\n', r->len - r->pos);
+        if (nl) {
+            *line = r->buf + r->pos;
+            *lineLen = (size_t) (nl - *line);
+            *lineOffset = r->offset + r->pos;
+            r->pos = (size_t) (nl - r->buf) + 1;
+            return 1;
+        }
+        if (r->eof) {
+            return 0;
+        }
+
+        size_t rest = r->len - r->pos;
+        memmove(r->buf, r->buf + r->pos, rest);
+        r->offset += r->pos;
+        r->pos = 0;
+        r->len = rest;
+        if (r->len == r->cap) {
+            char *buf = dslink_realloc(r->buf, r->cap * 2);
+            if (!buf) {
+                return DSLINK_ALLOC_ERR;
+            }
+            r->buf = buf;
+            r->cap *= 2;
+        }
+
+        uv_fs_t req;
+        uv_buf_t buf = uv_buf_init(r->buf + r->len, (unsigned int) (r->cap - r->len));
+        int read = uv_fs_read(NULL, &req, r->fd, &buf, 1, (int64_t) (r->offset + r->len), NULL);
+        uv_fs_req_cleanup(&req);
+        if (read < 0) {
+            return read;
+        }
+        if (read == 0) {
+            r->eof = 1;
+        }
+        r->len += (size_t) read;
+    }
+}
+
+// Splits a line "<seq> <json>"
+static
+int parse_record(const char *line, size_t len, uint64_t *seq, const char **json, size_t *jsonLen) {
+    size_t i = 0;
+    uint64_t value = 0;
+    while (i < len && line[i] >= '0' && line[i] <= '9') {
+        value = value * 10 + (uint64_t) (line[i] - '0');
+        ++i;
+    }
+    if (i == 0 || i >= len || line[i] != ' ') {
+        return 1;
+    }
+    *seq = value;
+    *json = line + i + 1;
+    *jsonLen = len - i - 1;
+    return 0;
+}
+
+static
+int cmp_segment(const void *lhs, const void *rhs) {
+    uint64_t l = ((QosLogSegment *) lhs)->first;
+    uint64_t r = ((QosLogSegment *) rhs)->first;
+    return l == r ? 0 : (l > r ? 1 : -1);
+}
+
+static
+int add_segment(QosLog *log, uint64_t first, uint64_t size) {
+    if (log->segmentCount == log->segmentCapacity) {
+        uint32_t capacity = log->segmentCapacity ? log->segmentCapacity * 2 : 4;
+        QosLogSegment *segments = dslink_realloc(log->segments,
+                                                 capacity * sizeof(QosLogSegment));
+        if (!segments) {
+            return DSLINK_ALLOC_ERR;
+        }
+        log->segments = segments;
+        log->segmentCapacity = capacity;
+    }
+    log->segments[log->segmentCount].first = first;
+    log->segments[log->segmentCount].size = size;
+    log->segmentCount++;
+    log->bytes += size;
+    return 0;
+}
+
+// Closes the file of the last segment, an fsync in flight closes it later
+static
+void close_tail(QosLog *log) {
+    if (log->fd < 0) {
+        return;
+    }
+    if (!log->sync || log->sync->fd != log->fd) {
+        fs_close(log->fd);
+    }
+    log->fd = -1;
+}
+
+// Deletes the first count segments
+static
+void remove_segments(QosLog *log, uint32_t count) {
+    if (count == 0) {
+        return;
+    }
+    if (count == log->segmentCount) {
+        close_tail(log);
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        char *path = segment_path(log, log->segments[i].first);
+        if (path) {
+            fs_unlink(path);
+            dslink_free(path);
+        }
+        log->bytes -= log->segments[i].size;
+    }
+    log->segmentCount -= count;
+    memmove(log->segments, log->segments + count,
+            log->segmentCount * sizeof(QosLogSegment));
+
+    if (log->readSegment >= count) {
+        log->readSegment -= count;
+    } else {
+        log->readSegment = 0;
+        log->readOffset = 0;
+    }
+    if (log->readSeq < log->head) {
+        log->readSeq = log->head;
+    }
+}
+
+static
+void write_head(QosLog *log) {
+    char *path = qos_log_path(log, "head");
+    if (!path) {
+        return;
+    }
+    if (log->segmentCount == 0) {
+        fs_unlink(path);
+    } else {
+        uv_file fd = fs_open(path, O_WRONLY | O_CREAT | O_TRUNC);
+        if (fd >= 0) {
+            char buf[32];
+            int len = snprintf(buf, sizeof(buf), "%" PRIu64 "\n", log->head);
+            fs_write(fd, buf, (size_t) len, 0);
+            fs_close(fd);
+        }
+    }
+    dslink_free(path);
+}
+
+static
+uint64_t read_head(QosLog *log) {
+    char *path = qos_log_path(log, "head");
+    if (!path) {
+        return 0;
+    }
+    uint64_t head = 0;
+    uv_file fd = fs_open(path, O_RDONLY);
+    dslink_free(path);
+    if (fd >= 0) {
+        char buf[32];
+        uv_fs_t req;
+        uv_buf_t b = uv_buf_init(buf, sizeof(buf) - 1);
+        int len = uv_fs_read(NULL, &req, fd, &b, 1, 0, NULL);
+        uv_fs_req_cleanup(&req);
+        fs_close(fd);
+        if (len > 0) {
+            buf[len] = '\0';
+            head = strtoull(buf, NULL, 10);
+        }
+    }
+    return head;
+}
+
+// Finds the last complete record of the last segment, a partly written one
+// is cut off and segments without records are deleted.
+static
+int recover_tail(QosLog *log, uint64_t *lastSeq) {
+    while (log->segmentCount > 0) {
+        QosLogSegment *seg = &log->segments[log->segmentCount - 1];
+        QosLogReader r;
+        int ret = reader_init(&r, log, seg->first, 0, O_RDWR);
+        if (ret != 0) {
+            return ret;
+        }
+
+        uint64_t valid = 0;
+        uint8_t found = 0;
+        const char *line;
+        size_t lineLen;
+        uint64_t lineOffset;
+        while ((ret = reader_next(&r, &line, &lineLen, &lineOffset)) == 1) {
+            uint64_t seq;
+            const char *json;
+            size_t jsonLen;
+            if (parse_record(line, lineLen, &seq, &json, &jsonLen) != 0) {
+                break;
+            }
+            *lastSeq = seq;
+            found = 1;
+            valid = lineOffset + lineLen + 1;
+        }
+
+        if (ret >= 0 && valid < seg->size) {
+            log_warn("Cutting off %" PRIu64 " bytes of a partly written record in %s\n",
+                     seg->size - valid, log->dir);
+            uv_fs_t req;
+            uv_fs_ftruncate(NULL, &req, r.fd, (int64_t) valid, NULL);
+            uv_fs_req_cleanup(&req);
+            log->bytes -= seg->size - valid;
+            seg->size = valid;
+        }
+        reader_free(&r);
+        if (ret < 0) {
+            return ret;
+        }
+        if (found) {
+            return 0;
+        }
+        // nothing complete in it, the previous segment holds the last record
+        log->segmentCount--;
+        char *path = segment_path(log, seg->first);
+        if (path) {
+            fs_unlink(path);
+            dslink_free(path);
+        }
+    }
+    return 0;
+}
+
+static
+int load_segments(QosLog *log) {
+    uv_fs_t req;
+    uv_dirent_t ent;
+    int ret = uv_fs_scandir(NULL, &req, log->dir, 0, NULL);
+    if (ret < 0) {
+        uv_fs_req_cleanup(&req);
+        return ret;
+    }
+    ret = 0;
+    while (uv_fs_scandir_next(&req, &ent) != UV_EOF) {
+        size_t len = strlen(ent.name);
+        if (len != QOS_LOG_SEQ_DIGITS + strlen(QOS_LOG_SUFFIX)
+            || strcmp(ent.name + QOS_LOG_SEQ_DIGITS, QOS_LOG_SUFFIX) != 0) {
+            continue;
+        }
+        uint64_t first = strtoull(ent.name, NULL, 10);
+
+        uint64_t size = 0;
+        char *path = segment_path(log, first);
+        if (path) {
+            uv_fs_t statReq;
+            if (uv_fs_stat(NULL, &statReq, path, NULL) == 0) {
+                size = statReq.statbuf.st_size;
+            }
+            uv_fs_req_cleanup(&statReq);
+            dslink_free(path);
+        }
+        if ((ret = add_segment(log, first, size)) != 0) {
+            break;
+        }
+    }
+    uv_fs_req_cleanup(&req);
+    if (log->segmentCount > 1) {
+        qsort(log->segments, log->segmentCount, sizeof(QosLogSegment), cmp_segment);
+    }
+    return ret;
+}
+
+static
+int open_tail(QosLog *log, int flags) {
+    char *path = segment_path(log, log->segments[log->segmentCount - 1].first);
+    if (!path) {
+        return DSLINK_ALLOC_ERR;
+    }
+    log->fd = fs_open(path, O_WRONLY | O_APPEND | flags);
+    dslink_free(path);
+    return log->fd < 0 ? log->fd : 0;
+}
+
+QosLog *broker_qos_log_open(const char *dir) {
+    if (mkdirs(dir) != 0) {
+        log_err("Failed to create the QoS queue directory %s\n", dir);
+        return NULL;
+    }
+    QosLog *log = dslink_calloc(1, sizeof(QosLog));
+    if (!log) {
+        return NULL;
+    }
+    log->fd = -1;
+    log->maxBytes = broker_max_qos_log_size;
+    log->dir = dslink_strdup(dir);
+    if (!log->dir) {
+        goto fail;
+    }
+
+    uint64_t lastSeq = 0;
+    if (load_segments(log) != 0 || recover_tail(log, &lastSeq) != 0) {
+        log_err("Failed to recover the QoS queue in %s\n", dir);
+        goto fail;
+    }
+    uint64_t head = read_head(log);
+    if (log->segmentCount > 0) {
+        log->next = lastSeq + 1;
+        if (head < log->segments[0].first) {
+            head = log->segments[0].first;
+        }
+    } else {
+        log->next = head;
+    }
+    if (head > log->next) {
+        head = log->next;
+    }
+    log->head = head;
+    log->readSeq = head;
+
+    // segments which were acked before the head got removed
+    uint32_t acked = 0;
+    while (acked < log->segmentCount
+           && (acked + 1 < log->segmentCount
+               ? log->segments[acked + 1].first <= head
+               : head == log->next)) {
+        ++acked;
+    }
+    remove_segments(log, acked);
+    if (log->segmentCount > 0 && open_tail(log, 0) != 0) {
+        log_err("Failed to open the QoS queue in %s\n", dir);
+        goto fail;
+    }
+    write_head(log);
+
+    if (!openLogsInit) {
+        list_init(&openLogs);
+        openLogsInit = 1;
+    }
+    log->logsNode.value = log;
+    list_insert_node(&openLogs, &log->logsNode);
+    return log;
+
+fail:
+    DSLINK_CHECKED_EXEC(dslink_free, log->segments);
+    DSLINK_CHECKED_EXEC(dslink_free, log->dir);
+    dslink_free(log);
+    return NULL;
+}
+
+static
+void free_log(QosLog *log) {
+    dslink_free(log->segments);
+    dslink_free(log->dir);
+    dslink_free(log);
+}
+
+static
+void sync_done(uv_fs_t *req) {
+    QosLogSync *sync = (QosLogSync *) req;
+    QosLog *log = sync->log;
+    uv_fs_req_cleanup(req);
+
+    log->sync = NULL;
+    if (sync->fd != log->fd) {
+        // the segment was closed meanwhile
+        fs_close(sync->fd);
+    }
+    dslink_free(sync);
+    if (log->closing) {
+        free_log(log);
+    }
+}
+
+static
+void sync_log(QosLog *log) {
+    if (!log->dirty || log->fd < 0 || log->sync) {
+        return;
+    }
+    log->dirty = 0;
+    if (!mainLoop || broker_qos_log_sync_interval <= 0) {
+        fs_fsync(log->fd);
+        return;
+    }
+    QosLogSync *sync = dslink_malloc(sizeof(QosLogSync));
+    if (!sync) {
+        fs_fsync(log->fd);
+        return;
+    }
+    sync->log = log;
+    sync->fd = log->fd;
+    log->sync = sync;
+    if (uv_fs_fsync(mainLoop, &sync->req, sync->fd, sync_done) != 0) {
+        log->sync = NULL;
+        dslink_free(sync);
+        fs_fsync(log->fd);
+    }
+}
+
+static
+void sync_timer_cb(uv_timer_t *timer) {
+    (void) timer;
+    dslink_list_foreach(&openLogs) {
+        sync_log(((ListNode *) node)->value);
+    }
+}
+
+static
+void schedule_sync(QosLog *log) {
+    if (log->noSync) {
+        return;
+    }
+    log->dirty = 1;
+    if (!mainLoop || broker_qos_log_sync_interval <= 0) {
+        sync_log(log);
+        return;
+    }
+    if (!syncTimer) {
+        syncTimer = dslink_malloc(sizeof(uv_timer_t));
+        if (!syncTimer) {
+            sync_log(log);
+            return;
+        }
+        uv_timer_init(mainLoop, syncTimer);
+        uv_timer_start(syncTimer, sync_timer_cb,
+                       (uint64_t) broker_qos_log_sync_interval,
+                       (uint64_t) broker_qos_log_sync_interval);
+    }
+}
+
+// Starts a new segment for the next record
+static
+int rotate(QosLog *log) {
+    if (log->fd >= 0) {
+        if (log->dirty) {
+            // the closed segment is complete on disk
+            fs_fsync(log->fd);
+            log->dirty = 0;
+        }
+        close_tail(log);
+    }
+    int ret = add_segment(log, log->next, 0);
+    if (ret != 0) {
+        return ret;
+    }
+    ret = open_tail(log, O_CREAT | O_TRUNC);
+    if (ret != 0) {
+        log->segmentCount--;
+        return ret;
+    }
+    if (log->segmentCount == 1) {
+        write_head(log);
+    }
+    return 0;
+}
+
+// Drops the oldest segments while the log is larger than its cap
+static
+void enforce_cap(QosLog *log) {
+    uint32_t count = 0;
+    uint64_t bytes = log->bytes;
+    while (bytes > log->maxBytes && count + 1 < log->segmentCount) {
+        bytes -= log->segments[count].size;
+        ++count;
+    }
+    if (count == 0) {
+        return;
+    }
+    uint64_t head = log->segments[count].first;
+    log_warn("QoS queue %s exceeded %" PRIu64 " bytes, dropping %" PRIu64 " values\n",
+             log->dir, log->maxBytes, head - log->head);
+    log->head = head;
+    remove_segments(log, count);
+    write_head(log);
+}
+
+int broker_qos_log_append(QosLog *log, json_t *varray) {
+    if (logsShutdown) {
+        return DSLINK_CANNOT_WRITE_FILE;
+    }
+    if (log->fd < 0 || log->segments[log->segmentCount - 1].size
+                       >= broker_qos_log_segment_size) {
+        int ret = rotate(log);
+        if (ret != 0) {
+            log_err("Failed to start a QoS queue segment in %s\n", log->dir);
+            return ret;
+        }
+    }
+
+    char *json = json_dumps(varray, JSON_PRESERVE_ORDER | JSON_COMPACT);
+    if (!json) {
+        return DSLINK_ALLOC_ERR;
+    }
+    size_t jsonLen = strlen(json);
+    char *record = dslink_malloc(jsonLen + QOS_LOG_SEQ_DIGITS + 3);
+    if (!record) {
+        dslink_free(json);
+        return DSLINK_ALLOC_ERR;
+    }
+    int len = sprintf(record, "%" PRIu64 " ", log->next);
+    memcpy(record + len, json, jsonLen);
+    len += (int) jsonLen;
+    record[len++] = '\n';
+    dslink_free(json);
+
+    int ret = fs_write(log->fd, record, (size_t) len, -1);
+    dslink_free(record);
+    if (ret != 0) {
+        log_err("Failed to append to the QoS queue in %s\n", log->dir);
+        return ret;
+    }
+
+    log->segments[log->segmentCount - 1].size += (uint64_t) len;
+    log->bytes += (uint64_t) len;
+    log->next++;
+    schedule_sync(log);
+    enforce_cap(log);
+    return 0;
+}
+
+size_t broker_qos_log_read(QosLog *log, json_t *out, size_t max, uint64_t *lastSeq) {
+    size_t count = 0;
+    while (count < max && log->readSeq < log->next
+           && log->readSegment < log->segmentCount) {
+        QosLogSegment *seg = &log->segments[log->readSegment];
+        if (log->readOffset >= seg->size) {
+            if (log->readSegment + 1 >= log->segmentCount) {
+                break;
+            }
+            log->readSegment++;
+            log->readOffset = 0;
+            continue;
+        }
+
+        QosLogReader r;
+        if (reader_init(&r, log, seg->first, log->readOffset, O_RDONLY) != 0) {
+            log_err("Failed to read the QoS queue in %s\n", log->dir);
+            break;
+        }
+        const char *line;
+        size_t lineLen;
+        uint64_t lineOffset;
+        int ret = 1;
+        while (count < max && log->readOffset < seg->size
+               && (ret = reader_next(&r, &line, &lineLen, &lineOffset)) == 1) {
+            log->readOffset = lineOffset + lineLen + 1;
+            uint64_t seq;
+            const char *json;
+            size_t jsonLen;
+            if (parse_record(line, lineLen, &seq, &json, &jsonLen) != 0) {
+                log_warn("Skipping a broken record in %s\n", log->dir);
+                continue;
+            }
+            if (seq < log->readSeq) {
+                // acked before a restart
+                continue;
+            }
+            json_t *varray = json_loadb(json, jsonLen, 0, NULL);
+            log->readSeq = seq + 1;
+            if (!varray) {
+                log_warn("Skipping a broken record in %s\n", log->dir);
+                continue;
+            }
+            json_array_append_new(out, varray);
+            *lastSeq = seq;
+            ++count;
+        }
+        reader_free(&r);
+        if (ret < 0 || (ret == 0 && log->readOffset < seg->size)) {
+            // the segment is shorter than expected
+            seg->size = log->readOffset;
+        }
+    }
+    return count;
+}
+
+uint8_t broker_qos_log_read_appended(QosLog *log) {
+    if (log->next == 0 || log->readSeq != log->next - 1 || log->segmentCount == 0) {
+        return 0;
+    }
+    log->readSeq = log->next;
+    log->readSegment = log->segmentCount - 1;
+    log->readOffset = log->segments[log->readSegment].size;
+    return 1;
+}
+
+void broker_qos_log_rewind(QosLog *log) {
+    log->readSeq = log->head;
+    log->readSegment = 0;
+    log->readOffset = 0;
+}
+
+void broker_qos_log_ack(QosLog *log, uint64_t seq) {
+    if (seq < log->head || seq >= log->next) {
+        return;
+    }
+    log->head = seq + 1;
+    uint32_t acked = 0;
+    while (acked < log->segmentCount
+           && (acked + 1 < log->segmentCount
+               ? log->segments[acked + 1].first <= log->head
+               : log->head == log->next)) {
+        ++acked;
+    }
+    remove_segments(log, acked);
+    write_head(log);
+}
+
+void broker_qos_log_close(QosLog *log, uint8_t remove) {
+    if (!log) {
+        return;
+    }
+    list_remove_node(&log->logsNode);
+    if (remove && !logsShutdown) {
+        log->head = log->next;
+        remove_segments(log, log->segmentCount);
+        write_head(log);
+        uv_fs_t req;
+        uv_fs_rmdir(NULL, &req, log->dir, NULL);
+        uv_fs_req_cleanup(&req);
+    } else {
+        if (log->fd >= 0 && log->dirty) {
+            fs_fsync(log->fd);
+        }
+        close_tail(log);
+    }
+
+    if (log->sync) {
+        // freed once the fsync is done
+        log->closing = 1;
+        return;
+    }
+    free_log(log);
+}
+
+void broker_qos_log_remove_dir(const char *dir) {
+    uv_fs_t req;
+    uv_dirent_t ent;
+    if (uv_fs_scandir(NULL, &req, dir, 0, NULL) < 0) {
+        uv_fs_req_cleanup(&req);
+        return;
+    }
+    while (uv_fs_scandir_next(&req, &ent) != UV_EOF) {
+        size_t size = strlen(dir) + strlen(ent.name) + 2;
+        char *path = dslink_malloc(size);
+        if (!path) {
+            continue;
+        }
+        snprintf(path, size, "%s/%s", dir, ent.name);
+        if (ent.type == UV_DIRENT_DIR) {
+            broker_qos_log_remove_dir(path);
+        } else {
+            fs_unlink(path);
+        }
+        dslink_free(path);
+    }
+    uv_fs_req_cleanup(&req);
+
+    uv_fs_t rmReq;
+    uv_fs_rmdir(NULL, &rmReq, dir, NULL);
+    uv_fs_req_cleanup(&rmReq);
+}
+
+void broker_qos_log_shutdown() {
+    if (syncTimer) {
+        uv_timer_stop(syncTimer);
+        uv_close((uv_handle_t *) syncTimer, broker_free_handle);
+        syncTimer = NULL;
+    }
+    if (openLogsInit) {
+        dslink_list_foreach(&openLogs) {
+            QosLog *log = ((ListNode *) node)->value;
+            if (log->fd >= 0 && log->dirty) {
+                fs_fsync(log->fd);
+                log->dirty = 0;
+            }
+            close_tail(log);
+        }
+    }
+    logsShutdown = 1;
+}
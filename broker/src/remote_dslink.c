@@ -1,4 +1,5 @@
 #include <string.h>
+#include <sys/time.h>
 #include <dslink/utils.h>
 #include <broker/permission/permission.h>
 #include <broker/msg/msg_subscribe.h>
@@ -7,6 +8,13 @@
 #include <broker/subscription.h>
 
 #include <broker/net/ws.h>
+#include <broker/broker.h>
+
+#define LOG_TAG "remote_dslink"
+#include <dslink/log.h>
+
+#define BROKER_PING_INTERVAL 60000
+#define BROKER_IDLE_TIMEOUT 90000
 
 int broker_remote_dslink_init(RemoteDSLink *link) {
     memset(link, 0, sizeof(RemoteDSLink));
@@ -28,6 +36,7 @@ void broker_remote_dslink_free(RemoteDSLink *link) {
     if (link->auth) {
         mbedtls_ecdh_free(&link->auth->tempKey);
         DSLINK_CHECKED_EXEC(free, (void *) link->auth->pubKey);
+        dslink_free(link->auth->dsId);
         dslink_free(link->auth);
     }
 
@@ -50,7 +59,7 @@ void broker_remote_dslink_free(RemoteDSLink *link) {
     list_init(&req_sub_to_remove);
 
     if (link->node) {
-        vector_free(link->node->pendingAcks);
+        broker_clear_pending_acks(link->node);
 
         dslink_map_foreach(&link->node->req_sub_paths) {
             // find all subscription that doesn't use qos
@@ -82,15 +91,82 @@ void broker_remote_dslink_free(RemoteDSLink *link) {
 
     permission_groups_free(&link->permission_groups);
 
-    if (link->pingTimerHandle) {
-        uv_timer_stop(link->pingTimerHandle);
-        uv_close((uv_handle_t *) link->pingTimerHandle, broker_free_handle);
+    dslink_timer_stop(&link->pingTimer);
+    dslink_timer_stop(&link->idleTimer);
+    dslink_timer_stop(&link->handshakeTimer);
+
+    if (link->ackTimerHandle) {
+        uv_timer_stop(link->ackTimerHandle);
+        uv_close((uv_handle_t *) link->ackTimerHandle, broker_free_handle);
+        link->ackTimerHandle = NULL;
     }
+    // the responder subscribes everything again after a reconnect
+    broker_clear_sub_requests(link);
 
     dslink_free((void *) link->path);
     dslink_free(link->lastWriteTime);
+    dslink_free(link->lastReceiveTime);
+    link->lastReceiveTime = NULL;
     json_decref(link->linkData);
 
     wslay_event_context_free(link->ws);
     link->ws = NULL;
 }
+
+static
+uint64_t broker_ms_since(struct timeval *time) {
+    struct timeval current_time;
+    gettimeofday(&current_time, NULL);
+    long diff = (current_time.tv_sec - time->tv_sec) * 1000
+                + (current_time.tv_usec - time->tv_usec) / 1000;
+    return diff > 0 ? (uint64_t) diff : 0;
+}
+
+static
+void broker_remote_dslink_ping(DSLinkTimer *timer) {
+    RemoteDSLink *link = timer->data;
+    DSLinkTimerWheel *wheel = &link->broker->timerWheel;
+
+    if (link->lastWriteTime) {
+        uint64_t idle = broker_ms_since(link->lastWriteTime);
+        if (idle < BROKER_PING_INTERVAL) {
+            dslink_timer_start(wheel, timer, BROKER_PING_INTERVAL - idle, 0);
+            return;
+        }
+    }
+
+    log_debug("Send heartbeat to %s\n", link->name);
+    broker_ws_send_obj(link, json_object());
+    dslink_timer_start(wheel, timer, BROKER_PING_INTERVAL, 0);
+}
+
+static
+void broker_remote_dslink_idle(DSLinkTimer *timer) {
+    RemoteDSLink *link = timer->data;
+
+    uint64_t idle = broker_ms_since(link->lastReceiveTime);
+    if (idle < BROKER_IDLE_TIMEOUT) {
+        dslink_timer_start(&link->broker->timerWheel, timer,
+                           BROKER_IDLE_TIMEOUT - idle, 0);
+        return;
+    }
+
+    log_debug("Disconnecting %s due to missing receive\n", link->name);
+    link->onIdleTimeout(link);
+}
+
+void broker_remote_dslink_start_timers(RemoteDSLink *link,
+                                       void (*onIdleTimeout)(RemoteDSLink *link)) {
+    DSLinkTimerWheel *wheel = &link->broker->timerWheel;
+
+    if (!link->lastReceiveTime) {
+        link->lastReceiveTime = dslink_malloc(sizeof(struct timeval));
+    }
+    gettimeofday(link->lastReceiveTime, NULL);
+    link->onIdleTimeout = onIdleTimeout;
+
+    dslink_timer_init(&link->pingTimer, broker_remote_dslink_ping, link);
+    dslink_timer_start(wheel, &link->pingTimer, 1000, 0);
+    dslink_timer_init(&link->idleTimer, broker_remote_dslink_idle, link);
+    dslink_timer_start(wheel, &link->idleTimer, BROKER_IDLE_TIMEOUT, 0);
+}
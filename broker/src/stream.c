@@ -163,7 +163,7 @@ void broker_stream_free(BrokerStream *stream) {
         }
         dslink_map_free(&bss->reqSubs);
         dslink_free(bss->remote_path);
-        json_decref(bss->last_value);
+        broker_sub_value_unref(bss->last_value);
         dslink_free(stream);
     }
 
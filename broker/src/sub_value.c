@@ -0,0 +1,43 @@
+#include <string.h>
+
+#include <dslink/mem/mem.h>
+#include "broker/sub_value.h"
+
+SubValue *broker_sub_value_create(json_t *varray) {
+    SubValue *value = dslink_calloc(1, sizeof(SubValue));
+    if (!value) {
+        return NULL;
+    }
+    value->varray = json_incref(varray);
+    value->refs = 1;
+    return value;
+}
+
+void broker_sub_value_unref(SubValue *value) {
+    if (!value || --value->refs > 0) {
+        return;
+    }
+    json_decref(value->varray);
+    dslink_free(value->data);
+    dslink_free(value);
+}
+
+const char *broker_sub_value_data(SubValue *value) {
+    if (value->data) {
+        return value->data;
+    }
+    char *data = json_dumps(value->varray, JSON_PRESERVE_ORDER | JSON_COMPACT);
+    if (!data) {
+        return NULL;
+    }
+    // the sid is a number or null, the requester's one is put in front
+    char *rest = strpbrk(data, ",]");
+    if (!rest) {
+        dslink_free(data);
+        return NULL;
+    }
+    value->len = strlen(rest);
+    memmove(data, rest, value->len + 1);
+    value->data = data;
+    return data;
+}
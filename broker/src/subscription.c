@@ -1,39 +1,30 @@
 #include <broker/subscription.h>
 #include <dslink/utils.h>
+#include <dslink/err.h>
 #include <broker/net/ws.h>
 #include <broker/config.h>
 #include <broker/broker.h>
+#include <broker/qos_log.h>
+#include <broker/utils.h>
 
 #define LOG_TAG "subscription"
 
 #include <dslink/log.h>
 
 #include <string.h>
+#include <inttypes.h>
 
 static int removeFromMessageQueue(SubRequester *subReq, uint32_t msgId);
-static int sendMessage(SubRequester *subReq, json_t *varray, uint32_t* msgId);
-
-int cmp_pack_subs(const void* lhs, const void* rhs)
-{
-    PendingAck* lpack = (PendingAck*)lhs;
-    PendingAck* rpack = (PendingAck*)rhs;
-    if(lpack->subscription == rpack->subscription) {
-        return 0;
-    }
-
-    return -1;
-}
-
-int cmp_pack(const void* lhs, const void* rhs)
-{
-    PendingAck* lpack = (PendingAck*)lhs;
-    PendingAck* rpack = (PendingAck*)rhs;
-    if(lpack->msg_id == rpack->msg_id) {
-        return 0;
-    } else if(lpack->msg_id > rpack->msg_id) {
-        return 1;
-    }
-    return -1;
+static int sendMessage(SubRequester *subReq, SubValue *value, uint32_t* msgId);
+static uint8_t canSendValue(SubRequester *subReq);
+static void sendPendingValue(SubRequester *subReq);
+static void ackQosLog(SubRequester *subReq, uint32_t msgId);
+static void refillMessageQueue(SubRequester *subReq);
+
+// The socket of the requester didn't take the queued data yet
+static uint8_t wsQueueFull(RemoteDSLink *link) {
+    return link->ws && wslay_event_get_queued_msg_length(link->ws)
+                       >= broker_max_ws_queued_bytes;
 }
 
 int cmp_int(const void* lhs, const void* rhs)
@@ -46,16 +37,65 @@ int cmp_int(const void* lhs, const void* rhs)
     return -1;
 }
 
+// Sampling intervals are multiples of it, in ms
+#define SAMPLE_INTERVAL_STEP 100
+
+// Subscriptions sampled with the same interval holding a value
+typedef struct SampleBucket {
+    uint32_t interval;
+    uv_timer_t *timer;
+    // List<SubRequester *> linked by sampleNode
+    List subs;
+    // In sampleBuckets
+    ListNode node;
+} SampleBucket;
+
+// List<SampleBucket *>, a bucket is freed after a tick without values
+static List sampleBuckets;
+
+// msg ids wrap around to 1 after 2147483647, see broker_ws_send_obj
+#define MSG_ID_MODULO 2147483647U
+
+// Whether the cumulative ack covers msgId, sent earlier than the ack
+static uint8_t msgIdAcked(uint32_t msgId, uint32_t ack) {
+    uint32_t distance = (ack + MSG_ID_MODULO - msgId) % MSG_ID_MODULO;
+    return distance < MSG_ID_MODULO / 2;
+}
+
+static void releaseAckRef(SubAckRef *ref) {
+    if (--ref->refs == 0) {
+        dslink_free(ref);
+    }
+}
+
+static void cleanupPendingAck(void *data) {
+    releaseAckRef(((PendingAck *) data)->subscription);
+}
+
 static int addPendingAck(SubRequester *subReq, uint32_t msgId)
 {
     DownstreamNode* node = (DownstreamNode*)(subReq->reqNode->link->node);
     if(!node->pendingAcks) {
-        node->pendingAcks = (Vector*)dslink_malloc(sizeof(Vector));
-        vector_init(node->pendingAcks, 64, sizeof(PendingAck));
+        node->pendingAcks = (Ringbuffer*)dslink_malloc(sizeof(Ringbuffer));
+        if (!node->pendingAcks) {
+            return DSLINK_ALLOC_ERR;
+        }
+        // not bounded, acks may not get lost
+        rb_init(node->pendingAcks, UINT32_MAX, sizeof(PendingAck), cleanupPendingAck);
     }
-    PendingAck pack = { subReq, msgId };
-    vector_append(node->pendingAcks, &pack);
-
+    if(!subReq->ackRef) {
+        subReq->ackRef = dslink_calloc(1, sizeof(SubAckRef));
+        if (!subReq->ackRef) {
+            return DSLINK_ALLOC_ERR;
+        }
+        subReq->ackRef->sub = subReq;
+        subReq->ackRef->refs = 1;
+    }
+    PendingAck pack = { subReq->ackRef, msgId };
+    if (rb_push(node->pendingAcks, &pack) != 0) {
+        return DSLINK_ALLOC_ERR;
+    }
+    ++subReq->ackRef->refs;
     ++subReq->messageOutputQueueCount;
 
     return 0;
@@ -63,30 +103,64 @@ static int addPendingAck(SubRequester *subReq, uint32_t msgId)
 
 int check_subscription_ack(RemoteDSLink *link, uint32_t ack)
 {
-    PendingAck search_pack = { NULL, ack };
     log_debug("Receiving ack from %s: %d\n", link->name, ack);
 
-    uint32_t last = vector_upper_bound(link->node->pendingAcks, &search_pack, cmp_pack);
+    PendingAck *front;
+    while ((front = rb_front(link->node->pendingAcks))
+           && msgIdAcked(front->msg_id, ack)) {
+        PendingAck pack = *front;
+        // a subscription still holds its own reference
+        SubRequester *subReq = pack.subscription->sub;
+        rb_pop(link->node->pendingAcks);
+        if (!subReq) {
+            continue;
+        }
 
-    for (long idx = (long)last-1; idx >= 0; --idx) { 
-      PendingAck pack = *(PendingAck*)vector_get(link->node->pendingAcks, idx);
-      SubRequester *subReq = pack.subscription;
-      
-      --subReq->messageOutputQueueCount;
+        --subReq->messageOutputQueueCount;
 
-      if ( removeFromMessageQueue(subReq, pack.msg_id) ) { 
-          sendQueuedMessages(subReq);
-      }      
+        if ( removeFromMessageQueue(subReq, pack.msg_id) ) {
+            refillMessageQueue(subReq);
+            sendQueuedMessages(subReq);
+        }
+        if (subReq->qosLog) {
+            ackQosLog(subReq, pack.msg_id);
+        }
+        if (subReq->pendingValue && canSendValue(subReq)) {
+            sendPendingValue(subReq);
+        }
     }
-    vector_erase_range(link->node->pendingAcks, 0, last);
     return 0;
 }
 
+void broker_clear_pending_acks(DownstreamNode *node) {
+    if (node->pendingAcks) {
+        rb_free(node->pendingAcks);
+        dslink_free(node->pendingAcks);
+        node->pendingAcks = NULL;
+    }
+}
 
-void send_subscribe_request(DownstreamNode *node,
-                            const char *path,
-                            uint32_t sid,
-                            uint8_t qos) {
+void broker_send_dirty_subs(RemoteDSLink *link) {
+    if (!link->node) {
+        return;
+    }
+    dslink_list_foreach_nonext(&link->node->dirtySubs) {
+        ListNodeBase *next = node->next;
+        SubRequester *subReq = ((ListNode *) node)->value;
+        if (wsQueueFull(link)) {
+            break;
+        }
+        // subscriptions still waiting for acks stay in the list
+        if (canSendValue(subReq)) {
+            sendPendingValue(subReq);
+        }
+        node = next;
+    }
+}
+
+
+static void sendSubRequest(RemoteDSLink *link, const char *method,
+                           const char *key, json_t *values) {
     json_t *top = json_object();
     json_t *reqs = json_array();
     json_object_set_new_nocheck(top, "requests", reqs);
@@ -94,51 +168,191 @@ void send_subscribe_request(DownstreamNode *node,
     json_t *req = json_object();
     json_array_append_new(reqs, req);
 
-    uint32_t rid = broker_node_incr_rid(node);
+    uint32_t rid = broker_node_incr_rid(link->node);
     json_object_set_new_nocheck(req, "rid", json_integer(rid));
-    json_object_set_new_nocheck(req, "method", json_string_nocheck("subscribe"));
-    json_t *paths = json_array();
-    json_object_set_new_nocheck(req, "paths", paths);
+    json_object_set_new_nocheck(req, "method", json_string_nocheck(method));
+    json_object_set_new_nocheck(req, key, values);
+
+    broker_ws_send_obj(link, top);
+    json_decref(top);
+}
+
+void broker_flush_sub_requests(RemoteDSLink *link) {
+    if (link->subRequestTimerHandle) {
+        uv_timer_stop(link->subRequestTimerHandle);
+    }
+    // unsubscribes first, a path unsubscribed and subscribed again within
+    // the iteration got a new sid, the responder unsubscribes by path
+    if (link->pendingUnsubs) {
+        sendSubRequest(link, "unsubscribe", "sids", link->pendingUnsubs);
+        link->pendingUnsubs = NULL;
+    }
+    if (link->pendingSubs) {
+        sendSubRequest(link, "subscribe", "paths", link->pendingSubs);
+        link->pendingSubs = NULL;
+    }
+}
+
+void broker_clear_sub_requests(RemoteDSLink *link) {
+    if (link->subRequestTimerHandle) {
+        uv_timer_stop(link->subRequestTimerHandle);
+        uv_close((uv_handle_t *) link->subRequestTimerHandle, broker_free_handle);
+        link->subRequestTimerHandle = NULL;
+    }
+    json_decref(link->pendingSubs);
+    link->pendingSubs = NULL;
+    json_decref(link->pendingUnsubs);
+    link->pendingUnsubs = NULL;
+}
+
+static void subRequestTimer(uv_timer_t *timer) {
+    broker_flush_sub_requests(timer->data);
+}
+
+// Sends the pending requests once the batch is full, at the end of the
+// loop iteration otherwise
+static void scheduleSubRequests(RemoteDSLink *link, json_t *pending) {
+    if (json_array_size(pending) >= broker_max_sub_batch_size) {
+        broker_flush_sub_requests(link);
+        return;
+    }
+    if (!link->subRequestTimerHandle) {
+        link->subRequestTimerHandle = dslink_malloc(sizeof(uv_timer_t));
+        if (!link->subRequestTimerHandle) {
+            broker_flush_sub_requests(link);
+            return;
+        }
+        uv_timer_init(mainLoop, link->subRequestTimerHandle);
+        link->subRequestTimerHandle->data = link;
+    }
+    if (!uv_is_active((uv_handle_t *) link->subRequestTimerHandle)) {
+        uv_timer_start(link->subRequestTimerHandle, subRequestTimer, 0, 0);
+    }
+}
+
+void send_subscribe_request(DownstreamNode *node,
+                            const char *path,
+                            uint32_t sid,
+                            uint8_t qos) {
+    RemoteDSLink *link = node->link;
+    if (!link->pendingSubs) {
+        link->pendingSubs = json_array();
+    }
     json_t *p = json_object();
-    json_array_append_new(paths, p);
+    json_array_append_new(link->pendingSubs, p);
     json_object_set_new_nocheck(p, "path", json_string_nocheck(path));
     json_object_set_new_nocheck(p, "sid", json_integer(sid));
     json_object_set_new_nocheck(p, "qos", json_integer(qos));
 
-    broker_ws_send_obj(node->link, top);
-    json_decref(top);
+    scheduleSubRequests(link, link->pendingSubs);
+}
+
+void send_unsubscribe_request(DownstreamNode *node, uint32_t sid) {
+    RemoteDSLink *link = node->link;
+    // subscribes of the sid still pending would be sent after it
+    for (size_t i = 0; i < json_array_size(link->pendingSubs);) {
+        json_t *p = json_array_get(link->pendingSubs, i);
+        if (json_integer_value(json_object_get(p, "sid")) == sid) {
+            json_array_remove(link->pendingSubs, i);
+        } else {
+            ++i;
+        }
+    }
+    if (!link->pendingUnsubs) {
+        link->pendingUnsubs = json_array();
+    }
+    json_array_append_new(link->pendingUnsubs, json_integer(sid));
+
+    scheduleSubRequests(link, link->pendingUnsubs);
 }
 
 
+static void initQosKeys(SubRequester *subReq) {
+    if (!subReq->qosKey1) {
+        subReq->qosKey1 = dslink_str_escape(subReq->reqNode->path);
+    }
+    if (!subReq->qosKey2) {
+        subReq->qosKey2 = dslink_str_escape(subReq->path);
+    }
+}
+
+// Opens <storage>/<child>/<requester>/<path>
+static QosLog *openSubLog(SubRequester *subReq, char *child) {
+    initQosKeys(subReq);
+    const char *root = broker_get_storage_path(child);
+    if (!root) {
+        return NULL;
+    }
+    QosLog *log = NULL;
+    size_t size = strlen(root) + strlen(subReq->qosKey1) + strlen(subReq->qosKey2) + 3;
+    char *dir = dslink_malloc(size);
+    if (dir) {
+        snprintf(dir, size, "%s/%s/%s", root, subReq->qosKey1, subReq->qosKey2);
+        log = broker_qos_log_open(dir);
+        dslink_free(dir);
+    }
+    dslink_free((void *) root);
+    return log;
+}
+
+static void openQosLog(SubRequester *subReq) {
+    subReq->qosLog = openSubLog(subReq, "qos");
+}
+
+static void closeSpill(SubRequester *subReq) {
+    broker_qos_log_close(subReq->spill, 1);
+    subReq->spill = NULL;
+}
+
+void broker_clear_qos_spill() {
+    const char *root = broker_get_storage_path("spill");
+    if (root) {
+        broker_qos_log_remove_dir(root);
+        dslink_free((void *) root);
+    }
+}
+
+static void closeQosLog(SubRequester *subReq, uint8_t remove) {
+    broker_qos_log_close(subReq->qosLog, remove);
+    subReq->qosLog = NULL;
+    if (subReq->qosBatches) {
+        rb_free(subReq->qosBatches);
+        dslink_free(subReq->qosBatches);
+        subReq->qosBatches = NULL;
+    }
+}
+
 SubRequester *broker_create_sub_requester(DownstreamNode * node, const char *path, uint32_t reqSid, uint8_t qos, json_t *qosQueue) {
     SubRequester *req = dslink_calloc(1, sizeof(SubRequester));
     memset(req, 0, sizeof(SubRequester));
-    if (qosQueue) {
-        req->qosQueue = qosQueue;
-        json_incref(qosQueue);
-    } else if (qos > 2) {
-        req->qosQueue = json_array();
-    }
     req->path = dslink_strdup(path);
     req->reqNode = node;
     req->reqSid = reqSid;
     req->qos = qos;
+    if (qos > 2) {
+        openQosLog(req);
+        if (req->qosLog && json_array_size(qosQueue) > 0) {
+            // a queue stored before the values went to the log
+            size_t idx;
+            json_t *varray;
+            json_array_foreach(qosQueue, idx, varray) {
+                broker_qos_log_append(req->qosLog, varray);
+            }
+            serialize_qos_queue(req, 0);
+        }
+    }
     return req;
 }
 
 void serialize_qos_queue(SubRequester *subReq, uint8_t delete) {
-    if (!subReq->qosKey1) {
-        subReq->qosKey1 = dslink_str_escape(subReq->reqNode->path);
-    }
-    if (!subReq->qosKey2) {
-        subReq->qosKey2 = dslink_str_escape(subReq->path);
-    }
+    initQosKeys(subReq);
     if (delete) {
         dslink_storage_store(((Broker *)mainLoop->data)->storage, subReq->qosKey1, subReq->qosKey2, NULL, NULL, NULL);
     } else {
+        // the queued values are in the log of the subscription
         json_t *array = json_array();
         json_array_append_new(array, json_integer(subReq->qos));
-        json_array_append(array, subReq->qosQueue);
+        json_array_append_new(array, json_array());
         dslink_storage_store(((Broker *)mainLoop->data)->storage, subReq->qosKey1, subReq->qosKey2, array, NULL, NULL);
         json_decref(array);
     }
@@ -169,16 +383,22 @@ void broker_free_sub_requester(SubRequester *req) {
         serialize_qos_queue(req, 1);
         dslink_storage_store(((Broker *)mainLoop->data)->storage, req->reqNode->path, req->path, NULL, NULL, NULL);
     }
-    if (req->qosQueue) {
-        clear_qos_queue(req, 1);
-        json_decref(req->qosQueue);
+    // kept on disk when the broker shuts down
+    closeQosLog(req, 1);
+    closeSpill(req);
+    if (req->ackRef) {
+        // the pending acks of the subscription are dropped once they arrive
+        req->ackRef->sub = NULL;
+        releaseAckRef(req->ackRef);
+        req->ackRef = NULL;
     }
+    req->messageOutputQueueCount = 0;
+    list_remove_node(&req->dirtyNode);
+    broker_sub_value_unref(req->pendingValue);
+    broker_sub_value_unref(req->lastValue);
+    list_remove_node(&req->sampleNode);
+    broker_sub_value_unref(req->sampledValue);
     if(req->messageQueue) {
-        PendingAck search_pack = { req, 0 };
- 	uint32_t eraseIdx = vector_remove_if( req->reqNode->pendingAcks, &search_pack, cmp_pack_subs);
-	vector_erase_range( req->reqNode->pendingAcks, eraseIdx, vector_count(req->reqNode->pendingAcks) );
-	req->messageOutputQueueCount = 0;
-	
         rb_free(req->messageQueue);
         dslink_free(req->messageQueue);
         req->messageQueue = NULL;
@@ -201,44 +421,82 @@ void broker_clear_messsage_ids(SubRequester *subReq)
     }
     m->msg_id = 0;
   }
+  if (subReq->qosLog) {
+      // the values not acked yet are sent again after the reconnect
+      if (subReq->qosBatches) {
+          rb_free(subReq->qosBatches);
+      }
+      broker_qos_log_rewind(subReq->qosLog);
+  }
 }
 
+static uint32_t sendUpdates(SubRequester *subReq, json_t *updates);
+static uint32_t sendValue(SubRequester *subReq, SubValue *value);
+
+// Sends the values of the log following the ones sent already, the value
+// appended last is sent as is if it's the only one
+static void sendQosLog(SubRequester *subReq, SubValue *appended) {
+    while (subReq->reqNode->link
+           && subReq->reqSid != 0xFFFFFFFF
+           && subReq->messageOutputQueueCount < broker_max_ws_send_queue_size
+           && broker_qos_log_unread(subReq->qosLog) > 0) {
+        QosBatch batch;
+        if (appended && broker_qos_log_read_appended(subReq->qosLog)) {
+            batch.last_seq = subReq->qosLog->next - 1;
+            batch.msg_id = sendValue(subReq, appended);
+        } else {
+            json_t *updates = json_array();
+            if (broker_qos_log_read(subReq->qosLog, updates,
+                                    broker_max_qos_queue_size,
+                                    &batch.last_seq) == 0) {
+                json_decref(updates);
+                break;
+            }
+            batch.msg_id = sendUpdates(subReq, updates);
+            json_decref(updates);
+        }
+        appended = NULL;
 
-void clear_qos_queue(SubRequester *subReq, uint8_t serialize) {
-    json_array_clear(subReq->qosQueue);
-    if (serialize && subReq->qos > 2) {
-        serialize_qos_queue(subReq, 0);
+        if (!subReq->qosBatches) {
+            subReq->qosBatches = dslink_malloc(sizeof(Ringbuffer));
+            if (!subReq->qosBatches) {
+                break;
+            }
+            rb_init(subReq->qosBatches, UINT32_MAX, sizeof(QosBatch), NULL);
+        }
+        rb_push(subReq->qosBatches, &batch);
+        addPendingAck(subReq, batch.msg_id);
     }
 }
 
-void broker_update_sub_req_qos(SubRequester *subReq) {
-    if (subReq->reqNode->link) {
-
-        json_t *top = json_object();
-        json_t *resps = json_array();
-        json_object_set_new_nocheck(top, "responses", resps);
-        json_t *newResp = json_object();
-        json_array_append_new(resps, newResp);
-        json_object_set_new_nocheck(newResp, "rid", json_integer(0));
-
-        size_t idx;
-        json_t *varray;
-        json_array_foreach(subReq->qosQueue, idx, varray) {
-            json_array_set_new(varray, 0, json_integer(subReq->reqSid));
-        }
-        json_object_set_nocheck(newResp, "updates", subReq->qosQueue);
-
-        broker_ws_send_obj(subReq->reqNode->link, top);
+// Values sent in messages up to msgId are on the requester, the log drops
+// them and the window has room for the following ones
+static void ackQosLog(SubRequester *subReq, uint32_t msgId) {
+    QosBatch *batch;
+    uint8_t acked = 0;
+    uint64_t lastSeq = 0;
+    while ((batch = rb_front(subReq->qosBatches))
+           && msgIdAcked(batch->msg_id, msgId)) {
+        lastSeq = batch->last_seq;
+        acked = 1;
+        rb_pop(subReq->qosBatches);
+    }
+    if (acked) {
+        broker_qos_log_ack(subReq->qosLog, lastSeq);
+    }
+    sendQosLog(subReq, NULL);
+}
 
-        json_decref(top);
-        clear_qos_queue(subReq, 1);
+void broker_update_sub_req_qos(SubRequester *subReq) {
+    if (subReq->qosLog) {
+        sendQosLog(subReq, NULL);
     }
 }
 
 void cleanup_queued_message(void* message) {
     QueuedMessage* m = message;
     if(m) {
-        json_decref(m->message);
+        broker_sub_value_unref(m->value);
     }
 }
 
@@ -258,7 +516,7 @@ uint32_t sendQueuedMessages(SubRequester *subReq) {
                 break;
             }
 
-          sendMessage(subReq, m->message, &m->msg_id);
+          sendMessage(subReq, m->value, &m->msg_id);
           ++result;
         }
     }
@@ -266,28 +524,58 @@ uint32_t sendQueuedMessages(SubRequester *subReq) {
     return result;
 }
 
-static int sendMessage(SubRequester *subReq, json_t *varray, uint32_t* msgId) {
+static uint32_t sendUpdates(SubRequester *subReq, json_t *updates) {
     json_t *top = json_object();
     json_t *resps = json_array();
     json_object_set_new_nocheck(top, "responses", resps);
     json_t *newResp = json_object();
     json_array_append_new(resps, newResp);
     json_object_set_new_nocheck(newResp, "rid", json_integer(0));
-    json_t *updates = json_array();
-    json_object_set_new_nocheck(newResp, "updates", updates);
+    json_object_set_nocheck(newResp, "updates", updates);
 
-    json_array_set_new(varray, 0, json_integer(subReq->reqSid));
-    json_array_append(updates, varray);
+    size_t idx;
+    json_t *varray;
+    json_array_foreach(updates, idx, varray) {
+        json_array_set_new(varray, 0, json_integer(subReq->reqSid));
+    }
 
-    *msgId = broker_ws_send_obj(subReq->reqNode->link, top);
+    uint32_t msgId = broker_ws_send_obj(subReq->reqNode->link, top);
     json_decref(top);
+    return msgId;
+}
+
+// Sends a single value built from its serialized bytes, the record isn't
+// touched so it can be shared
+static uint32_t sendValue(SubRequester *subReq, SubValue *value) {
+    const char *data = broker_sub_value_data(value);
+    if (!data) {
+        return DSLINK_ALLOC_ERR;
+    }
+    // "responses":[{"rid":0,"updates":[[<sid><data>]}]
+    static const char prefix[] = "\"responses\":[{\"rid\":0,\"updates\":[[";
+    static const char suffix[] = "]}]";
+    size_t size = sizeof(prefix) + 10 + value->len + sizeof(suffix);
+    char *members = dslink_malloc(size);
+    if (!members) {
+        return DSLINK_ALLOC_ERR;
+    }
+    int len = snprintf(members, size, "%s%" PRIu32 "%s%s",
+                       prefix, subReq->reqSid, data, suffix);
+    uint32_t msgId = broker_ws_send_members(subReq->reqNode->link, members,
+                                            (size_t) len, 1);
+    dslink_free(members);
+    return msgId;
+}
+
+static int sendMessage(SubRequester *subReq, SubValue *value, uint32_t* msgId) {
+    *msgId = sendValue(subReq, value);
 
     log_debug("Send message with msgId %d\n", *msgId);
 
     return addPendingAck(subReq, *msgId);
 }
 
-static void addToMessageQueue(SubRequester *subReq, json_t *varray, uint32_t msgId) {
+static void addToMessageQueue(SubRequester *subReq, SubValue *value, uint32_t msgId) {
     log_debug("Add message with msgId %d to MessageQueue\n", msgId);
 
     if(!subReq->messageQueue) {
@@ -295,12 +583,99 @@ static void addToMessageQueue(SubRequester *subReq, json_t *varray, uint32_t msg
         // TODO lfuerste: maybe use a lesser value for QOS == 0?
         rb_init(subReq->messageQueue, broker_max_qos_queue_size, sizeof(QueuedMessage), cleanup_queued_message);
     }
-    QueuedMessage m = { json_incref(varray),  msgId};
+    if ((uint32_t) rb_count(subReq->messageQueue) == subReq->messageQueue->size
+        || subReq->spill) {
+        // the values behind the spilled ones are spilled as well to keep
+        // them in order
+        if (!subReq->spill) {
+            subReq->spill = openSubLog(subReq, "spill");
+            if (subReq->spill) {
+                subReq->spill->maxBytes = broker_max_qos_spill_size;
+                // deleted at startup, see broker_clear_qos_spill
+                subReq->spill->noSync = 1;
+            }
+        }
+        if (subReq->spill && broker_qos_log_append(subReq->spill, value->varray) == 0) {
+            return;
+        }
+    }
+    QueuedMessage m = { broker_sub_value_ref(value),  msgId};
     if(rb_push(subReq->messageQueue, &m) > 0) {
         log_debug("Skipping a value because the queue is full: sid %d\n", subReq->reqSid);
     }
 }
 
+// Moves spilled values into the room the acks made in the message queue,
+// the spill file is deleted once it's drained
+static void refillMessageQueue(SubRequester *subReq) {
+    if (!subReq->spill || !subReq->messageQueue) {
+        return;
+    }
+    uint32_t room = subReq->messageQueue->size - (uint32_t) rb_count(subReq->messageQueue);
+    if (room > 0 && broker_qos_log_unread(subReq->spill) > 0) {
+        json_t *values = json_array();
+        uint64_t lastSeq;
+        size_t count = broker_qos_log_read(subReq->spill, values, room, &lastSeq);
+        size_t idx;
+        json_t *varray;
+        json_array_foreach(values, idx, varray) {
+            QueuedMessage m = { broker_sub_value_create(varray), 0 };
+            if (m.value) {
+                rb_push(subReq->messageQueue, &m);
+            }
+        }
+        json_decref(values);
+        if (count == 0) {
+            log_warn("Dropping the unreadable spilled values of %s\n", subReq->path);
+            closeSpill(subReq);
+            return;
+        }
+        broker_qos_log_ack(subReq->spill, lastSeq);
+    }
+    if (broker_qos_log_unread(subReq->spill) == 0) {
+        closeSpill(subReq);
+    }
+}
+
+// A value of a QoS 0 or 1 subscription can go out unless the requester is
+// behind: too many messages of the subscription aren't acked yet, its socket
+// didn't take the queued data or messages of a former QoS 2 queue are left.
+static uint8_t canSendValue(SubRequester *subReq) {
+    RemoteDSLink *link = subReq->reqNode->link;
+    if (!link || subReq->reqSid == 0xFFFFFFFF) {
+        return 0;
+    }
+    if (subReq->messageOutputQueueCount >= broker_max_ws_send_queue_size
+        || (subReq->messageQueue && rb_count(subReq->messageQueue) > 0)) {
+        return 0;
+    }
+    return !wsQueueFull(link);
+}
+
+static void setPendingValue(SubRequester *subReq, SubValue *value) {
+    broker_sub_value_ref(value);
+    broker_sub_value_unref(subReq->pendingValue);
+    subReq->pendingValue = value;
+    if (!list_node_in_list(&subReq->dirtyNode)) {
+        subReq->dirtyNode.value = subReq;
+        list_insert_node(&subReq->reqNode->dirtySubs, &subReq->dirtyNode);
+    }
+}
+
+static SubValue *takePendingValue(SubRequester *subReq) {
+    SubValue *value = subReq->pendingValue;
+    subReq->pendingValue = NULL;
+    list_remove_node(&subReq->dirtyNode);
+    return value;
+}
+
+static void sendPendingValue(SubRequester *subReq) {
+    uint32_t msgId = 0;
+    SubValue *value = takePendingValue(subReq);
+    sendMessage(subReq, value, &msgId);
+    broker_sub_value_unref(value);
+}
+
 static int removeFromMessageQueue(SubRequester *subReq, uint32_t msgId) {
    int result = 0;
 
@@ -310,57 +685,202 @@ static int removeFromMessageQueue(SubRequester *subReq, uint32_t msgId) {
         while(rb_count(subReq->messageQueue)) {
             QueuedMessage* m = rb_front(subReq->messageQueue);
 
-            if(m->msg_id == 0 || m->msg_id > msgId) {
+            if(m->msg_id == 0 || !msgIdAcked(m->msg_id, msgId)) {
                 break;
             }
             ++result;
-            rb_pop(subReq->messageQueue);
+            // popping may move the queued messages
             log_debug("Removing message with msgId %d from MessageQueue\n", m->msg_id);
+            rb_pop(subReq->messageQueue);
         }
     }
     return result;
 }
 
-int broker_update_sub_req(SubRequester *subReq, json_t *varray) {
+void broker_sub_filter_parse(SubFilter *filter, json_t *sub) {
+    memset(filter, 0, sizeof(SubFilter));
+    json_t *jDeadband = json_object_get(sub, "deadband");
+    if (json_is_number(jDeadband) && json_number_value(jDeadband) > 0) {
+        filter->deadband = json_number_value(jDeadband);
+        const char *type = json_string_value(json_object_get(sub, "deadbandType"));
+        filter->deadbandPercent = type && strcmp(type, "percent") == 0;
+    }
+    filter->onChange = json_is_true(json_object_get(sub, "onChange"));
+    json_t *jInterval = json_object_get(sub, "minInterval");
+    if (json_is_integer(jInterval) && json_integer_value(jInterval) > 0) {
+        // rounded up to a step so subscriptions share the timers
+        json_int_t interval = json_integer_value(jInterval);
+        if (interval > UINT32_MAX - SAMPLE_INTERVAL_STEP) {
+            interval = UINT32_MAX - SAMPLE_INTERVAL_STEP;
+        }
+        filter->interval = (uint32_t) ((interval + SAMPLE_INTERVAL_STEP - 1)
+                                       / SAMPLE_INTERVAL_STEP * SAMPLE_INTERVAL_STEP);
+    }
+}
+
+uint8_t broker_sub_filter_pass(SubRequester *subReq, SubValue *value) {
+    if (!subReq->lastValue || subReq->lastValue == value) {
+        return 1;
+    }
+    json_t *last = json_array_get(subReq->lastValue->varray, 1);
+    json_t *current = json_array_get(value->varray, 1);
+    if (subReq->filter.deadband > 0
+        && json_is_number(last) && json_is_number(current)) {
+        double a = json_number_value(last);
+        double b = json_number_value(current);
+        double band = subReq->filter.deadband;
+        if (subReq->filter.deadbandPercent) {
+            band *= (a < 0 ? -a : a) / 100;
+        }
+        return (a < b ? b - a : a - b) > band;
+    }
+    if (subReq->filter.onChange) {
+        if (json_is_number(last) && json_is_number(current)) {
+            // 1 and 1.0 are the same value
+            return json_number_value(last) != json_number_value(current);
+        }
+        return !json_equal(last, current);
+    }
+    return 1;
+}
+
+int broker_update_sub_req_value(SubRequester *subReq, SubValue *value) {
     int result = 1;
 
     uint32_t msgId = 0;
 
-    if ( subReq->qos <= 2 ) {
+    if (subReq->lastValue != value) {
+        broker_sub_value_unref(subReq->lastValue);
+        subReq->lastValue = broker_sub_value_ref(value);
+    }
+
+    if ( subReq->qos <= 1 ) {
+        // Only the latest value matters, while the requester is behind it
+        // replaces the one waiting to be sent
+        if (canSendValue(subReq)) {
+            broker_sub_value_unref(takePendingValue(subReq));
+            sendMessage(subReq, value, &msgId);
+        } else {
+            setPendingValue(subReq, value);
+        }
+    } else if ( subReq->qos == 2 ) {
         // Add the message to the message queue and than try to send messages from the queue to keep message order 
         // in all cases
-        addToMessageQueue(subReq, varray, msgId);
+        addToMessageQueue(subReq, value, msgId);
         if ( sendQueuedMessages(subReq) == 0 ) {
             log_debug("Send queue full: %d\n", subReq->reqSid);
         }
-    } else {
-        if (subReq->reqNode->link ) {
-            result = sendMessage(subReq, varray, &msgId);
-        } else {
-            // add to qos queue
-            if (!subReq->qosQueue) {
-                subReq->qosQueue = json_array();
-            }
-            if (json_array_size(subReq->qosQueue) >= broker_max_qos_queue_size) {
-                // destroy qos queue when exceed max queue size
-                clear_qos_queue(subReq, 1);
-                return result;
-            }
-            json_array_append(subReq->qosQueue, varray);
-            serialize_qos_queue(subReq, 0);
-        }
+    } else if (subReq->qosLog && broker_qos_log_append(subReq->qosLog, value->varray) == 0) {
+        // values go out in the order of the log, the ones before are sent first
+        sendQosLog(subReq, value);
+    } else if (subReq->reqNode->link) {
+        // without its log the value can't be kept
+        result = sendMessage(subReq, value, &msgId);
     }
 
     return result;
 }
 
+int broker_update_sub_req(SubRequester *subReq, json_t *varray) {
+    SubValue *value = broker_sub_value_create(varray);
+    if (!value) {
+        return 0;
+    }
+    int result = broker_update_sub_req_value(subReq, value);
+    broker_sub_value_unref(value);
+    return result;
+}
+
+static void freeSampleBucket(uv_handle_t *handle) {
+    dslink_free(handle->data);
+    dslink_free(handle);
+}
+
+// Sends the values sampled during the last interval
+static void sampleTimer(uv_timer_t *timer) {
+    SampleBucket *bucket = timer->data;
+    if (list_is_empty(&bucket->subs)) {
+        list_remove_node(&bucket->node);
+        uv_timer_stop(timer);
+        uv_close((uv_handle_t *) timer, freeSampleBucket);
+        return;
+    }
+    dslink_list_foreach_nonext(&bucket->subs) {
+        ListNodeBase *next = node->next;
+        SubRequester *subReq = ((ListNode *) node)->value;
+        SubValue *value = subReq->sampledValue;
+        subReq->sampledValue = NULL;
+        list_remove_node(&subReq->sampleNode);
+        // filtered now, a value which failed after the sampled one is the
+        // current one and stays with the requester's last value
+        if (broker_sub_filter_pass(subReq, value)) {
+            broker_update_sub_req_value(subReq, value);
+        }
+        broker_sub_value_unref(value);
+        node = next;
+    }
+}
+
+static SampleBucket *getSampleBucket(uint32_t interval) {
+    if (!sampleBuckets.head.next) {
+        list_init(&sampleBuckets);
+    }
+    dslink_list_foreach(&sampleBuckets) {
+        SampleBucket *bucket = ((ListNode *) node)->value;
+        if (bucket->interval == interval) {
+            return bucket;
+        }
+    }
+    SampleBucket *bucket = dslink_calloc(1, sizeof(SampleBucket));
+    if (!bucket) {
+        return NULL;
+    }
+    bucket->timer = dslink_malloc(sizeof(uv_timer_t));
+    if (!bucket->timer) {
+        dslink_free(bucket);
+        return NULL;
+    }
+    bucket->interval = interval;
+    list_init(&bucket->subs);
+    bucket->node.value = bucket;
+    list_insert_node(&sampleBuckets, &bucket->node);
+    uv_timer_init(mainLoop, bucket->timer);
+    bucket->timer->data = bucket;
+    uv_timer_start(bucket->timer, sampleTimer, interval, interval);
+    return bucket;
+}
+
+// Keeps the value until the next tick of the interval, a newer value
+// replaces it. Returns 0 if the value can't be sampled.
+static uint8_t sampleValue(SubRequester *subReq, SubValue *value) {
+    if (!list_node_in_list(&subReq->sampleNode)) {
+        SampleBucket *bucket = getSampleBucket(subReq->filter.interval);
+        if (!bucket) {
+            return 0;
+        }
+        subReq->sampleNode.value = subReq;
+        list_insert_node(&bucket->subs, &subReq->sampleNode);
+    }
+    broker_sub_value_ref(value);
+    broker_sub_value_unref(subReq->sampledValue);
+    subReq->sampledValue = value;
+    return 1;
+}
+
 static
 int broker_update_sub_reqs(BrokerSubStream *stream, json_t *responder_msg_id) {
   int result = 1;
 
   dslink_map_foreach(&stream->reqSubs) {
     SubRequester *req = entry->value->data;
-    result &= broker_update_sub_req(req, stream->last_value);
+    // sampled values are filtered on the tick
+    if (req->filter.interval > 0 && sampleValue(req, stream->last_value)) {
+      continue;
+    }
+    if (!broker_sub_filter_pass(req, stream->last_value)) {
+      continue;
+    }
+    result &= broker_update_sub_req_value(req, stream->last_value);
     if ( !result && responder_msg_id ) {
       json_decref(stream->last_pending_responder_msg_id);
       stream->last_pending_responder_msg_id = json_incref(responder_msg_id);
@@ -369,30 +889,37 @@ int broker_update_sub_reqs(BrokerSubStream *stream, json_t *responder_msg_id) {
   return result;
 }
 int broker_update_sub_stream(BrokerSubStream *stream, json_t *varray, json_t *responder_msg_id) {
-    json_decref(stream->last_value);
-    stream->last_value = varray;
-    json_incref(varray);
+    // one record shared by all subscriptions of the stream
+    SubValue *value = broker_sub_value_create(varray);
+    if (!value) {
+        return 0;
+    }
+    broker_sub_value_unref(stream->last_value);
+    stream->last_value = value;
     return broker_update_sub_reqs(stream, responder_msg_id);
 }
 
 int broker_update_sub_stream_value(BrokerSubStream *stream, json_t *value, json_t *ts, json_t *responder_msg_id) {
-    json_decref(stream->last_value);
     json_t *varray = json_array();
     json_array_append(varray, json_null());
     json_array_append(varray, value);
 
-    if (!ts) {
-        // create ts and
-        char tsbuff[30];
-        dslink_create_ts(tsbuff, 30);
-        ts = json_string_nocheck(tsbuff);
-        json_array_append_new(varray, ts);
+    if (!ts || json_is_integer(ts)) {
+        // create ts, or format the numeric one we got
+        char tsbuff[32];
+        if (ts) {
+            dslink_format_ts(tsbuff, sizeof(tsbuff), json_integer_value(ts));
+        } else {
+            dslink_create_ts_cached(tsbuff, sizeof(tsbuff));
+        }
+        json_array_append_new(varray, json_string_nocheck(tsbuff));
     } else {
         json_array_append(varray, ts);
     }
 
-    stream->last_value = varray;
-    return broker_update_sub_reqs(stream, responder_msg_id);
+    int result = broker_update_sub_stream(stream, varray, responder_msg_id);
+    json_decref(varray);
+    return result;
 }
 
 void broker_update_stream_qos(BrokerSubStream *stream) {
@@ -419,17 +946,22 @@ void broker_update_sub_qos(SubRequester *req, uint8_t qos) {
         uint8_t oldqos = req->qos;
         req->qos = qos;
         if (oldqos ==3 && qos != 3) {
-            // delete qos file
+            // delete qos file and the log
             serialize_qos_queue(req, 1);
+            closeQosLog(req, 1);
         }
 
-        if (req->qos > 0 && !(req->qosQueue)) {
-            req->qosQueue = json_array();
-        }
         broker_update_stream_qos(req->stream);
         if (qos == 3 && oldqos != 3) {
             // save qos file
+            openQosLog(req);
             serialize_qos_queue(req, 0);
         }
+        if (qos > 1 && req->pendingValue) {
+            // the conflated value goes into the queue of the new qos
+            SubValue *value = takePendingValue(req);
+            broker_update_sub_req_value(req, value);
+            broker_sub_value_unref(value);
+        }
     }
 }
@@ -3,6 +3,7 @@
 #include <broker/broker.h>
 #include <broker/utils.h>
 #include <broker/subscription.h>
+#include <broker/qos_log.h>
 #include <broker/msg/msg_invoke.h>
 #include <broker/net/ws.h>
 
@@ -17,7 +18,10 @@ static void add_subscriptions(DownstreamNode *node, json_t* array)
     json_array_append_new(subscriptionRow,  json_integer(subRequester->qos));
 
     if ( subRequester->messageQueue ) {
-      uint32_t queueSize = rb_count( subRequester->messageQueue );
+      uint64_t queueSize = rb_count( subRequester->messageQueue );
+      if ( subRequester->spill ) {
+        queueSize += broker_qos_log_size( subRequester->spill );
+      }
       
       uint32_t pendingAcks;
       for ( pendingAcks = 0; pendingAcks < subRequester->messageQueue->count; ++pendingAcks ) {
@@ -28,9 +32,13 @@ static void add_subscriptions(DownstreamNode *node, json_t* array)
       }
       json_array_append_new(subscriptionRow,  json_integer(queueSize));
       json_array_append_new(subscriptionRow,  json_integer(pendingAcks));
-    } else if (subRequester->qosQueue) {
-      json_array_append_new(subscriptionRow,  json_integer(json_array_size(subRequester->qosQueue)));
-      json_array_append_new(subscriptionRow,  json_null());
+    } else if (subRequester->qos <= 1) {
+      // a conflated value at most
+      json_array_append_new(subscriptionRow,  json_integer(subRequester->pendingValue ? 1 : 0));
+      json_array_append_new(subscriptionRow,  json_integer(subRequester->messageOutputQueueCount));
+    } else if (subRequester->qosLog) {
+      json_array_append_new(subscriptionRow,  json_integer(broker_qos_log_size(subRequester->qosLog)));
+      json_array_append_new(subscriptionRow,  json_integer(subRequester->messageOutputQueueCount));
 
     } else {
       json_array_append_new(subscriptionRow,  json_integer(0));
@@ -0,0 +1,49 @@
+#include <broker/sys/resync.h>
+
+#include <broker/node.h>
+
+static BrokerNode *pendingStreams;
+static BrokerNode *resyncedStreams;
+static BrokerNode *lastResyncDuration;
+
+static int64_t pending = 0;
+static uint64_t resynced = 0;
+
+static
+BrokerNode *create_number_node(struct BrokerNode *sysNode, const char *name,
+                               json_t *value) {
+    BrokerNode *node = broker_node_create(name, "node");
+    json_object_set_new_nocheck(node->meta, "$type", json_string_nocheck("number"));
+    broker_node_add(sysNode, node);
+    broker_node_update_value(node, value, 1);
+    return node;
+}
+
+int init_resync(struct BrokerNode *sysNode) {
+    pendingStreams = create_number_node(sysNode, "resyncPendingStreams", json_integer(0));
+    resyncedStreams = create_number_node(sysNode, "resyncedStreams", json_integer(0));
+    lastResyncDuration = create_number_node(sysNode, "lastResyncDuration", json_null());
+    json_object_set_new_nocheck(lastResyncDuration->meta, "@unit", json_string_nocheck("ms"));
+    return 0;
+}
+
+void resync_add_pending(int64_t streams) {
+    pending += streams;
+    if (pendingStreams) {
+        broker_node_update_value(pendingStreams, json_integer(pending), 1);
+    }
+}
+
+void resync_add_done(uint64_t streams) {
+    resynced += streams;
+    resync_add_pending(-(int64_t) streams);
+    if (resyncedStreams) {
+        broker_node_update_value(resyncedStreams, json_integer((json_int_t) resynced), 1);
+    }
+}
+
+void resync_finished(uint64_t ms) {
+    if (lastResyncDuration) {
+        broker_node_update_value(lastResyncDuration, json_integer((json_int_t) ms), 1);
+    }
+}
@@ -1,5 +1,6 @@
 #include <broker/sys/permission_action.h>
 #include <broker/sys/throughput.h>
+#include <broker/sys/resync.h>
 #include "broker/global.h"
 #include "broker/query/query.h"
 #include "broker/sys/sys.h"
@@ -191,6 +192,7 @@ int broker_sys_node_populate(BrokerNode *sysNode) {
     init_set_log_level(sysNode);
     init_permissions_actions(sysNode);
     init_throughput(sysNode);
+    init_resync(sysNode);
     init_inspect(sysNode);
 
     return 0;
@@ -13,6 +13,7 @@
 #include <broker/upstream/upstream_node.h>
 #include <broker/handshake.h>
 #include <broker/utils.h>
+#include <broker/subscription.h>
 #include <string.h>
 #include <mbedtls/net.h>
 
@@ -130,6 +131,9 @@ void upstream_io_handler(uv_poll_t *poll, int status, int events) {
             uv_poll_start(poll, UV_READABLE | UV_WRITABLE | UV_DISCONNECT, upstream_io_handler);
             int stat = wslay_event_send(upstreamPoll->ws);
             log_debug("upstream_io_handler: write status %d\n", stat );
+            if (stat == 0 && upstreamPoll->remoteDSLink) {
+                broker_send_dirty_subs(upstreamPoll->remoteDSLink);
+            }
             reconnect_if_error_occured(stat, upstreamPoll);
         }
     }
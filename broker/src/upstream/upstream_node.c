@@ -34,46 +34,17 @@ DownstreamNode *create_upstream_node(Broker *broker, const char *name) {
     return node;
 }
 
-void dslink_handle_upstream_ping(uv_timer_t* handle)
-{  
-  UpstreamPoll *upstreamPoll = handle->data;
-  if ( !upstreamPoll ) {
-    return;
-  }
-  
-  RemoteDSLink *link = upstreamPoll->remoteDSLink;
-  if ( !link ) {
-    return;
-  }  
+static
+void upstream_idle_timeout(RemoteDSLink *link) {
+  UpstreamPoll *upstreamPoll = link->node->upstreamPoll;
+  log_info("Disconnecting upstream %s due to missing heartbeat response\n", link->name );
 
-  if (link->lastWriteTime) {
-    struct timeval current_time;
-    gettimeofday(&current_time, NULL);
-    long time_diff = current_time.tv_sec - link->lastWriteTime->tv_sec;
-    if (time_diff >= 60) {
-      log_debug("Send heartbeat to upstream %s\n", link->name );
-      broker_ws_send_obj(link, json_object());
-    }
-  } else {
-    log_debug("Send heartbeat to upstream %s\n", link->name );
-    broker_ws_send_obj(link, json_object());
-  }
-
-  if (link->lastReceiveTime) {
-    struct timeval current_time;
-    gettimeofday(&current_time, NULL);
-    long time_diff = current_time.tv_sec - link->lastReceiveTime->tv_sec;
-    if (time_diff >= 90) {
-      log_info("Disconnecting upstream %s due to missing heartbeat response\n", link->name );
-      
-      if ( link->client && link->client->poll_cb ) {
+  if ( link->client && link->client->poll_cb ) {
 #ifdef ETIMEDOUT
-	(*link->client->poll_cb)(upstreamPoll->wsPoll, -(ETIMEDOUT), UV_DISCONNECT );
+    (*link->client->poll_cb)(upstreamPoll->wsPoll, -(ETIMEDOUT), UV_DISCONNECT );
 #else
-	(*link->client->poll_cb)(upstreamPoll->wsPoll, -32, UV_DISCONNECT );
+    (*link->client->poll_cb)(upstreamPoll->wsPoll, -32, UV_DISCONNECT );
 #endif
-      }
-    }
   }
 }
 
@@ -88,11 +59,7 @@ void init_upstream_node(Broker *broker, UpstreamPoll *upstreamPoll) {
     link->dsId = node->dsId;
     link->node = node;
 
-    uv_timer_t *ping_timer = dslink_malloc(sizeof(uv_timer_t));
-    ping_timer->data = upstreamPoll;
-    uv_timer_init(mainLoop, ping_timer);
-    uv_timer_start(ping_timer, dslink_handle_upstream_ping, 1000, 30000);
-    link->pingTimerHandle = ping_timer;
+    broker_remote_dslink_start_timers(link, upstream_idle_timeout);
 
     // set the ->link and update all existing stream
     broker_dslink_connect(node, link);
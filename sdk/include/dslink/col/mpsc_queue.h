@@ -0,0 +1,61 @@
+#ifndef SDK_DSLINK_C_MPSC_QUEUE_H
+#define SDK_DSLINK_C_MPSC_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "dslink/mem/mem.h"
+
+    /// Defines the structure of a bounded, lock-free multi-producer/single-consumer queue.
+    /// Any thread may push, only one thread may pop. Elements are copied into preallocated slots.
+    typedef struct {
+        uint32_t size;
+        uint32_t mask;
+        size_t element_size;
+        uint32_t head;
+        uint32_t tail;
+        uint32_t idle;
+        uint32_t* seq;
+        void* data;
+    } MpscQueue;
+
+    /// Initializes a queue.
+    /// @param q The queue to initialize
+    /// @param size The element capacity of the queue, must be a power of two
+    /// @param element_size Size of a single element.
+    /// @return 0 if the queue could be initialized successfully, otherwise -1
+    int mpsc_init(MpscQueue* q, uint32_t size, size_t element_size);
+
+    /// Adds a value to the end of the queue. May be called from any thread.
+    /// @param q The queue
+    /// @param data A pointer to the value to add. The value will be copied into the queue.
+    /// @return 1 if the consumer has to be woken up (the queue went from empty to non-empty),
+    /// 0 upon success otherwise, -1 if the queue is full
+    int mpsc_push(MpscQueue* q, const void* data);
+
+    /// Removes the first value of the queue. Must only be called from the consumer thread.
+    /// When the queue is found empty, the next push will request a wake up.
+    /// @param q The queue
+    /// @param data A pointer to the memory the value is copied to
+    /// @return 0 upon success, -1 if the queue is empty
+    int mpsc_pop(MpscQueue* q, void* data);
+
+    /// Checks whether the queue has no readable value. Must only be called from the consumer thread.
+    /// @param q The queue
+    /// @return 1 if the queue is empty, 0 otherwise
+    int mpsc_empty(MpscQueue* q);
+
+    /// Frees the internally allocated memory of the queue. Does not free the memory pointed to by the elements.
+    /// @param q The queue
+    /// @return 0 upon success, -1 otherwise
+    int mpsc_free(MpscQueue* q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SDK_DSLINK_C_MPSC_QUEUE_H
@@ -12,9 +12,11 @@ extern "C" {
 
     typedef void (*rb_cleanup_fn_type)(void *);
 
-    /// Defines the structure of a ringbuffer.
+    /// Defines the structure of a ringbuffer. The memory for the elements grows on demand up to size and is
+    /// shrunk again when the elements are popped, an empty ringbuffer holds no memory.
     typedef struct {
         uint32_t size;
+        uint32_t capacity;
         uint32_t current;
         uint32_t count;
         void* data;
@@ -23,9 +25,9 @@ extern "C" {
     } Ringbuffer;
 
 
-    /// Initializes a ringbuffer.
+    /// Initializes a ringbuffer, no memory is allocated until the first push.
     /// @param rb The ringbuffer to initialize
-    /// @param size The initial element capacity of the ringbuffer
+    /// @param size The maximum element count of the ringbuffer
     /// @param element_size Size of a single element.
     /// @param cleanup_fn
     /// @return 0 if the ringbuffer could be initialized successfully, otherwise -1
@@ -43,6 +45,8 @@ extern "C" {
     /// @return 0 upon success, -1 otherwise, 1 is returned, if a previously added value was overwritten
     int rb_push(Ringbuffer* rb, void* data);
 
+    /// Pointers to the values are invalidated by rb_push and rb_pop, which may move the values.
+
     /// Gets the first value of the ringbuffer.
     /// @param rb The ringbuffer
     /// @return A pointer to the value or NULL if the ringbuffer has no values
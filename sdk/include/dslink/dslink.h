@@ -11,6 +11,7 @@ extern "C" {
 #include "socket.h"
 #include "node.h"
 #include "url.h"
+#include "timer_wheel.h"
 
 typedef struct DSLinkCallbacks DSLinkCallbacks;
 typedef struct DSLinkConfig DSLinkConfig;
@@ -28,6 +29,32 @@ struct DSLinkConfig {
     Url *broker_url;
     const char *name;
     const char *token;
+
+    // Reconnect backoff in milliseconds, see dslink_backoff_delay
+    long reconnect_delay; // initial backoff window
+    long reconnect_max_delay; // cap of the backoff window
+    long reconnect_stable_time; // connection uptime that resets the backoff
+
+    // Keep the node tree, the requester's value subscriptions and the user
+    // state across reconnects. Only the streams and subscriptions of the
+    // connection are dropped and init_cb is only called once. So is
+    // on_requester_ready_cb, the value subscriptions made in it are sent
+    // again on every connection, list and invoke streams aren't.
+    uint8_t keep_state_on_reconnect;
+
+    // Limits of the messages (and their bytes) sent to the broker, but not
+    // acked yet, 0 for no limit. See send_window.h
+    uint32_t send_window;
+    size_t send_window_bytes;
+    // Bytes held back while the window is full, before they are sent past
+    // it. 0 for DSLINK_SEND_WINDOW_HELD_BYTES
+    size_t send_window_held_bytes;
+
+    // Delay in milliseconds before received messages are acked. Acks are
+    // cumulative, only the last msg id is sent and it is piggybacked on
+    // outgoing messages. 0 acks once per loop iteration, a negative value
+    // acks every message right away.
+    long ack_delay;
 };
 
 struct DSLink {
@@ -40,12 +67,27 @@ struct DSLink {
     struct wslay_event_context *_ws; // Event context for WSLay
     Socket *_socket; // Socket for the _ws connection
     struct timeval lastReceiveTime;
+    uint64_t connected_time; // uv_hrtime() in ms of the last successful connect, 0 if none
+    long retry_after; // Retry-After hint of the broker in ms, 0 if none
 
     Requester *requester;
     Responder *responder; // Responder, only initialized for responder DSLinks
     mbedtls_ecdh_context key; // ECDH key
     uv_loop_t loop; // Primary event loop
     uv_async_t async_tasks; // async run
+    struct DSNodeValueSlot *dirty_value_slots; // conflated updates from other threads
+    struct DSLinkSendWindow *send_window; // flow control, NULL if disabled
+    uint32_t pending_ack; // msg id to ack, 0 if none
+    uv_timer_t *ack_timer;
+    Map *list_changes; // path of a listed node to the json object of changed names
+    uv_timer_t *list_timer; // flushes list_changes once per loop iteration
+    uint32_t list_building; // nesting of dslink_node_build_begin
+    uint64_t queued_total; // bytes ever queued in the websocket, see writable.h
+    struct DSLinkWritable *writable; // writable callbacks, NULL if none
+    uint64_t last_send_time; // uv_now() of the last message sent, pings are skipped while sending
+    struct DSLinkTimerWheel *timer_wheel; // ping and idle timers of the connection
+    DSLinkTimer ping_timer;
+    DSLinkTimer idle_timer;
     uv_poll_t*  poll;
     DSLinkConfig config; // Configuration
     uint32_t *msg;
@@ -71,6 +113,10 @@ struct Responder {
     // Key is the SID of the subscription, the value must be a string
     // which is the path of the node.
     Map *value_sid_subs;
+
+    // Retired value snapshots of the nodes, created by the first node
+    // enabling snapshots. See value_snapshot.h
+    struct DSNodeValueSnapshots *snapshots;
 };
 
 struct Requester {
@@ -81,6 +127,8 @@ struct Requester {
     // Map<uint32*, Stream*>
     Map *open_streams;
     Map *value_handlers;
+    // on_requester_ready_cb was called for the requester
+    uint8_t ready;
 };
 
 struct DSLinkCallbacks {
@@ -100,6 +148,12 @@ json_t *dslink_json_get_config(DSLink *link, const char *key);
 
 void dslink_close(DSLink *link);
 
+// Frees the state of a single connection, called before every reconnect.
+// The responder, the requester, the link's writable callback and the link
+// data are kept, the link data is only freed with the link.
+void dslink_link_clear(DSLink *link);
+void dslink_link_free(DSLink *link);
+
 int dslink_handle_key(DSLink *link);
 
 // Save the current state of the link. 
@@ -113,6 +167,14 @@ int dslink_save_nodes(DSLink *link);
 int dslink_load_nodes(DSLink *link);
 
 // Thread-safe API
+
+// Sets up the task queue of the thread-safe API on link->loop, called by dslink_init.
+// Tasks are passed through a bounded lock-free queue, the loop is only woken up when
+// the queue goes from empty to non-empty.
+int dslink_async_tasks_init(DSLink *link);
+// Frees the task queue, the async_tasks handle must be closed already.
+void dslink_async_tasks_free(DSLink *link);
+
 /*
  * @param path           path to the node
  * @param callback       a callback when the update is done, will be called from dslink's thread, parameters pass back in the callback will be (error, callback_data)
@@ -121,6 +183,19 @@ int dslink_load_nodes(DSLink *link);
 int dslink_node_update_value_safe(struct DSLink *link, char* path, json_t *value,  async_set_callback callback, void * callback_data);
 
 /*
+ * Batch counterpart of dslink_node_update_value_safe. All values are applied in a single
+ * task on the dslink's thread and subscribed values are sent in one message.
+ *
+ * @param paths          array of count node paths, ownership of the strings is taken
+ * @param values         array of count values, the references are stolen
+ * @param callback       a callback when the batch is done, will be called from dslink's thread, parameters pass back in the callback will be (error, callback_data)
+ * @param callback_data  a data that will be passed back to callback
+ */
+int dslink_node_update_values_safe(struct DSLink *link, char **paths, json_t **values, size_t count, async_set_callback callback, void * callback_data);
+
+/*
+ * For frequent reads see value_snapshot.h, which avoids the round-trip through the loop.
+ *
  * @param path           path to the node
  * @param callback       a callback when the update is done, will be called from dslink's thread, parameters pass back in the callback will be (value, callback_data)
  * @param callback_data  a data that will be passed back to callback
@@ -34,6 +34,9 @@ int dslink_generate_dsid(mbedtls_ecdh_context *key, const char* name, char **dsI
 char *dslink_handshake_generate_req(DSLink *link, char **dsId);
 int dslink_parse_handshake_response(const char *resp,
                                     json_t **handshake);
+// Returns the Retry-After hint of a /conn response in milliseconds,
+// or 0 if the broker didn't send one.
+long dslink_handshake_retry_after(const char *resp);
 int dslink_handshake_generate(DSLink *link,
                               json_t **handshake,
                               char **dsId);
@@ -8,11 +8,37 @@ extern "C" {
 #include <jansson.h>
 #include "dslink/dslink.h"
 
+// Serialized "updates" of a list response, shared by all list requests
+// of the node while version equals the list_version of the node.
+typedef struct DSNodeListCache {
+    uint32_t version;
+    size_t len;
+    char *data;
+} DSNodeListCache;
+
 int dslink_response_list(DSLink *link, json_t *req, DSNode *node);
 
+// Returns the serialized list payload of node, rebuilt only if the node
+// changed since the last call. The cache is owned by the node.
+DSNodeListCache *dslink_response_list_payload(DSNode *node);
+void dslink_response_list_cache_free(DSNode *node);
+
 int dslink_response_list_append_child(json_t *update, DSNode *child);
+// Returns 1 if the meta value name of a child is part of its entry in the
+// list of the parent.
+int dslink_response_list_summary_key(const char *name);
 void dslink_response_list_append_meta(json_t *obj, Map *meta, const char *name);
 
+// Records that the child or meta value name of node changed. Changes are
+// collected per list stream and sent as one update once per loop iteration,
+// the update carries the state of the node at that time, so a value
+// changed many times is only sent once.
+int dslink_response_list_changed(DSLink *link, DSNode *node, const char *name);
+
+// Sends the collected list changes unless the link is building nodes,
+// see dslink_node_build_begin.
+void dslink_response_list_flush(DSLink *link);
+
 #ifdef __cplusplus
 }
 #endif
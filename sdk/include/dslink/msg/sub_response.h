@@ -15,6 +15,15 @@ void dslink_response_send_val(DSLink *link,
                               DSNode *node,
                               uint32_t sid);
 
+// Creates an empty {"responses":[{"rid":0,"updates":[]}]} message and
+// points updates at its updates array.
+json_t *dslink_response_updates_new(json_t **updates);
+
+// Appends [sid, value, ts] of the node to an updates array.
+int dslink_response_updates_append(json_t *updates,
+                                   DSNode *node,
+                                   uint32_t sid);
+
 #ifdef __cplusplus
 }
 #endif
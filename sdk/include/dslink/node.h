@@ -12,6 +12,9 @@ struct DSLink;
 
 struct DSNode;
 typedef struct DSNode DSNode;
+struct DSNodeValueSnapshot;
+struct DSNodeValueSnapshots;
+struct DSNodeRateLimit;
 
 typedef void (*node_event_cb)(struct DSLink *link, DSNode *node);
 typedef void (*node_value_set_cb)(struct DSLink *link, DSNode *node, json_t *value);
@@ -69,6 +72,20 @@ struct DSNode {
     ref_t *data;
 
     uint8_t serializable;
+
+    // Latest value snapshot for other threads, see value_snapshot.h.
+    // Snapshots are published while the node refers to the snapshots of
+    // its responder.
+    struct DSNodeValueSnapshot *snapshot;
+    struct DSNodeValueSnapshots *snapshots;
+
+    // Rate limit of the value updates, see rate_limit.h
+    struct DSNodeRateLimit *rate_limit;
+
+    // Bumped on every child or meta change made through the node API,
+    // the serialized list payload is only rebuilt when it changed.
+    uint32_t list_version;
+    struct DSNodeListCache *list_cache;
 };
 
 DSNode *dslink_node_create(DSNode *parent,
@@ -93,6 +110,38 @@ int dslink_node_set_value(struct DSLink *link, DSNode *node, json_t *value);
 int dslink_node_update_value(struct DSLink *link, DSNode *node, json_t *value);
 int dslink_node_update_value_new(struct DSLink *link, DSNode *node, json_t *value);
 
+// Like dslink_node_update_value_new, but takes the timestamp from the caller.
+// ts may be a pre-formatted string, an integer holding milliseconds since the
+// epoch or NULL for the current time. Steals the references to value and ts.
+int dslink_node_update_value_ts(struct DSLink *link, DSNode *node,
+                                json_t *value, json_t *ts);
+
+// Collects the value updates of many nodes into a single "updates" message.
+// Values and callbacks are applied to the nodes immediately, the message is
+// only sent on commit.
+typedef struct DSNodeUpdateBatch {
+    struct DSLink *link;
+    json_t *top;
+    json_t *updates;
+} DSNodeUpdateBatch;
+
+void dslink_node_update_batch_begin(struct DSLink *link,
+                                    DSNodeUpdateBatch *batch);
+// Steals the references to value and ts, see dslink_node_update_value_ts.
+int dslink_node_update_batch_add(DSNodeUpdateBatch *batch, DSNode *node,
+                                 json_t *value, json_t *ts);
+int dslink_node_update_batch_commit(DSNodeUpdateBatch *batch);
+
+// Updates count nodes at once, stealing the references to the values.
+int dslink_node_update_values(struct DSLink *link, DSNode **nodes,
+                              json_t **values, size_t count);
+
+// Holds back the list updates of added, removed and changed nodes until
+// the matching dslink_node_build_end, so a subtree built by many calls is
+// announced to the list streams as a whole. Calls may nest.
+void dslink_node_build_begin(struct DSLink *link);
+void dslink_node_build_end(struct DSLink *link);
+
 json_t *dslink_node_serialize(struct DSLink *link, DSNode *node);
 void dslink_node_deserialize(struct DSLink *link, DSNode *node, json_t *data);
 
@@ -0,0 +1,73 @@
+#ifndef SDK_DSLINK_C_RATE_LIMIT_H
+#define SDK_DSLINK_C_RATE_LIMIT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <uv.h>
+
+#include "dslink/dslink.h"
+
+// Limits the rate of the value updates sent to the subscriber of a node.
+// Updates arriving within the min interval of the last sent update are
+// conflated, only the newest value is sent once the interval has passed.
+// With a settle time, the pending value is held past the interval until the
+// node didn't change for that long, at most for another settle time, so the
+// final value of a burst is sent rather than one in the middle of it. The
+// value of the node itself is always updated.
+typedef struct DSNodeRateLimit {
+    uv_timer_t timer;
+    DSLink *link;
+    DSNode *node;
+
+    uint32_t min_interval;
+    uint32_t settle;
+
+    // Loop times in milliseconds
+    uint64_t last_sent;
+    uint64_t last_update;
+    uint8_t pending;
+
+    // Updates replaced by a newer value before they were sent
+    uint64_t conflated;
+} DSNodeRateLimit;
+
+// Sends at most one update of the node per min_interval milliseconds,
+// settle is the quiet time in milliseconds a pending update waits for once
+// the interval has passed, 0 to send it right at the interval. A min_interval
+// of 0 turns the limit off and sends a pending update. Must be called from
+// the dslink's thread.
+int dslink_node_set_rate_limit(DSLink *link, DSNode *node,
+                               uint32_t min_interval, uint32_t settle);
+
+// Sends at most max_rate updates of the node per second. A max_rate of 0
+// or less turns the limit off, one above 1000 is limited to an update per
+// millisecond.
+static inline
+int dslink_node_set_max_rate(DSLink *link, DSNode *node,
+                             double max_rate, uint32_t settle) {
+    uint32_t interval = 0;
+    if (max_rate > 1000) {
+        interval = 1;
+    } else if (max_rate > 1000.0 / UINT32_MAX) {
+        interval = (uint32_t) (1000 / max_rate);
+    } else if (max_rate > 0) {
+        interval = UINT32_MAX;
+    }
+    return dslink_node_set_rate_limit(link, node, interval, settle);
+}
+
+// Called for every value update of a subscribed node, returns 1 if the
+// update is held back and sent later, 0 if it has to be sent now.
+int dslink_node_rate_limit_hold(DSLink *link, DSNode *node);
+
+// Frees the rate limit of a node, a pending update is dropped.
+void dslink_node_rate_limit_free(DSNode *node);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SDK_DSLINK_C_RATE_LIMIT_H
@@ -16,6 +16,9 @@ typedef struct RequestHolder {
 
 typedef struct SubscribeCallbackHolder {
     value_sub_cb cb;
+    // Used to subscribe again after a reconnect
+    char *path;
+    int qos;
 } SubscribeCallbackHolder;
 
 /*
@@ -31,4 +34,11 @@ ref_t* dslink_requester_invoke(DSLink *link, const char *path, json_t *params, r
 int dslink_requester_invoke_update_params(DSLink *link, uint32_t rid, json_t *params);
 int dslink_requester_close(DSLink *link, uint32_t rid);
 
+/*
+ * Sends a single subscribe request for all value subscriptions of the
+ * requester, keeping their sids. Used when the link reconnected with
+ * keep_state_on_reconnect set.
+ */
+int dslink_requester_resubscribe(DSLink *link);
+
 #endif //SDK_DSLINK_C_REQUESTER_H
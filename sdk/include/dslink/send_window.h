@@ -0,0 +1,72 @@
+#ifndef SDK_DSLINK_C_SEND_WINDOW_H
+#define SDK_DSLINK_C_SEND_WINDOW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <jansson.h>
+
+#include "dslink/dslink.h"
+
+#define DSLINK_SEND_WINDOW_CHUNK_BYTES (64 * 1024)
+#define DSLINK_SEND_WINDOW_HELD_BYTES (1024 * 1024)
+
+// Ack driven flow control of the messages sent to the broker. Messages
+// carrying requests or responses stay in flight until the broker acks
+// their msg id. While the window is full, value updates are conflated per
+// sid and all other responses and requests are held back in order. Once
+// acks open the window again, they are sent in messages of at most
+// config.send_window_bytes (DSLINK_SEND_WINDOW_CHUNK_BYTES without a byte
+// limit) until the window is full again. The updates held are bounded by
+// the number of subscribed sids instead of the update rate, the other
+// messages by config.send_window_held_bytes. Beyond it they are sent past
+// the window and only the writable callbacks of the link hold back the
+// producers, see writable.h.
+typedef struct DSLinkSendWindow DSLinkSendWindow;
+
+typedef struct DSLinkSendWindowStats {
+    // Messages and bytes sent, but not acked yet
+    uint32_t in_flight;
+    size_t in_flight_bytes;
+    // High-water mark of in_flight
+    uint32_t max_in_flight;
+
+    // Responses and requests held back right now, and their encoded size
+    size_t held;
+    size_t held_bytes;
+    // Sids with a conflated update waiting to be sent
+    size_t pending_updates;
+
+    // Number of times the window got full
+    uint64_t stalls;
+    // Updates replaced by a newer update of the same sid
+    uint64_t conflated;
+    // Messages sent past the full window, as held_bytes hit the limit
+    uint64_t overflows;
+} DSLinkSendWindowStats;
+
+// Creates the window of link, limited by config.send_window (messages)
+// and config.send_window_bytes. Does nothing if both are 0.
+int dslink_send_window_init(DSLink *link);
+void dslink_send_window_free(DSLink *link);
+
+// Returns 1 if obj was taken over by the window, 0 if it has to be sent
+// now. The references of obj aren't stolen.
+int dslink_send_window_hold(DSLink *link, json_t *obj);
+void dslink_send_window_sent(DSLink *link, uint32_t msg, size_t bytes);
+// Acks all messages up to msg and sends what was held back if the
+// window has room again.
+void dslink_send_window_ack(DSLink *link, uint32_t msg);
+
+int dslink_send_window_full(DSLink *link);
+// Returns 1 if a message sent now would be held back.
+int dslink_send_window_blocked(DSLink *link);
+void dslink_send_window_stats(DSLink *link, DSLinkSendWindowStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SDK_DSLINK_C_SEND_WINDOW_H
@@ -20,6 +20,10 @@ typedef struct Stream {
     dslink_stream_close_cb on_close;
     int unused;
     void *data;
+
+    uint32_t rid;
+    // Bytes of the stream queued in the connection, see writable.h
+    struct DSStreamWritable *writable;
 } Stream;
 
 #ifdef __cplusplus
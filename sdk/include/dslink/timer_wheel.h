@@ -0,0 +1,85 @@
+#ifndef SDK_DSLINK_C_TIMER_WHEEL_H
+#define SDK_DSLINK_C_TIMER_WHEEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <uv.h>
+
+// A hierarchical timer wheel for coarse per-link timers like pings, idle
+// timeouts and handshake deadlines. All timers of a wheel are driven by a
+// single uv_timer, arming and stopping a timer is O(1) and doesn't touch
+// the libuv timer heap. Timers fire with the granularity of the tick.
+#define DSLINK_TIMER_WHEEL_BITS 6
+#define DSLINK_TIMER_WHEEL_SIZE (1 << DSLINK_TIMER_WHEEL_BITS)
+#define DSLINK_TIMER_WHEEL_LEVELS 4
+
+typedef struct DSLinkTimer DSLinkTimer;
+typedef struct DSLinkTimerWheel DSLinkTimerWheel;
+
+typedef void (*dslink_timer_cb)(DSLinkTimer *timer);
+
+struct DSLinkTimer {
+    DSLinkTimer *next;
+    // Points to the slot or the next pointer of the previous timer,
+    // NULL while the timer isn't armed.
+    DSLinkTimer **pprev;
+    DSLinkTimerWheel *wheel;
+
+    // Tick the timer fires at.
+    uint64_t expire;
+    // Repeat interval in milliseconds, 0 for a one-shot timer.
+    uint64_t repeat;
+
+    dslink_timer_cb cb;
+    void *data;
+};
+
+struct DSLinkTimerWheel {
+    uv_timer_t handle;
+
+    // Milliseconds per tick.
+    uint64_t tick;
+    // Loop time the wheel was started at, ticks count from here.
+    uint64_t start;
+    // Latest loop time the wheel was run at.
+    uint64_t time;
+    // Next tick to run.
+    uint64_t now;
+    // Number of armed timers, the uv_timer only runs while there are any.
+    uint32_t count;
+
+    DSLinkTimer *slots[DSLINK_TIMER_WHEEL_LEVELS][DSLINK_TIMER_WHEEL_SIZE];
+};
+
+int dslink_timer_wheel_init(DSLinkTimerWheel *wheel, uv_loop_t *loop,
+                            uint64_t tick);
+
+// Stops all timers of the wheel and closes its uv_timer. The memory of the
+// wheel must stay valid until close_cb is called.
+void dslink_timer_wheel_close(DSLinkTimerWheel *wheel, uv_close_cb close_cb);
+
+// Runs all timers due at the loop time now. Called by the uv_timer of the
+// wheel, exposed for tests.
+void dslink_timer_wheel_run(DSLinkTimerWheel *wheel, uint64_t now);
+
+void dslink_timer_init(DSLinkTimer *timer, dslink_timer_cb cb, void *data);
+
+// Arms the timer to fire after timeout milliseconds and then every repeat
+// milliseconds if repeat isn't 0. An armed timer is re-armed.
+void dslink_timer_start(DSLinkTimerWheel *wheel, DSLinkTimer *timer,
+                        uint64_t timeout, uint64_t repeat);
+void dslink_timer_stop(DSLinkTimer *timer);
+
+static inline
+int dslink_timer_is_active(const DSLinkTimer *timer) {
+    return timer->pprev != NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SDK_DSLINK_C_TIMER_WHEEL_H
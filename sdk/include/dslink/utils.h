@@ -6,6 +6,7 @@ extern "C" {
 #endif
 
 #include <stdlib.h>
+#include <stdint.h>
 
 #define DSLINK_CHECKED_EXEC(func, val) \
     if (val) func(val)
@@ -21,10 +22,28 @@ char *dslink_str_replace_all(const char *haystack,
 char *dslink_str_escape(const char *data);
 char *dslink_str_unescape(const char *data);
 
+// Length of a timestamp as produced by dslink_create_ts, without the
+// terminating null byte, e.g. "2017-01-01T00:00:00.000+00:00".
+#define DSLINK_TS_LEN 29
+
 size_t dslink_create_ts(char *buf, size_t bufLen);
 
+// Same output as dslink_create_ts, but the date/time/zone part is only
+// re-formatted when the second changes, only the milliseconds are patched
+// for updates inside the same second. bufLen must be > DSLINK_TS_LEN.
+size_t dslink_create_ts_cached(char *buf, size_t bufLen);
+
+// Formats a numeric timestamp (milliseconds since the epoch) the same way,
+// sharing the per thread cache. Returns 0 if the buffer is too small.
+size_t dslink_format_ts(char *buf, size_t bufLen, int64_t millis);
+
 int dslink_sleep(long ms);
 
+// Exponential backoff with full jitter: picks a delay in [0, window] where
+// window = base * 2^attempt, capped at cap. rnd is any uniformly
+// distributed random number.
+long dslink_backoff_delay(uint32_t attempt, long base, long cap, uint32_t rnd);
+
 const char* dslink_checkIpv4Address(const char* address);
 const char* dslink_checkIpv6Address(const char* address);
 int dslink_isipv6address(const char* host);
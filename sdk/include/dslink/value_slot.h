@@ -0,0 +1,74 @@
+#ifndef SDK_DSLINK_C_VALUE_SLOT_H
+#define SDK_DSLINK_C_VALUE_SLOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <jansson.h>
+
+#include "dslink/dslink.h"
+
+// A conflating last-value slot of a node, for producer threads that update
+// the same nodes at a high rate. Producers overwrite the pending value of
+// the slot, the loop publishes only the latest value of each dirty slot.
+// Memory is bounded by the number of slots, not by the update rate.
+typedef struct DSNodeValueSlot DSNodeValueSlot;
+
+typedef enum {
+    DSLINK_SLOT_NONE = 0,
+    DSLINK_SLOT_BOOL,
+    DSLINK_SLOT_INT,
+    DSLINK_SLOT_DOUBLE,
+    DSLINK_SLOT_JSON
+} DSNodeValueSlotType;
+
+struct DSNodeValueSlot {
+    DSLink *link;
+    DSNode *node;
+
+    // Sequence word, odd while a thread writes the slot.
+    uint32_t seq;
+    uint8_t type;
+    union {
+        int64_t i;
+        double d;
+        json_t *json;
+    } value;
+    // Milliseconds since the epoch of the last write.
+    int64_t ts;
+
+    // Sequence of the last value published by the loop.
+    uint32_t published;
+
+    // Set while the slot is on the dirty list of the link.
+    uint32_t dirty;
+    uint8_t released;
+    DSNodeValueSlot *next_dirty;
+};
+
+// Creates a slot for the node. Must be called from the dslink's thread.
+DSNodeValueSlot *dslink_node_value_slot_create(DSLink *link, DSNode *node);
+
+// Frees the slot. Must be called from the dslink's thread after all
+// producers stopped using the slot, a pending value is dropped.
+void dslink_node_value_slot_free(DSNodeValueSlot *slot);
+
+// Set the pending value of the slot, may be called from any thread.
+// The loop is only woken up if no other slot was dirty.
+int dslink_node_value_slot_set_bool(DSNodeValueSlot *slot, int value);
+int dslink_node_value_slot_set_int(DSNodeValueSlot *slot, int64_t value);
+int dslink_node_value_slot_set_double(DSNodeValueSlot *slot, double value);
+// Steals the reference to value.
+int dslink_node_value_slot_set_json(DSNodeValueSlot *slot, json_t *value);
+
+// Publishes the latest value of every dirty slot in one updates message.
+// Called by the loop when it is woken up by the thread-safe API.
+void dslink_node_value_slots_drain(DSLink *link);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SDK_DSLINK_C_VALUE_SLOT_H
@@ -0,0 +1,70 @@
+#ifndef SDK_DSLINK_C_VALUE_SNAPSHOT_H
+#define SDK_DSLINK_C_VALUE_SNAPSHOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <jansson.h>
+
+#include "dslink/node.h"
+#include "dslink/col/vector.h"
+
+struct DSLink;
+
+// An immutable snapshot of a node's value and timestamp, published by the
+// dslink's thread on every value update of nodes that enabled snapshots.
+// Other threads can read the latest value without a round-trip through the
+// loop and without copying it. The json values of a snapshot are shared
+// with the loop, readers must neither modify them nor change their
+// reference count, and hold the snapshot instead.
+typedef struct DSNodeValueSnapshot {
+    uint32_t refs;
+    json_t *value;
+    json_t *ts;
+} DSNodeValueSnapshot;
+
+// Snapshots of a responder replaced by the loop. They are retired and only
+// freed once nobody holds a reference and no reader is between loading a
+// node's snapshot pointer and taking its reference. Everything but the
+// reader count and the reference counts is only touched by the loop.
+typedef struct DSNodeValueSnapshots {
+    uint32_t readers;
+    Vector retired;
+} DSNodeValueSnapshots;
+
+// Starts publishing snapshots of the node's value, the node has to belong
+// to the link's responder. Must be called from the dslink's thread.
+int dslink_node_value_snapshot_enable(struct DSLink *link, DSNode *node);
+
+// Returns a reference to the latest snapshot of the node or NULL if none was
+// published. May be called from any thread, never blocks the loop. The node
+// must stay alive while this is called.
+DSNodeValueSnapshot *dslink_node_value_snapshot_acquire(DSNode *node);
+
+// Releases a reference returned by dslink_node_value_snapshot_acquire. May
+// be called from any thread, the memory is reclaimed by the dslink's thread.
+void dslink_node_value_snapshot_release(DSNodeValueSnapshot *snapshot);
+
+// Replaces the snapshot of the node with its current value, called by the
+// dslink's thread when the value changes.
+int dslink_node_value_snapshot_publish(DSNode *node);
+
+// Unpublishes the snapshot of a node that is going to be freed.
+void dslink_node_value_snapshot_retire(DSNode *node);
+
+// Frees retired snapshots of the link's responder that are no longer
+// referenced, returns the number of snapshots still waiting for readers.
+// Runs on every publish.
+size_t dslink_node_value_snapshots_reclaim(struct DSLink *link);
+
+// Frees all retired snapshots of the link's responder once its nodes are
+// gone. Readers must have released their snapshots by then.
+void dslink_node_value_snapshots_free(struct DSLink *link);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SDK_DSLINK_C_VALUE_SNAPSHOT_H
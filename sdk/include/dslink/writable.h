@@ -0,0 +1,93 @@
+#ifndef SDK_DSLINK_C_WRITABLE_H
+#define SDK_DSLINK_C_WRITABLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <jansson.h>
+
+#include "dslink/dslink.h"
+#include "dslink/stream.h"
+
+// Backpressure of the connection. Messages are queued in the websocket
+// until the socket takes them, so a producer that is faster than the
+// connection only grows that queue. A writable callback turns unwritable
+// once the queued bytes reach the high watermark and writable again when
+// they dropped to the low watermark, so producers can pause generating
+// data in between.
+
+typedef void (*link_writable_cb)(DSLink *link, uint8_t writable);
+typedef void (*stream_writable_cb)(DSLink *link, Stream *stream, uint8_t writable);
+
+typedef struct DSLinkWritable {
+    size_t high;
+    size_t low;
+    link_writable_cb cb;
+    uint8_t unwritable;
+
+    // Bytes the socket took so far, see DSLink.queued_total
+    uint64_t sent_total;
+
+    // Streams with a writable callback
+    struct DSStreamWritable *streams;
+} DSLinkWritable;
+
+typedef struct DSStreamWritable {
+    struct DSStreamWritable *next;
+    struct DSStreamWritable **pprev;
+    DSLink *link;
+    Stream *stream;
+
+    size_t high;
+    size_t low;
+    stream_writable_cb cb;
+    uint8_t unwritable;
+
+    // Bytes of the stream still queued and the end offsets and sizes of
+    // its queued messages, oldest first
+    size_t queued;
+    uint64_t *ends;
+    uint32_t *lens;
+    uint32_t head;
+    uint32_t count;
+    uint32_t capacity;
+} DSStreamWritable;
+
+// Bytes queued in the connection, but not taken by the socket yet.
+size_t dslink_queued_bytes(DSLink *link);
+int dslink_is_writable(DSLink *link);
+
+// Calls cb with 0 once the queued bytes of the link reach high and with 1
+// once they dropped to low again. A high of 0 removes the callback.
+int dslink_set_writable_cb(DSLink *link, size_t high, size_t low,
+                           link_writable_cb cb);
+
+// Like dslink_set_writable_cb for the bytes queued by dslink_stream_send
+// on stream, e.g. the rows of a large invoke result.
+int dslink_stream_set_writable_cb(DSLink *link, Stream *stream,
+                                  size_t high, size_t low,
+                                  stream_writable_cb cb);
+size_t dslink_stream_queued_bytes(Stream *stream);
+int dslink_stream_is_writable(Stream *stream);
+
+// Sends the response resp on the stream, the rid of the stream is added.
+// The references of resp aren't stolen.
+int dslink_stream_send(DSLink *link, Stream *stream, json_t *resp);
+
+// Called whenever the socket took queued data or data was queued.
+void dslink_writable_update(DSLink *link);
+
+// Drops the accounting of the queued bytes of a connection which is
+// gone. The writable callbacks set with dslink_set_writable_cb are kept
+// for the next connection, the ones of the streams are dropped.
+void dslink_writable_reset(DSLink *link);
+void dslink_writable_free(DSLink *link);
+void dslink_stream_writable_free(Stream *stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SDK_DSLINK_C_WRITABLE_H
@@ -24,6 +24,12 @@ int dslink_handshake_connect_ws(Url *url,
 void dslink_handshake_handle_ws(DSLink *link, link_callback on_requester_ready_cb);
 
 int dslink_ws_send_obj(struct wslay_event_context *ctx, json_t *obj);
+// Sends the open stream response rid with an "updates" array that is
+// serialized already, like dslink_ws_send_obj without building the json.
+int dslink_ws_send_updates(struct wslay_event_context *ctx, uint32_t rid,
+                           const char *updates, size_t len);
+// Acks the received message msg, delayed by config.ack_delay.
+void dslink_ws_ack(DSLink *link, uint32_t msg);
 int dslink_ws_send(struct wslay_event_context *ctx,
                    const char *data);
 
@@ -0,0 +1,130 @@
+#include <stdlib.h>
+
+#include "dslink/mem/mem.h"
+#include "dslink/col/mpsc_queue.h"
+
+#include <string.h>
+
+// Every slot carries a sequence number: a slot at position pos is free for a
+// producer when seq == pos and readable for the consumer when seq == pos + 1.
+// Producers claim positions with a CAS on head, the consumer owns tail.
+
+int mpsc_init(MpscQueue* q, uint32_t size, size_t element_size)
+{
+    if(!q) {
+        return -1;
+    }
+    if(size == 0 || (size & (size - 1)) != 0 || element_size == 0) {
+        q->size = 0;
+        return -1;
+    }
+
+    q->seq = dslink_malloc(size * sizeof(uint32_t));
+    q->data = dslink_malloc(size * element_size);
+    if(!q->seq || !q->data) {
+        if(q->seq) {
+            dslink_free(q->seq);
+        }
+        if(q->data) {
+            dslink_free(q->data);
+        }
+        q->size = 0;
+        return -1;
+    }
+
+    for(uint32_t i = 0; i < size; ++i) {
+        q->seq[i] = i;
+    }
+    q->size = size;
+    q->mask = size - 1;
+    q->element_size = element_size;
+    q->head = 0;
+    q->tail = 0;
+    q->idle = 1;
+
+    return 0;
+}
+
+int mpsc_push(MpscQueue* q, const void* data)
+{
+    if(!q || q->size == 0) {
+        return -1;
+    }
+
+    uint32_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    uint32_t slot;
+    for(;;) {
+        slot = pos & q->mask;
+        uint32_t seq = __atomic_load_n(&q->seq[slot], __ATOMIC_ACQUIRE);
+        int32_t diff = (int32_t)(seq - pos);
+        if(diff == 0) {
+            if(__atomic_compare_exchange_n(&q->head, &pos, pos + 1, 1,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if(diff < 0) {
+            return -1;
+        } else {
+            pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    memcpy((char*)q->data + slot * q->element_size, data, q->element_size);
+    __atomic_store_n(&q->seq[slot], pos + 1, __ATOMIC_RELEASE);
+
+    return __atomic_exchange_n(&q->idle, 0, __ATOMIC_SEQ_CST) ? 1 : 0;
+}
+
+static inline
+int mpsc_ready(MpscQueue* q)
+{
+    uint32_t seq = __atomic_load_n(&q->seq[q->tail & q->mask], __ATOMIC_ACQUIRE);
+    return seq == q->tail + 1;
+}
+
+int mpsc_pop(MpscQueue* q, void* data)
+{
+    if(!q || q->size == 0) {
+        return -1;
+    }
+
+    if(!mpsc_ready(q)) {
+        // announce that we are going idle, then check again so a push that
+        // raced with us is not missed
+        __atomic_store_n(&q->idle, 1, __ATOMIC_SEQ_CST);
+        if(!mpsc_ready(q)) {
+            return -1;
+        }
+        __atomic_store_n(&q->idle, 0, __ATOMIC_SEQ_CST);
+    }
+
+    uint32_t slot = q->tail & q->mask;
+    memcpy(data, (char*)q->data + slot * q->element_size, q->element_size);
+    __atomic_store_n(&q->seq[slot], q->tail + q->size, __ATOMIC_RELEASE);
+    ++q->tail;
+
+    return 0;
+}
+
+int mpsc_empty(MpscQueue* q)
+{
+    if(!q || q->size == 0) {
+        return 1;
+    }
+    return !mpsc_ready(q);
+}
+
+int mpsc_free(MpscQueue* q)
+{
+    if(!q || q->size == 0) {
+        return -1;
+    }
+
+    dslink_free(q->seq);
+    dslink_free(q->data);
+    q->seq = NULL;
+    q->data = NULL;
+    q->size = 0;
+
+    return 0;
+}
@@ -5,6 +5,40 @@
 
 #include <string.h>
 
+// Smallest allocation once a value was pushed
+#define RB_MIN_CAPACITY 4
+
+static
+uint32_t rb_index(const Ringbuffer* rb, uint32_t idx)
+{
+    return (rb->current + rb->capacity - rb->count + idx) % rb->capacity;
+}
+
+// Moves the values to a buffer of the new capacity, oldest value first
+static
+int rb_resize(Ringbuffer* rb, uint32_t capacity)
+{
+    void* data = NULL;
+    if(capacity > 0) {
+        data = dslink_malloc(capacity*rb->element_size);
+        if(!data) {
+            return -1;
+        }
+        for(uint32_t i = 0; i < rb->count; ++i) {
+            memcpy((char*)data + (i * rb->element_size),
+                   (char*)rb->data + (rb_index(rb, i) * rb->element_size),
+                   rb->element_size);
+        }
+    }
+
+    if(rb->data) {
+        dslink_free(rb->data);
+    }
+    rb->data = data;
+    rb->capacity = capacity;
+    rb->current = capacity > 0 ? rb->count % capacity : 0;
+    return 0;
+}
 
 int rb_init(Ringbuffer* rb, uint32_t size, size_t element_size, rb_cleanup_fn_type cleanup_fn)
 {
@@ -13,9 +47,10 @@ int rb_init(Ringbuffer* rb, uint32_t size, size_t element_size, rb_cleanup_fn_ty
         return -1;
     }
 
-    rb->data = dslink_malloc(size*element_size);
+    rb->data = NULL;
     rb->element_size = element_size;
     rb->size = size;
+    rb->capacity = 0;
     rb->current = 0;
     rb->count = 0;
     rb->cleanup_fn = cleanup_fn;
@@ -38,6 +73,19 @@ int rb_push(Ringbuffer* rb, void* data)
         return -1;
     }
 
+    if(rb->count == rb->capacity && rb->capacity < rb->size) {
+        uint32_t capacity = RB_MIN_CAPACITY;
+        if(rb->capacity > 0) {
+            capacity = rb->capacity > rb->size / 2 ? rb->size : rb->capacity * 2;
+        }
+        if(capacity > rb->size) {
+            capacity = rb->size;
+        }
+        if(rb_resize(rb, capacity) != 0) {
+            return -1;
+        }
+    }
+
     size_t offset = rb->current * rb->element_size;
 
     int res = 0;
@@ -50,7 +98,7 @@ int rb_push(Ringbuffer* rb, void* data)
 
     memcpy((char*)rb->data + offset, data, rb->element_size);
     ++rb->current;
-    if(rb->current == rb->size) {
+    if(rb->current == rb->capacity) {
         rb->current = 0;
     }
 
@@ -63,18 +111,7 @@ int rb_push(Ringbuffer* rb, void* data)
 
 void* rb_front(const Ringbuffer* rb)
 {
-    if(!rb || rb->size == 0 || rb->count == 0) {
-        return NULL;
-    }
-
-    uint32_t index = 0;
-    if(rb->current >= rb->count) {
-        index = rb->current - rb->count;
-    } else {
-        index = rb->size - (rb->count - rb->current);
-    }
-
-    return (char*)rb->data + (index * rb->element_size);
+    return rb_at(rb, 0);
 }
 
 void* rb_at(const Ringbuffer* rb, uint32_t idx)
@@ -83,20 +120,7 @@ void* rb_at(const Ringbuffer* rb, uint32_t idx)
         return NULL;
     }
 
-    uint32_t index = 0;
-    if(rb->current >= rb->count) {
-        index = rb->current - rb->count;
-        index += idx;
-    } else {
-        index = rb->size - (rb->count - rb->current);
-        if((index + idx) >= rb->size) {
-            index = (index + idx) - rb->size;
-        } else {
-            index += idx;
-        }
-    }
-
-    return (char*)rb->data + (index * rb->element_size);
+    return (char*)rb->data + (rb_index(rb, idx) * rb->element_size);
 }
 
 int rb_pop(Ringbuffer* rb)
@@ -107,19 +131,20 @@ int rb_pop(Ringbuffer* rb)
 
     if(rb->count > 0) {
         if(rb->cleanup_fn) {
-            uint32_t index = 0;
-            if(rb->current >= rb->count) {
-                index = rb->current - rb->count;
-            } else {
-                index = rb->size - (rb->count - rb->current);
-            }
-            rb->cleanup_fn((char*)rb->data + (index * rb->element_size));
+            rb->cleanup_fn((char*)rb->data + (rb_index(rb, 0) * rb->element_size));
         }
         --rb->count;
     } else {
         return -1;
     }
 
+    // Drained buffers give their memory back, mostly empty ones shrink
+    if(rb->count == 0) {
+        rb_resize(rb, 0);
+    } else if(rb->capacity > RB_MIN_CAPACITY && rb->count <= rb->capacity / 4) {
+        rb_resize(rb, rb->capacity / 2);
+    }
+
     return 0;
 }
 
@@ -133,7 +158,11 @@ int rb_free(Ringbuffer* rb)
         rb_pop(rb);
     }
 
-    dslink_free(rb->data);
+    if(rb->data) {
+        dslink_free(rb->data);
+        rb->data = NULL;
+    }
+    rb->capacity = 0;
 
     return 0;
 }
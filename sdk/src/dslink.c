@@ -10,6 +10,12 @@
 #include "dslink/utils.h"
 #include "dslink/ws.h"
 #include "dslink/col/vector.h"
+#include "dslink/col/mpsc_queue.h"
+#include "dslink/value_slot.h"
+#include "dslink/value_snapshot.h"
+#include "dslink/requester.h"
+#include "dslink/stream.h"
+#include "dslink/writable.h"
 
 #include <unistd.h>
 
@@ -21,6 +27,14 @@ typedef struct {
     void *callback_data;
 } DSLinkAsyncSetData;
 
+typedef struct {
+    size_t count;
+    char **node_paths;
+    json_t **set_values;
+    async_set_callback callback;
+    void *callback_data;
+} DSLinkAsyncBatchSetData;
+
 typedef struct {
     char *node_path;
     async_get_callback callback;
@@ -34,13 +48,37 @@ typedef struct  {
 
 typedef void (*AsyncTaskWrapperFunction)(DSLink*, void*);
 
+// Tasks are copied into the preallocated slots of the task queue, so the
+// task data lives inline and needs no allocation of its own.
 typedef struct {
   AsyncTaskWrapperFunction wrapperFunction;
-  void *data;
+  union {
+    DSLinkAsyncSetData set;
+    DSLinkAsyncBatchSetData batch;
+    DSLinkAsyncGetData get;
+    DSLinkAsyncRunData run;
+  } data;
 } DSLinkAsyncWrapper;
 
+// Capacity of the lock-free task ring, must be a power of two.
+#define DSLINK_ASYNC_QUEUE_SIZE 4096
+
+typedef struct {
+  MpscQueue ring;
+  // Only used while the ring is full, protected by tasks_data_mutex.
+  // Once it holds tasks, all producers append here until the loop
+  // drained it, which keeps the order of each producer's tasks.
+  Vector overflow;
+  uint32_t overflow_active;
+} DSLinkAsyncQueue;
+
 #define SECONDS_TO_MILLIS(count) count * 1000
 
+// Reconnect backoff defaults, overridable in dslink.json
+#define DSLINK_RECONNECT_DELAY SECONDS_TO_MILLIS(1)
+#define DSLINK_RECONNECT_MAX_DELAY SECONDS_TO_MILLIS(60)
+#define DSLINK_RECONNECT_STABLE_TIME SECONDS_TO_MILLIS(30)
+
 #define DSLINK_RESPONDER_MAP_INIT(var, type) \
     responder->var = dslink_calloc(1, sizeof(Map)); \
     if (!responder->var) { \
@@ -83,6 +121,15 @@ static void freeAndAssign(const char** target, const char* source)
     *target = strdup(source);
 }
 
+static
+long dslink_json_raw_get_config_ms(json_t *json, const char *key, long def) {
+    json_t *val = dslink_json_raw_get_config(json, key);
+    if (json_is_integer(val) && json_integer_value(val) >= 0) {
+        return (long) json_integer_value(val);
+    }
+    return def;
+}
+
 static
 int dslink_parse_opts(int argc,
                       char **argv,
@@ -163,6 +210,33 @@ int dslink_parse_opts(int argc,
         }
     }
 
+    if (json_is_true(dslink_json_raw_get_config(json, "keepStateOnReconnect"))) {
+        config->keep_state_on_reconnect = 1;
+    }
+
+    {
+        json_t *ackDelay = dslink_json_raw_get_config(json, "ackDelay");
+        if (json_is_integer(ackDelay)) {
+            config->ack_delay = (long) json_integer_value(ackDelay);
+        }
+    }
+
+    config->reconnect_delay = dslink_json_raw_get_config_ms(json,
+                "reconnectDelay", DSLINK_RECONNECT_DELAY);
+    config->reconnect_max_delay = dslink_json_raw_get_config_ms(json,
+                "reconnectMaxDelay", DSLINK_RECONNECT_MAX_DELAY);
+    config->reconnect_stable_time = dslink_json_raw_get_config_ms(json,
+                "reconnectStableTime", DSLINK_RECONNECT_STABLE_TIME);
+    config->send_window = (uint32_t) dslink_json_raw_get_config_ms(json,
+                "sendWindow", 0);
+    config->send_window_bytes = (size_t) dslink_json_raw_get_config_ms(json,
+                "sendWindowBytes", 0);
+    config->send_window_held_bytes = (size_t) dslink_json_raw_get_config_ms(json,
+                "sendWindowHeldBytes", 0);
+    if (config->reconnect_max_delay < config->reconnect_delay) {
+        config->reconnect_max_delay = config->reconnect_delay;
+    }
+
     if (!config->broker_url) {
         log_fatal("Failed to parse broker url\n");
         ret = 1;
@@ -303,27 +377,31 @@ void dslink_close(DSLink *link) {
     uv_stop(&link->loop);
 }
 
-static
 void dslink_link_clear(DSLink *link) {
+    dslink_writable_reset(link);
+
     if (link->_ws) {
         wslay_event_context_free(link->_ws);
+        link->_ws = NULL;
     }
 
     if (link->msg) {
         dslink_free(link->msg);
-    }
-
-    if (link->link_data) {
-        json_decref(link->link_data);
+        link->msg = NULL;
     }
 
     if (link->dslink_json) {
         json_decref(link->dslink_json);
+        link->dslink_json = NULL;
     }
 }
 
 void dslink_link_free(DSLink *link) {
     dslink_link_clear(link);
+    dslink_writable_free(link);
+    if (link->link_data) {
+        json_decref(link->link_data);
+    }
     dslink_free((void*)link->config.name);
     dslink_free((void*)link->config.token);
     dslink_free((void*)link->config.broker_url);
@@ -387,6 +465,142 @@ json_t *dslink_json_get_config(DSLink *link, const char *key) {
     return dslink_json_raw_get_config(link->dslink_json, key);
 }
 
+static
+void dslink_free_responder(DSLink *link) {
+    if (!link->responder) {
+        return;
+    }
+
+    if (link->responder->super_root) {
+        dslink_node_tree_free(link, link->responder->super_root);
+    }
+    dslink_node_value_snapshots_free(link);
+
+    if (link->responder->open_streams) {
+        dslink_map_free(link->responder->open_streams);
+        dslink_free(link->responder->open_streams);
+    }
+
+    if (link->responder->list_subs) {
+        dslink_map_free(link->responder->list_subs);
+        dslink_free(link->responder->list_subs);
+    }
+
+    if (link->responder->value_path_subs) {
+        dslink_map_free(link->responder->value_path_subs);
+        dslink_free(link->responder->value_path_subs);
+    }
+
+    if (link->responder->value_sid_subs) {
+        dslink_map_free(link->responder->value_sid_subs);
+        dslink_free(link->responder->value_sid_subs);
+    }
+
+    dslink_free(link->responder);
+    link->responder = NULL;
+}
+
+static
+void dslink_free_requester(DSLink *link) {
+    if (!link->requester) {
+        return;
+    }
+
+    if (link->requester->list_subs) {
+        dslink_map_free(link->requester->list_subs);
+        dslink_free(link->requester->list_subs);
+    }
+
+    if (link->requester->request_handlers) {
+        dslink_map_free(link->requester->request_handlers);
+        dslink_free(link->requester->request_handlers);
+    }
+
+    if (link->requester->open_streams) {
+        dslink_map_free(link->requester->open_streams);
+        dslink_free(link->requester->open_streams);
+    }
+
+    if (link->requester->value_handlers) {
+        dslink_map_free(link->requester->value_handlers);
+        dslink_free(link->requester->value_handlers);
+    }
+
+    if (link->requester->rid) {
+        dslink_free(link->requester->rid);
+    }
+
+    if (link->requester->sid) {
+        dslink_free(link->requester->sid);
+    }
+
+    dslink_free(link->requester);
+    link->requester = NULL;
+}
+
+// Drops the per-connection state of the responder, the node tree stays.
+// Streams and subscriptions are closed the same way the broker would
+// close them, so the node callbacks see a consistent state.
+static
+void dslink_reset_responder(DSLink *link) {
+    Responder *responder = link->responder;
+    if (!responder) {
+        return;
+    }
+
+    while (responder->open_streams->size > 0) {
+        MapEntry *entry = (MapEntry *) responder->open_streams->list.head.next;
+        ref_t *stream_ref = dslink_map_remove_get(responder->open_streams,
+                                                  entry->key->data);
+        Stream *stream = stream_ref->data;
+        if (stream->on_close) {
+            DSNode *node = NULL;
+            if (stream->path) {
+                node = dslink_node_get_path(responder->super_root, stream->path);
+            }
+            stream->on_close(link, node, stream);
+        }
+        dslink_decref(stream_ref);
+    }
+
+    while (responder->value_sid_subs->size > 0) {
+        MapEntry *entry = (MapEntry *) responder->value_sid_subs->list.head.next;
+        ref_t *ref = dslink_map_remove_get(responder->value_sid_subs,
+                                           entry->key->data);
+        DSNode *node = dslink_node_get_path(responder->super_root, ref->data);
+        if (node && node->on_unsubscribe) {
+            node->on_unsubscribe(link, node);
+        }
+        dslink_decref(ref);
+    }
+
+    dslink_map_clear(responder->list_subs);
+    dslink_map_clear(responder->value_path_subs);
+}
+
+// Drops the pending requests of the requester. The value handlers are
+// kept, they are subscribed again by dslink_requester_resubscribe.
+static
+void dslink_reset_requester(DSLink *link) {
+    Requester *requester = link->requester;
+    if (!requester) {
+        return;
+    }
+
+    // unsubscribes which didn't complete yet shouldn't come back
+    dslink_map_foreach(requester->request_handlers) {
+        RequestHolder *holder = entry->value->data;
+        const char *method = json_string_value(json_object_get(holder->req, "method"));
+        if (holder->sid && method && strcmp(method, "unsubscribe") == 0) {
+            dslink_map_remove(requester->value_handlers, &holder->sid);
+        }
+    }
+
+    dslink_map_clear(requester->request_handlers);
+    dslink_map_clear(requester->open_streams);
+    dslink_map_clear(requester->list_subs);
+}
+
 static
 int dslink_init_do(DSLink *link, DSLinkCallbacks *cbs) {
     link->closing = 0;
@@ -404,7 +618,10 @@ int dslink_init_do(DSLink *link, DSLinkCallbacks *cbs) {
         goto exit;
     }
 
-    if (link->is_responder) {
+    // The state was kept from the last connection, see keep_state_on_reconnect
+    uint8_t reconnect = link->responder || link->requester;
+
+    if (link->is_responder && !reconnect) {
         link->responder = dslink_calloc(1, sizeof(Responder));
 
         if (!link->responder) {
@@ -418,7 +635,7 @@ int dslink_init_do(DSLink *link, DSLinkCallbacks *cbs) {
         }
     }
 
-    if (link->is_requester) {
+    if (link->is_requester && !reconnect) {
         link->requester = dslink_calloc(1, sizeof(Requester));
         if (!link->requester) {
             log_fatal("Failed to create requester\n");
@@ -433,7 +650,13 @@ int dslink_init_do(DSLink *link, DSLinkCallbacks *cbs) {
 
     link->dslink_json = dslink_read_dslink_json();
 
-    if (cbs->init_cb) {
+    if (!reconnect && link->link_data) {
+        // set up again by the init callback
+        json_decref(link->link_data);
+        link->link_data = NULL;
+    }
+
+    if (cbs->init_cb && !reconnect) {
         cbs->init_cb(link);
     }
 
@@ -465,6 +688,7 @@ int dslink_init_do(DSLink *link, DSLinkCallbacks *cbs) {
     }
 
     link->_socket = sock;
+    link->connected_time = uv_hrtime() / 1000000;
 
     if (cbs->on_connected_cb) {
         cbs->on_connected_cb(link);
@@ -482,64 +706,12 @@ int dslink_init_do(DSLink *link, DSLinkCallbacks *cbs) {
     }
 
     exit:
-    if (link->is_responder) {
-        if (link->responder->super_root) {
-            dslink_node_tree_free(link, link->responder->super_root);
-        }
-
-        if (link->responder->open_streams) {
-            dslink_map_free(link->responder->open_streams);
-            dslink_free(link->responder->open_streams);
-        }
-
-        if (link->responder->list_subs) {
-            dslink_map_free(link->responder->list_subs);
-            dslink_free(link->responder->list_subs);
-        }
-
-        if (link->responder->value_path_subs) {
-            dslink_map_free(link->responder->value_path_subs);
-            dslink_free(link->responder->value_path_subs);
-        }
-
-        if (link->responder->value_sid_subs) {
-            dslink_map_free(link->responder->value_sid_subs);
-            dslink_free(link->responder->value_sid_subs);
-        }
-
-        dslink_free(link->responder);
-    }
-
-    if (link->is_requester) {
-        if (link->requester->list_subs) {
-            dslink_map_free(link->requester->list_subs);
-            dslink_free(link->requester->list_subs);
-        }
-
-        if (link->requester->request_handlers) {
-            dslink_map_free(link->requester->request_handlers);
-            dslink_free(link->requester->request_handlers);
-        }
-
-        if (link->requester->open_streams) {
-            dslink_map_free(link->requester->open_streams);
-            dslink_free(link->requester->open_streams);
-        }
-
-        if (link->requester->value_handlers) {
-            dslink_map_free(link->requester->value_handlers);
-            dslink_free(link->requester->value_handlers);
-        }
-
-        if (link->requester->rid) {
-            dslink_free(link->requester->rid);
-        }
-
-        if (link->requester->sid) {
-            dslink_free(link->requester->sid);
-        }
-
-        dslink_free(link->requester);
+    if (ret == 2 && link->config.keep_state_on_reconnect) {
+        dslink_reset_responder(link);
+        dslink_reset_requester(link);
+    } else {
+        dslink_free_responder(link);
+        dslink_free_requester(link);
     }
 
     mbedtls_ecdh_free(&link->key);
@@ -609,6 +781,51 @@ exit:
   dslink_free(asyncSetData->node_path);
 }
 
+static void set_node_values_wrapper(DSLink* link, void* data)
+{
+  DSLinkAsyncBatchSetData *asyncSetData = (DSLinkAsyncBatchSetData*)data;
+  int result = 0;
+
+  if ( !link || !link->responder || !link->responder->super_root ) {
+    result = DSLINK_NO_ROOT_NODE_ERR;
+    for ( size_t i = 0; i < asyncSetData->count; ++i ) {
+      json_decref(asyncSetData->set_values[i]);
+    }
+    goto exit;
+  }
+
+  DSNodeUpdateBatch batch;
+  dslink_node_update_batch_begin(link, &batch);
+  for ( size_t i = 0; i < asyncSetData->count; ++i ) {
+    DSNode *node = dslink_node_get_path(link->responder->super_root, asyncSetData->node_paths[i]);
+    int ret = EINVAL;
+    if ( node ) {
+      ret = dslink_node_update_batch_add(&batch, node, asyncSetData->set_values[i], NULL);
+    } else {
+      json_decref(asyncSetData->set_values[i]);
+    }
+    if ( ret && !result ) {
+      result = ret;
+    }
+  }
+  int ret = dslink_node_update_batch_commit(&batch);
+  if ( ret && !result ) {
+    result = ret;
+  }
+
+exit:
+  if ( asyncSetData->callback ) {
+    asyncSetData->callback( result, asyncSetData->callback_data );
+  }
+
+  // free the task nested data structure
+  for ( size_t i = 0; i < asyncSetData->count; ++i ) {
+    dslink_free(asyncSetData->node_paths[i]);
+  }
+  dslink_free(asyncSetData->node_paths);
+  dslink_free(asyncSetData->set_values);
+}
+
 static void run_wrapper(DSLink* link, void* data)
 {
   if ( !link ) {
@@ -621,62 +838,171 @@ static void run_wrapper(DSLink* link, void* data)
   }
 }
 
-static void dslink_process_async_tasks(uv_async_t *async_handle)
+static inline
+void dslink_run_async_task(DSLink *link, DSLinkAsyncWrapper *task)
 {
+    if(task->wrapperFunction) {
+      task->wrapperFunction(link, &task->data);
+    }
+}
+
+static void dslink_process_overflow_tasks(DSLink *link, DSLinkAsyncQueue *queue)
+{
+    if(!__atomic_load_n(&queue->overflow_active, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
     lock_tasks_data();
-    DSLink *link = (DSLink*)(async_handle->loop->data);
-    Vector* queue = (Vector*)link->async_tasks.data;
-    if(!link || !queue || !vector_count(queue)) {
+    if(!mpsc_empty(&queue->ring)) {
+        // tasks queued before the overflowed ones have to run first
         unlock_tasks_data();
+        uv_async_send(&link->async_tasks);
         return;
     }
-    
-    Vector* processing_queue = (Vector*)dslink_malloc(sizeof(Vector));
-    vector_init(processing_queue, 10, sizeof(DSLinkAsyncWrapper));
-    vector_swap( queue, processing_queue );
 
+    Vector processing_queue;
+    vector_init(&processing_queue, 10, sizeof(DSLinkAsyncWrapper));
+    vector_swap(&queue->overflow, &processing_queue);
+    __atomic_store_n(&queue->overflow_active, 0, __ATOMIC_RELEASE);
     unlock_tasks_data();
-    
-    dslink_vector_foreach(processing_queue) {
-      DSLinkAsyncWrapper* async_wrapper = data;
-      if(async_wrapper->wrapperFunction) {
-        async_wrapper->wrapperFunction(link, async_wrapper->data);
-      }
-      dslink_free(async_wrapper->data);
+
+    dslink_vector_foreach(&processing_queue) {
+      dslink_run_async_task(link, (DSLinkAsyncWrapper*)data);
     }
     dslink_vector_foreach_end();
-    vector_erase_range(processing_queue, 0, vector_count(processing_queue));
-    vector_free(processing_queue);
+    vector_free(&processing_queue);
 }
 
-static int add_async_task(DSLink* link, AsyncTaskWrapperFunction wrapperFunction, void* data)
+static void dslink_process_async_tasks(uv_async_t *async_handle)
+{
+    DSLink *link = (DSLink*)(async_handle->loop->data);
+    DSLinkAsyncQueue *queue = link ? (DSLinkAsyncQueue*)link->async_tasks.data : NULL;
+    if(!queue) {
+        return;
+    }
+
+    dslink_node_value_slots_drain(link);
+
+    // run at most one ring worth of tasks per loop iteration, so busy
+    // producers can't starve the network io
+    DSLinkAsyncWrapper task;
+    for(uint32_t i = 0; i < queue->ring.size; ++i) {
+        if(mpsc_pop(&queue->ring, &task) != 0) {
+            dslink_process_overflow_tasks(link, queue);
+            return;
+        }
+        dslink_run_async_task(link, &task);
+    }
+
+    // the ring wasn't drained, so no producer is going to wake us up again
+    uv_async_send(&link->async_tasks);
+}
+
+static int add_async_task(DSLink* link, AsyncTaskWrapperFunction wrapperFunction, const void* data, size_t size)
 { 
-  if ( !link ) {
+  if ( !link || !link->async_tasks.data ) {
     return EINVAL;
   }
 
+  DSLinkAsyncQueue *queue = (DSLinkAsyncQueue*)link->async_tasks.data;
   DSLinkAsyncWrapper async_wrapper;
   async_wrapper.wrapperFunction = wrapperFunction;
-  async_wrapper.data = data;
-  
-  lock_tasks_data();
-  Vector* queue = (Vector*)link->async_tasks.data;
-  if ( !queue  ) {
-    queue = dslink_malloc(sizeof(Vector));
-    vector_init(queue, 10, sizeof(DSLinkAsyncWrapper));
-    link->async_tasks.data = queue;
+  memcpy(&async_wrapper.data, data, size);
+
+  if ( !__atomic_load_n(&queue->overflow_active, __ATOMIC_ACQUIRE) ) {
+    int ret = mpsc_push(&queue->ring, &async_wrapper);
+    if ( ret == 0 ) {
+      return 0;
+    }
+    if ( ret == 1 ) {
+      // only the push that finds the loop idle has to wake it up
+      return uv_async_send(&link->async_tasks);
+    }
   }
-  
-  if ( vector_append(queue, &async_wrapper) < 0 ) {
-    dslink_free(data);
+
+  lock_tasks_data();
+  if ( vector_append(&queue->overflow, &async_wrapper) < 0 ) {
     unlock_tasks_data();
     return DSLINK_ALLOC_ERR;
   }
+  __atomic_store_n(&queue->overflow_active, 1, __ATOMIC_RELEASE);
   unlock_tasks_data();
     
-  return uv_async_send(&link->async_tasks);;
+  return uv_async_send(&link->async_tasks);
 }
 
+int dslink_async_tasks_init(DSLink *link)
+{
+    DSLinkAsyncQueue *queue = dslink_calloc(1, sizeof(DSLinkAsyncQueue));
+    if(!queue) {
+        return DSLINK_ALLOC_ERR;
+    }
+    if(mpsc_init(&queue->ring, DSLINK_ASYNC_QUEUE_SIZE, sizeof(DSLinkAsyncWrapper)) != 0) {
+        dslink_free(queue);
+        return DSLINK_ALLOC_ERR;
+    }
+    if(vector_init(&queue->overflow, 10, sizeof(DSLinkAsyncWrapper)) != 0) {
+        mpsc_free(&queue->ring);
+        dslink_free(queue);
+        return DSLINK_ALLOC_ERR;
+    }
+
+    if(uv_async_init(&link->loop, &link->async_tasks, dslink_process_async_tasks)) {
+        log_warn("Async handle init error\n");
+        vector_free(&queue->overflow);
+        mpsc_free(&queue->ring);
+        dslink_free(queue);
+        return 1;
+    }
+    link->async_tasks.data = queue;
+    return 0;
+}
+
+void dslink_async_tasks_free(DSLink *link)
+{
+    DSLinkAsyncQueue *queue = (DSLinkAsyncQueue*)link->async_tasks.data;
+    if(!queue) {
+        return;
+    }
+    link->async_tasks.data = NULL;
+    vector_free(&queue->overflow);
+    mpsc_free(&queue->ring);
+    dslink_free(queue);
+}
+
+// Picks the delay before the next connection attempt. Links that were
+// connected for at least reconnect_stable_time start over with the
+// initial delay. A Retry-After hint of the broker is added on top, so the
+// jitter still spreads the reconnects of many links.
+static
+long dslink_reconnect_delay(DSLink *link, uint32_t *attempt) {
+    static uint32_t seed = 0;
+    if (seed == 0) {
+        seed = (uint32_t) (uv_hrtime() ^ ((uint64_t) getpid() << 16)) | 1;
+    }
+    // xorshift32
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    uint64_t now = uv_hrtime() / 1000000;
+    if (link->connected_time
+        && now - link->connected_time >= (uint64_t) link->config.reconnect_stable_time) {
+        *attempt = 0;
+    }
+
+    long delay = dslink_backoff_delay(*attempt,
+                                      link->config.reconnect_delay,
+                                      link->config.reconnect_max_delay,
+                                      seed);
+    if (*attempt < 32) {
+        (*attempt)++;
+    }
+    if (link->retry_after > 0) {
+        delay += link->retry_after;
+    }
+    return delay;
+}
 
 int dslink_init(int argc, char **argv,
                 const char *name, uint8_t isRequester,
@@ -687,10 +1013,7 @@ int dslink_init(int argc, char **argv,
     link->loop.data = link;
 
     //thread-safe API async handle set
-    if(uv_async_init(&link->loop, &link->async_tasks, dslink_process_async_tasks)) {
-        log_warn("Async handle init error\n");
-    }
-    link->async_tasks.data = NULL;
+    dslink_async_tasks_init(link);
 
     link->is_responder = isResponder;
     link->is_requester = isRequester;
@@ -700,19 +1023,24 @@ int dslink_init(int argc, char **argv,
     }
 
     int ret = 0;
+    uint32_t attempt = 0;
     while (1) {
+        link->connected_time = 0;
+        link->retry_after = 0;
         ret = dslink_init_do(link, cbs);
         if (ret != 2) {
             log_info("%i\n", ret);
             break;
         }
-        
+
         dslink_link_clear(link);
-        dslink_sleep(SECONDS_TO_MILLIS(5));
-        log_info("Attempting to reconnect...\n");
+        long delay = dslink_reconnect_delay(link, &attempt);
+        log_info("Attempting to reconnect in %ld ms...\n", delay);
+        dslink_sleep(delay);
     }
 
     uv_close((uv_handle_t*)&link->async_tasks,NULL);
+    dslink_async_tasks_free(link);
 
     uv_loop_close(&link->loop);
     dslink_link_free(link);
@@ -951,13 +1279,13 @@ int dslink_node_update_value_safe(struct DSLink *link, char* path, json_t *value
     return EINVAL;
   }
 
-  DSLinkAsyncSetData *async_data = dslink_malloc(sizeof(DSLinkAsyncSetData));
-  async_data->node_path = path;
-  async_data->set_value = value;
-  async_data->callback = callback;
-  async_data->callback_data = callback_data;
+  DSLinkAsyncSetData async_data;
+  async_data.node_path = path;
+  async_data.set_value = value;
+  async_data.callback = callback;
+  async_data.callback_data = callback_data;
   
-  int result = add_async_task( link, &set_node_value_wrapper, async_data );
+  int result = add_async_task( link, &set_node_value_wrapper, &async_data, sizeof(async_data) );
   if ( result ) {
     dslink_free(path);
   }
@@ -965,18 +1293,56 @@ int dslink_node_update_value_safe(struct DSLink *link, char* path, json_t *value
   return result;
 }
 
+int dslink_node_update_values_safe(struct DSLink *link, char **paths, json_t **values, size_t count, async_set_callback callback, void * callback_data)
+{
+  if ( !link || !count ) {
+    return EINVAL;
+  }
+
+  char **node_paths = dslink_malloc(count * sizeof(char*));
+  json_t **set_values = dslink_malloc(count * sizeof(json_t*));
+  if ( !node_paths || !set_values ) {
+    DSLINK_CHECKED_EXEC(dslink_free, node_paths);
+    DSLINK_CHECKED_EXEC(dslink_free, set_values);
+    // the paths and values were handed over, release them
+    for ( size_t i = 0; i < count; ++i ) {
+      dslink_free(paths[i]);
+      json_decref(values[i]);
+    }
+    return DSLINK_ALLOC_ERR;
+  }
+  memcpy(node_paths, paths, count * sizeof(char*));
+  memcpy(set_values, values, count * sizeof(json_t*));
+
+  DSLinkAsyncBatchSetData async_data;
+  async_data.count = count;
+  async_data.node_paths = node_paths;
+  async_data.set_values = set_values;
+  async_data.callback = callback;
+  async_data.callback_data = callback_data;
+
+  // one task for the whole batch: one queue slot and at most one uv_async_send
+  int result = add_async_task( link, &set_node_values_wrapper, &async_data, sizeof(async_data) );
+  if ( result ) {
+    dslink_free(node_paths);
+    dslink_free(set_values);
+  }
+
+  return result;
+}
+
 int dslink_node_get_value_safe(struct DSLink *link, char* path,  void (*callback)(json_t *, void*), void * callback_data)
 {
   if (!link) {
     return EINVAL;
   }
 
-  DSLinkAsyncGetData *async_data = (DSLinkAsyncGetData*)dslink_malloc(sizeof(DSLinkAsyncGetData));
-  async_data->node_path = path;
-  async_data->callback = callback;
-  async_data->callback_data = callback_data;
+  DSLinkAsyncGetData async_data;
+  async_data.node_path = path;
+  async_data.callback = callback;
+  async_data.callback_data = callback_data;
   
-  int result = add_async_task( link, &get_node_value_wrapper, async_data );
+  int result = add_async_task( link, &get_node_value_wrapper, &async_data, sizeof(async_data) );
   if ( result ) {
     dslink_free(path);
   }
@@ -990,11 +1356,11 @@ int dslink_run_safe(struct DSLink *link, void (*callback)(struct DSLink *link, v
     return EINVAL;
   }
 
-  DSLinkAsyncRunData* async_data = dslink_malloc(sizeof(DSLinkAsyncRunData));;
-  async_data->callback = callback;
-  async_data->callback_data = callback_data;
+  DSLinkAsyncRunData async_data;
+  async_data.callback = callback;
+  async_data.callback_data = callback_data;
   
-  return add_async_task( link, &run_wrapper, async_data );
+  return add_async_task( link, &run_wrapper, &async_data, sizeof(async_data) );
 }
 
 static pthread_mutex_t tasks_data_mutex = PTHREAD_MUTEX_INITIALIZER;
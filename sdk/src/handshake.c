@@ -461,6 +461,30 @@ exit:
     return ret;
 }
 
+long dslink_handshake_retry_after(const char *resp) {
+    if (!resp) {
+        return 0;
+    }
+
+    // Only look at the headers
+    const char *end = strstr(resp, "\r\n\r\n");
+    const char *index = dslink_strcasestr(resp, "\r\nRetry-After:");
+    if (!index || (end && index > end)) {
+        return 0;
+    }
+
+    // Only the delta-seconds form is supported
+    char *num_end = NULL;
+    long secs = strtol(index + 14, &num_end, 10);
+    if (num_end == index + 14 || secs <= 0) {
+        return 0;
+    }
+    if (secs > 3600) {
+        secs = 3600;
+    }
+    return secs * 1000;
+}
+
 int dslink_handshake_generate(DSLink *link,
                               json_t **handshake,
                               char **dsId) {
@@ -512,6 +536,7 @@ int dslink_handshake_generate(DSLink *link,
         }
     }
 
+    link->retry_after = dslink_handshake_retry_after(resp);
     ret = dslink_parse_handshake_response(resp, handshake);
 exit:
     DSLINK_CHECKED_EXEC(dslink_free, req);
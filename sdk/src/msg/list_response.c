@@ -5,6 +5,30 @@
 #include "dslink/stream.h"
 #include "dslink/ws.h"
 
+// Meta values of a child sent in the list of its parent
+static const char *list_summary_keys[] = {
+    "$name", "$permission", "$invokable", "$type", NULL
+};
+
+int dslink_response_list_summary_key(const char *name) {
+    for (const char **key = list_summary_keys; *key; ++key) {
+        if (strcmp(*key, name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void dslink_response_list_cache_free(DSNode *node) {
+    DSNodeListCache *cache = node->list_cache;
+    if (!cache) {
+        return;
+    }
+    node->list_cache = NULL;
+    dslink_free(cache->data);
+    dslink_free(cache);
+}
+
 void dslink_response_list_append_meta(json_t *obj,
                                             Map *meta,
                                             const char *name) {
@@ -49,91 +73,104 @@ int dslink_response_list_append_child(json_t *update, DSNode *child) {
     json_object_set_new(obj, "$is", json_string_nocheck(child->profile));
     if (child->meta_data) {
         Map *meta = child->meta_data;
-        dslink_response_list_append_meta(obj, meta, "$name");
-        dslink_response_list_append_meta(obj, meta, "$permission");
-        dslink_response_list_append_meta(obj, meta, "$invokable");
-        dslink_response_list_append_meta(obj, meta, "$type");
+        for (const char **key = list_summary_keys; *key; ++key) {
+            dslink_response_list_append_meta(obj, meta, *key);
+        }
     }
     return 0;
 }
 
-int dslink_response_list(DSLink *link, json_t *req, DSNode *node) {
-    if (!node) {
-        return 1;
-    }
-
-    json_t *top = json_object();
-    if (!top) {
-        return 1;
-    }
-
-    json_t *resps = json_array();
-    if (!resps) {
-        return 1;
+static
+json_t *dslink_response_list_updates(DSNode *node) {
+    json_t *updates = json_array();
+    if (!updates) {
+        return NULL;
     }
 
-    json_object_set_new_nocheck(top, "responses", resps);
+    json_t *profile = json_string_nocheck(node->profile);
+    dslink_response_list_append_update(updates, "$is", profile, 1);
+    if (node->meta_data) {
+        dslink_map_foreach(node->meta_data) {
+            const char *key = entry->key->data;
 
-    json_t *resp = json_object();
-    if (!resp) {
-        json_delete(top);
-        return 1;
-    }
-    json_array_append_new(resps, resp);
+            if (strncmp(key, "$$$", 3) == 0) {
+                continue;
+            }
 
-    {
-        json_t *updates = json_array();
-        if (!updates) {
-            json_delete(top);
-            return 1;
+            json_t *val = entry->value->data;
+            dslink_response_list_append_update(updates, key, val, 0);
         }
-        json_object_set_new_nocheck(resp, "updates", updates);
-
-        json_t *profile = json_string_nocheck(node->profile);
-        dslink_response_list_append_update(updates, "$is", profile, 1);
-        if (node->meta_data) {
-            dslink_map_foreach(node->meta_data) {
-                const char *key = entry->key->data;
+    }
 
-                if (strncmp(key, "$$$", 3) == 0) {
-                    continue;
-                }
+    if (node->children) {
+        dslink_map_foreach(node->children) {
+            DSNode *val = entry->value->data;
 
-                json_t *val = entry->value->data;
-                dslink_response_list_append_update(updates, key, val, 0);
+            json_t *update = json_array();
+            if (!update) {
+                json_delete(updates);
+                return NULL;
             }
+            json_array_append_new(updates, update);
+            dslink_response_list_append_child(update, val);
         }
+    }
+    return updates;
+}
 
-        if (node->children) {
-            dslink_map_foreach(node->children) {
-                DSNode *val = entry->value->data;
+DSNodeListCache *dslink_response_list_payload(DSNode *node) {
+    DSNodeListCache *cache = node->list_cache;
+    if (cache && cache->version == node->list_version) {
+        return cache;
+    }
 
-                json_t *update = json_array();
-                if (!update) {
-                    json_delete(top);
-                    return 1;
-                }
-                json_array_append_new(updates, update);
-                dslink_response_list_append_child(update, val);
-            }
+    json_t *updates = dslink_response_list_updates(node);
+    if (!updates) {
+        return NULL;
+    }
+    char *data = json_dumps(updates, JSON_PRESERVE_ORDER);
+    json_delete(updates);
+    if (!data) {
+        return NULL;
+    }
+
+    if (!cache) {
+        cache = dslink_malloc(sizeof(DSNodeListCache));
+        if (!cache) {
+            dslink_free(data);
+            return NULL;
         }
+        node->list_cache = cache;
+    } else {
+        dslink_free(cache->data);
     }
+    cache->data = data;
+    cache->len = strlen(data);
+    cache->version = node->list_version;
+    return cache;
+}
 
-    json_t *jsonRid = json_object_get(req, "rid");
-    json_object_set_nocheck(resp, "rid", jsonRid);
-    json_object_set_new_nocheck(resp, "stream", json_string_nocheck("open"));
+int dslink_response_list(DSLink *link, json_t *req, DSNode *node) {
+    if (!node) {
+        return 1;
+    }
 
+    DSNodeListCache *cache = dslink_response_list_payload(node);
+    if (!cache) {
+        return 1;
+    }
+
+    uint32_t r = (uint32_t) json_integer_value(json_object_get(req, "rid"));
     {
-        Stream *stream = dslink_malloc(sizeof(Stream));
+        Stream *stream = dslink_calloc(1, sizeof(Stream));
         if (!stream) {
-            json_delete(top);
             return 1;
         }
         stream->type = LIST_STREAM;
+        stream->rid = r;
         stream->path = dslink_strdup(node->path);
         stream->on_close = node->on_list_close;
         if (!stream->path) {
-            json_delete(top);
             dslink_free(stream);
             return 1;
         }
@@ -142,21 +179,15 @@ int dslink_response_list(DSLink *link, json_t *req, DSNode *node) {
         if (!rid) {
             dslink_free((void *) stream->path);
             dslink_free(stream);
-            json_delete(top);
             return 1;
         }
-        
-        {
-            uint32_t r = (uint32_t) json_integer_value(jsonRid);
-            *((uint32_t *) rid->data) = r;
-        }
+        *((uint32_t *) rid->data) = r;
 
         if (dslink_map_set(link->responder->open_streams,
                            rid,
                            dslink_ref(stream, free)) != 0) {
             dslink_free(rid);
             dslink_free(stream);
-            json_delete(top);
             return 1;
         }
 
@@ -167,17 +198,181 @@ int dslink_response_list(DSLink *link, json_t *req, DSNode *node) {
             dslink_free(rid);
             dslink_free((void *) stream->path);
             dslink_free(stream);
-            json_delete(top);
             return 1;
         }
+    }
+
+    // sent before on_list_open, which may change the node and the cache,
+    // its changes follow as list updates
+    dslink_ws_send_updates(link->_ws, r, cache->data, cache->len);
+
+    if (node->on_list_open) {
+        node->on_list_open(link, node);
+    }
+    return 0;
+}
+
+static
+json_t *dslink_response_list_change(DSNode *node, const char *name) {
+    json_t *update;
+    if (*name == '$' || *name == '@') {
+        ref_t *val = node->meta_data ? dslink_map_get(node->meta_data, (void *) name) : NULL;
+        if (val) {
+            update = json_array();
+            if (update) {
+                json_array_append_new(update, json_string_nocheck(name));
+                json_array_append(update, val->data);
+            }
+            return update;
+        }
+    } else {
+        ref_t *child = node->children ? dslink_map_get(node->children, (void *) name) : NULL;
+        if (child) {
+            update = json_array();
+            if (update) {
+                dslink_response_list_append_child(update, child->data);
+            }
+            return update;
+        }
+    }
+
+    // gone by now, even if it was added in this loop iteration
+    update = json_object();
+    if (update) {
+        json_object_set_new_nocheck(update, "name", json_string_nocheck(name));
+        json_object_set_new_nocheck(update, "change", json_string_nocheck("remove"));
+    }
+    return update;
+}
 
-        if (node->on_list_open) {
-            node->on_list_open(link, node);
+static
+void dslink_response_list_handler(uv_timer_t *timer) {
+    dslink_response_list_flush(timer->data);
+}
+
+int dslink_response_list_changed(DSLink *link, DSNode *node, const char *name) {
+    if (!link->_ws || !dslink_map_contains(link->responder->list_subs,
+                                           (void *) node->path)) {
+        return 0;
+    }
+
+    if (!link->list_changes) {
+        link->list_changes = dslink_malloc(sizeof(Map));
+        if (!link->list_changes) {
+            return DSLINK_ALLOC_ERR;
+        }
+        if (dslink_map_init(link->list_changes, dslink_map_str_cmp,
+                            dslink_map_str_key_len_cal,
+                            dslink_map_hash_key) != 0) {
+            dslink_free(link->list_changes);
+            link->list_changes = NULL;
+            return DSLINK_ALLOC_ERR;
+        }
+    }
+
+    json_t *names;
+    ref_t *ref = dslink_map_get(link->list_changes, (void *) node->path);
+    if (ref) {
+        names = ref->data;
+    } else {
+        names = json_object();
+        if (!names) {
+            return DSLINK_ALLOC_ERR;
+        }
+        char *path = dslink_strdup(node->path);
+        if (!path) {
+            json_delete(names);
+            return DSLINK_ALLOC_ERR;
+        }
+        ref_t *pathRef = dslink_ref(path, dslink_free);
+        ref_t *namesRef = dslink_ref(names, (free_callback) json_decref);
+        if (!pathRef || !namesRef
+            || dslink_map_set(link->list_changes, pathRef, namesRef) != 0) {
+            // the map doesn't take the references when it fails
+            if (pathRef) {
+                dslink_decref(pathRef);
+            } else {
+                dslink_free(path);
+            }
+            if (namesRef) {
+                dslink_decref(namesRef);
+            } else {
+                json_delete(names);
+            }
+            return DSLINK_ALLOC_ERR;
         }
     }
+    // only the name is kept, the update is built when flushing
+    json_object_set_new(names, name, json_null());
+
+    if (link->list_building) {
+        return 0;
+    }
+    if (!link->list_timer) {
+        dslink_response_list_flush(link);
+    } else if (!uv_is_active((uv_handle_t *) link->list_timer)) {
+        uv_timer_start(link->list_timer, dslink_response_list_handler, 0, 0);
+    }
+    return 0;
+}
+
+void dslink_response_list_flush(DSLink *link) {
+    if (!link->list_changes || link->list_changes->size == 0
+        || link->list_building) {
+        return;
+    }
+    if (!link->_ws || !link->responder) {
+        dslink_map_clear(link->list_changes);
+        return;
+    }
+
+    json_t *top = json_object();
+    json_t *resps = json_array();
+    if (!top || !resps) {
+        DSLINK_CHECKED_EXEC(json_delete, top);
+        DSLINK_CHECKED_EXEC(json_delete, resps);
+        return;
+    }
+    json_object_set_new_nocheck(top, "responses", resps);
 
-    dslink_ws_send_obj(link->_ws, top);
+    DSNode *root = link->responder->super_root;
+    dslink_map_foreach(link->list_changes) {
+        const char *path = entry->key->data;
+        json_t *names = entry->value->data;
 
+        // the stream may have been closed or the node removed since
+        ref_t *rid = dslink_map_get(link->responder->list_subs, (void *) path);
+        DSNode *node = rid ? dslink_node_get_path(root, path) : NULL;
+        if (!node) {
+            continue;
+        }
+
+        json_t *resp = json_object();
+        json_t *updates = json_array();
+        if (!resp || !updates) {
+            DSLINK_CHECKED_EXEC(json_delete, resp);
+            DSLINK_CHECKED_EXEC(json_delete, updates);
+            break;
+        }
+        json_object_set_new_nocheck(resp, "rid",
+                                    json_integer(*((uint32_t *) rid->data)));
+        json_object_set_new_nocheck(resp, "stream", json_string_nocheck("open"));
+        json_object_set_new_nocheck(resp, "updates", updates);
+        json_array_append_new(resps, resp);
+
+        const char *name;
+        json_t *unused;
+        json_object_foreach(names, name, unused) {
+            json_t *update = dslink_response_list_change(node, name);
+            if (update) {
+                json_array_append_new(updates, update);
+            }
+        }
+    }
+    dslink_map_clear(link->list_changes);
+
+    if (json_array_size(resps) > 0) {
+        dslink_ws_send_obj(link->_ws, top);
+    }
     json_delete(top);
-    return 0;
 }
@@ -2,6 +2,7 @@
 #include <string.h>
 #include <dslink/stream.h>
 #include <dslink/utils.h>
+#include <dslink/writable.h>
 
 #include "dslink/msg/request_handler.h"
 #include "dslink/msg/list_response.h"
@@ -13,6 +14,7 @@
 static
 void free_stream(void* p) {
     Stream *stream = p;
+    dslink_stream_writable_free(stream);
     dslink_free((void*)stream->path);
     dslink_free(stream);
 }
@@ -39,7 +41,7 @@ int dslink_request_handle(DSLink *link, json_t *req) {
         const char *path = json_string_value(json_object_get(req, "path"));
         DSNode *node = dslink_node_get_path(link->responder->super_root, path);
         if (node && node->on_invocation) {
-            Stream *stream = dslink_malloc(sizeof(Stream));
+            Stream *stream = dslink_calloc(1, sizeof(Stream));
             if (!stream) {
                 return 1;
             }
@@ -49,6 +51,7 @@ int dslink_request_handle(DSLink *link, json_t *req) {
             ref_t *stream_ref = dslink_ref(stream, free_stream);
 
             json_t *jsonRid = json_object_get(req, "rid");
+            stream->rid = (uint32_t) json_integer_value(jsonRid);
             json_t *params = json_object_get(req, "params");
             node->on_invocation(link, node, jsonRid, params, stream_ref);
 
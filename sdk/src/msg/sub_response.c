@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include "dslink/mem/mem.h"
 #include "dslink/ws.h"
 #include "dslink/msg/sub_response.h"
@@ -29,87 +30,174 @@ int dslink_response_send_closed(DSLink *link, json_t *rid) {
     return 0;
 }
 
-void dslink_response_send_val(DSLink *link,
-                              DSNode *node,
-                              uint32_t sid) {
-    if (!node->value_timestamp) {
-        return;
-    }
-
+json_t *dslink_response_updates_new(json_t **updates) {
     json_t *top = json_object();
     if (!top) {
-        return;
+        return NULL;
     }
 
     json_t *resps = json_array();
     if (!resps) {
         json_delete(top);
-        return;
+        return NULL;
     }
     json_object_set_new_nocheck(top, "responses", resps);
 
     json_t *resp = json_object();
     if (!resp) {
         json_delete(top);
-        return;
+        return NULL;
     }
     json_array_append_new(resps, resp);
     json_object_set_new_nocheck(resp,
                                 "rid", json_integer(0));
 
-    json_t *updates = json_array();
-    if (!updates) {
+    *updates = json_array();
+    if (!*updates) {
         json_delete(top);
-        return;
+        return NULL;
     }
-    json_object_set_new_nocheck(resp, "updates", updates);
+    json_object_set_new_nocheck(resp, "updates", *updates);
+    return top;
+}
 
+int dslink_response_updates_append(json_t *updates,
+                                   DSNode *node,
+                                   uint32_t sid) {
     json_t *update = json_array();
     if (!update) {
-        json_delete(top);
-        return;
+        return DSLINK_ALLOC_ERR;
     }
 
-    json_array_append_new(updates, update);
     json_array_append_new(update, json_integer(sid));
     json_array_append(update, node->value);
     json_array_append(update, node->value_timestamp);
+    json_array_append_new(updates, update);
+    return 0;
+}
 
-    dslink_ws_send_obj(link->_ws, top);
+void dslink_response_send_val(DSLink *link,
+                              DSNode *node,
+                              uint32_t sid) {
+    if (!node->value_timestamp) {
+        return;
+    }
+
+    json_t *updates;
+    json_t *top = dslink_response_updates_new(&updates);
+    if (!top) {
+        return;
+    }
+
+    if (dslink_response_updates_append(updates, node, sid) == 0) {
+        dslink_ws_send_obj(link->_ws, top);
+    }
 
     json_delete(top);
 }
 
+// Initial values of a subscribe request are sent in messages of about
+// this size, instead of one message per path.
+#define DSLINK_SUB_BATCH_BYTES (32 * 1024)
+
+typedef struct SubBatch {
+    DSLink *link;
+    json_t *top;
+    json_t *updates;
+    size_t size;
+
+    // Paths of the nodes in the batch with an on_subscribe callback
+    const char **subscribed;
+    size_t subscribed_count;
+} SubBatch;
+
+static
+size_t sub_update_size(DSNode *node) {
+    // sid, timestamp and punctuation
+    size_t size = 48;
+    if (json_is_string(node->value)) {
+        size += json_string_length(node->value);
+    } else if (node->value) {
+        // objects and arrays can be of any size
+        size += json_dumpb(node->value, NULL, 0, JSON_COMPACT | JSON_ENCODE_ANY);
+    }
+    return size;
+}
+
+static
+int sub_batch_add(SubBatch *batch, DSNode *node, uint32_t sid) {
+    if (!batch->top) {
+        batch->top = dslink_response_updates_new(&batch->updates);
+        if (!batch->top) {
+            return DSLINK_ALLOC_ERR;
+        }
+    }
+    batch->size += sub_update_size(node);
+    return dslink_response_updates_append(batch->updates, node, sid);
+}
+
+static
+void sub_batch_flush(SubBatch *batch) {
+    if (batch->top) {
+        if (json_array_size(batch->updates) > 0) {
+            dslink_ws_send_obj(batch->link->_ws, batch->top);
+        }
+        json_delete(batch->top);
+        batch->top = NULL;
+        batch->updates = NULL;
+    }
+    batch->size = 0;
+
+    // Called after the initial values were sent, so that values updated
+    // by the callbacks arrive after them. A callback may remove nodes,
+    // look them up again.
+    DSNode *root = batch->link->responder->super_root;
+    for (size_t i = 0; i < batch->subscribed_count; ++i) {
+        DSNode *node = dslink_node_get_path(root, batch->subscribed[i]);
+        if (node && node->on_subscribe) {
+            node->on_subscribe(batch->link, node);
+        }
+    }
+    batch->subscribed_count = 0;
+}
+
 int dslink_response_sub(DSLink *link, json_t *paths, json_t *rid) {
     if (dslink_response_send_closed(link, rid) != 0) {
         return DSLINK_ALLOC_ERR;
     }
 
+    SubBatch batch;
+    memset(&batch, 0, sizeof(SubBatch));
+    batch.link = link;
+    if (json_array_size(paths) > 0) {
+        batch.subscribed = dslink_malloc(json_array_size(paths) * sizeof(char *));
+        if (!batch.subscribed) {
+            return DSLINK_ALLOC_ERR;
+        }
+    }
+
+    int ret = 0;
     DSNode *root = link->responder->super_root;
     size_t index;
     json_t *value;
     json_array_foreach(paths, index, value) {
         const char *path = json_string_value(json_object_get(value, "path"));
-        uint32_t *sid = dslink_malloc(sizeof(uint32_t));
-        if (!sid) {
-            return DSLINK_ALLOC_ERR;
-        }
-        *sid = (uint32_t) json_integer_value(json_object_get(value, "sid"));
-        ref_t *ref = dslink_int_ref(*sid);
-	ref_t *pathRef = dslink_str_ref( path );
+        uint32_t sid = (uint32_t) json_integer_value(json_object_get(value, "sid"));
+        ref_t *ref = dslink_int_ref(sid);
+        ref_t *pathRef = dslink_str_ref( path );
         if (dslink_map_set(link->responder->value_path_subs, pathRef, ref) != 0) {
-	  dslink_free(sid);
-	  dslink_decref(ref);
-	  dslink_decref(pathRef);
-	  return 1;
+            dslink_decref(ref);
+            dslink_decref(pathRef);
+            ret = 1;
+            break;
         }
         if (dslink_map_set(link->responder->value_sid_subs,
                            dslink_incref(ref), dslink_incref(pathRef)) != 0) {
-	  dslink_map_remove(link->responder->value_path_subs, (void*)path);
-	  dslink_free(sid);
-	  dslink_decref(ref);
-	  dslink_decref(pathRef);
-	  return 1;
+            dslink_map_remove(link->responder->value_path_subs, (void*)path);
+            dslink_decref(ref);
+            dslink_decref(pathRef);
+            ret = 1;
+            break;
         }
 
         DSNode *node = dslink_node_get_path(root, path);
@@ -117,14 +205,22 @@ int dslink_response_sub(DSLink *link, json_t *paths, json_t *rid) {
             continue;
         }
 
-        dslink_response_send_val(link, node, *sid);
+        if (node->value_timestamp && sub_batch_add(&batch, node, sid) != 0) {
+            ret = DSLINK_ALLOC_ERR;
+            break;
+        }
         if (node->on_subscribe) {
-            node->on_subscribe(link, node);
+            batch.subscribed[batch.subscribed_count++] = path;
         }
 
-        dslink_free(sid);
+        if (batch.size >= DSLINK_SUB_BATCH_BYTES) {
+            sub_batch_flush(&batch);
+        }
     }
-    return 0;
+
+    sub_batch_flush(&batch);
+    dslink_free(batch.subscribed);
+    return ret;
 }
 
 int dslink_response_unsub(DSLink *link, json_t *sids, json_t *rid) {
@@ -13,6 +13,8 @@
 #include "dslink/msg/sub_response.h"
 #include "dslink/utils.h"
 #include "dslink/col/vector.h"
+#include "dslink/value_snapshot.h"
+#include "dslink/rate_limit.h"
 
 #include <pthread.h>
 
@@ -106,47 +108,8 @@ int dslink_node_add_child(DSLink *link, DSNode *node) {
       node->on_subscribe(link, node);
     }
 
-    if (!link->_ws) {
-        return ret;
-    }
-
-    ref_t *refId = dslink_map_get(link->responder->list_subs,
-                                  (void *) node->parent->path);
-    if (!refId) {
-        return ret;
-    }
-    uint32_t *id = refId->data;
-    json_t *top = json_object();
-    if (!top) {
-        return ret;
-    }
-    json_t *resps = json_array();
-    if (!resps) {
-        goto cleanup;
-    }
-    json_object_set_new_nocheck(top, "responses", resps);
-    json_t *resp = json_object();
-    if (!resp) {
-        goto cleanup;
-    }
-    json_array_append_new(resps, resp);
-    json_object_set_new_nocheck(resp, "stream",
-                                json_string_nocheck("open"));
-    json_object_set_new_nocheck(resp, "rid", json_integer(*id));
-    json_t *updates = json_array();
-    if (!updates) {
-        goto cleanup;
-    }
-    json_object_set_new_nocheck(resp, "updates", updates);
-    json_t *update = json_array();
-    if (!update) {
-        goto cleanup;
-    }
-    json_array_append_new(updates, update);
-    dslink_response_list_append_child(update, node);
-    dslink_ws_send_obj(link->_ws, top);
-cleanup:
-    json_delete(top);
+    node->parent->list_version++;
+    dslink_response_list_changed(link, node->parent, node->name);
     return ret;
 }
 
@@ -202,15 +165,20 @@ void dslink_node_tree_free_basic(DSLink *link, DSNode *root) {
         dslink_map_remove(link->responder->value_sid_subs,foundMapEntry->key->data);
 
     ref_t* ridRef = dslink_map_remove_get(link->responder->list_subs,(void*)root->path);
-    if(ridRef)
+    if(ridRef) {
         dslink_map_remove(link->responder->open_streams,ridRef->data);
+        dslink_decref(ridRef);
+    }
 
 
     DSLINK_CHECKED_EXEC(dslink_free, (void *) root->path);
     DSLINK_CHECKED_EXEC(dslink_free, (void *) root->name);
     DSLINK_CHECKED_EXEC(dslink_free, (void *) root->profile);
-    DSLINK_CHECKED_EXEC(json_delete, root->value_timestamp);
-    DSLINK_CHECKED_EXEC(json_delete, root->value);
+    dslink_node_value_snapshot_retire(root);
+    dslink_node_rate_limit_free(root);
+    dslink_response_list_cache_free(root);
+    DSLINK_CHECKED_EXEC(json_decref, root->value_timestamp);
+    DSLINK_CHECKED_EXEC(json_decref, root->value);
     if (root->children) {
         dslink_map_foreach_nonext(root->children) {
             dslink_decref(entry->key);
@@ -254,50 +222,12 @@ void dslink_node_remove(DSLink* link, DSNode* node)
 }
 
 void dslink_node_tree_free(DSLink *link, DSNode *root) {
-    if (link && link->_ws && root && root->parent && root->parent->name) {
-        ref_t *rrid = dslink_map_get(link->responder->list_subs,
-                                       (void *) root->parent->path);
-        if (!rrid) {
-            goto cleanup;
-        }
-        uint32_t *rid = rrid->data;
-        json_t *top = json_object();
-        uint8_t send = 0;
-        if (top) {
-            json_t *resps = json_array();
-            if (resps) {
-                json_object_set_new_nocheck(top, "responses", resps);
-                json_t *resp = json_object();
-                if (resp) {
-                    json_array_append_new(resps, resp);
-                    json_object_set_new_nocheck(resp, "rid",
-                                                json_integer(*rid));
-                    json_object_set_new_nocheck(resp, "stream",
-                                                json_string_nocheck("open"));
-                    json_t *updates = json_array();
-                    if (updates) {
-                        json_object_set_new_nocheck(resp, "updates", updates);
-                        json_t *update = json_object();
-                        if (update) {
-                            json_array_append_new(updates, update);
-                            json_object_set_new_nocheck(update,
-                                                        "name",
-                                                        json_string_nocheck(root->name));
-                            json_object_set_new_nocheck(update,
-                                                        "change",
-                                                        json_string_nocheck("remove"));
-                            send = 1;
-                        }
-                    }
-                }
-            }
-            if (send) {
-                dslink_ws_send_obj(link->_ws, top);
-            }
-            json_delete(top);
-        }
+    if (root && root->parent) {
+        root->parent->list_version++;
+    }
+    if (link && root && root->parent && root->parent->name) {
+        dslink_response_list_changed(link, root->parent, root->name);
     }
-cleanup:
     dslink_node_tree_free_basic(link, root);
 }
 
@@ -329,11 +259,8 @@ int dslink_node_set_meta(DSLink *link, DSNode *node,
         }
     }
 
-    int rem = 0;
-
     if (!value) {
         dslink_map_remove(node->meta_data, (char *) name);
-        rem = 1;
     } else {
         name = dslink_strdup(name);
         if (!name) {
@@ -343,9 +270,17 @@ int dslink_node_set_meta(DSLink *link, DSNode *node,
         if (dslink_map_set(node->meta_data, dslink_ref((char *) name, free),
                            dslink_ref(json_incref(value), (free_callback) json_decref)) != 0) {
             dslink_free((void *) name);
+            return DSLINK_ALLOC_ERR;
         }
     }
 
+    node->list_version++;
+    // part of the entry of the node in the list of its parent
+    uint8_t summary = node->parent && dslink_response_list_summary_key(name);
+    if (summary) {
+        node->parent->list_version++;
+    }
+
     if (link) {
         if (node->on_data_changed) {
             node->on_data_changed(link, node);
@@ -353,63 +288,10 @@ int dslink_node_set_meta(DSLink *link, DSNode *node,
     } else {
         return 0;
     }
-    if (!link->_ws) {
-        return 0;
-    }
-
-    ref_t *refId = dslink_map_get(link->responder->list_subs,
-                                  (void *) node->path);
-    if (!refId) {
-        return 0;
-    }
-    uint32_t *id = refId->data;
-    json_t *top = json_object();
-    if (!top) {
-        return 1;
-    }
-    json_t *resps = json_array();
-    if (!resps) {
-        goto cleanup;
-    }
-    json_object_set_new_nocheck(top, "responses", resps);
-    json_t *resp = json_object();
-    if (!resp) {
-        goto cleanup;
-    }
-    json_array_append_new(resps, resp);
-    json_object_set_new_nocheck(resp, "stream",
-                                json_string_nocheck("open"));
-    json_object_set_new_nocheck(resp, "rid", json_integer(*id));
-    json_t *updates = json_array();
-    if (!updates) {
-        goto cleanup;
-    }
-    json_object_set_new_nocheck(resp, "updates", updates);
-
-    if (rem == 1) {
-        json_t *update = json_object();
-        if (!update) {
-            goto cleanup;
-        }
-        json_object_set_new(update, "name", json_string_nocheck(name));
-        json_object_set_new(update, "change", json_string_nocheck("remove"));
-        json_array_append_new(updates, update);
-    } else {
-        json_t *update = json_array();
-        if (!update) {
-            goto cleanup;
-        }
-        json_array_append_new(update, json_string_nocheck(name));
-        json_array_append(update, value);
-        json_array_append_new(updates, update);
+    if (summary) {
+        dslink_response_list_changed(link, node->parent, node->name);
     }
-
-    dslink_ws_send_obj(link->_ws, top);
-
-    cleanup:
-        json_delete(top);
-
-    return 0;
+    return dslink_response_list_changed(link, node, name);
 }
 
 json_t * dslink_node_get_meta(DSNode *node, const char *name) {
@@ -434,15 +316,40 @@ int dslink_node_update_value(struct DSLink *link, DSNode *node, json_t *value) {
 }
 
 int dslink_node_update_value_new(struct DSLink *link, DSNode *node, json_t *value) {
-    char ts[32];
-    dslink_create_ts(ts, sizeof(ts));
+    return dslink_node_update_value_ts(link, node, value, NULL);
+}
+
+static
+int dslink_node_store_value(DSNode *node, json_t *value, json_t *ts) {
+    char buf[32];
+    json_t *jsonTs = NULL;
 
-    json_t *jsonTs = json_string_nocheck(ts);
-    if (!jsonTs) {
-        return DSLINK_ALLOC_ERR;
+    if (json_is_string(ts)) {
+        jsonTs = ts;
+    } else {
+        if (json_is_integer(ts)) {
+            dslink_format_ts(buf, sizeof(buf), json_integer_value(ts));
+        } else {
+            dslink_create_ts_cached(buf, sizeof(buf));
+        }
+        if (ts) {
+            json_decref(ts);
+        }
+
+        if (node->value_timestamp && node->value_timestamp->refcount == 1
+            && json_string_set_nocheck(node->value_timestamp, buf) == 0) {
+            // nobody else holds the old timestamp, reuse it in place
+            jsonTs = node->value_timestamp;
+        } else {
+            jsonTs = json_string_nocheck(buf);
+            if (!jsonTs) {
+                json_decref(value);
+                return DSLINK_ALLOC_ERR;
+            }
+        }
     }
 
-    if (node->value_timestamp) {
+    if (node->value_timestamp && node->value_timestamp != jsonTs) {
         json_decref(node->value_timestamp);
     }
 
@@ -452,6 +359,15 @@ int dslink_node_update_value_new(struct DSLink *link, DSNode *node, json_t *valu
 
     node->value_timestamp = jsonTs;
     node->value = value;
+    return dslink_node_value_snapshot_publish(node);
+}
+
+int dslink_node_update_value_ts(struct DSLink *link, DSNode *node,
+                                json_t *value, json_t *ts) {
+    int ret = dslink_node_store_value(node, value, ts);
+    if (ret != 0) {
+        return ret;
+    }
 
     if (link) {
         if (node->on_data_changed) {
@@ -460,7 +376,7 @@ int dslink_node_update_value_new(struct DSLink *link, DSNode *node, json_t *valu
 
         ref_t *sid = dslink_map_get(link->responder->value_path_subs,
                                     (void *) node->path);
-        if (sid) {
+        if (sid && !dslink_node_rate_limit_hold(link, node)) {
             dslink_response_send_val(link, node, *((uint32_t *) sid->data));
         }
     }
@@ -468,6 +384,84 @@ int dslink_node_update_value_new(struct DSLink *link, DSNode *node, json_t *valu
     return 0;
 }
 
+void dslink_node_update_batch_begin(struct DSLink *link,
+                                    DSNodeUpdateBatch *batch) {
+    batch->link = link;
+    batch->top = NULL;
+    batch->updates = NULL;
+}
+
+int dslink_node_update_batch_add(DSNodeUpdateBatch *batch, DSNode *node,
+                                 json_t *value, json_t *ts) {
+    int ret = dslink_node_store_value(node, value, ts);
+    if (ret != 0) {
+        return ret;
+    }
+
+    struct DSLink *link = batch->link;
+    if (!link) {
+        return 0;
+    }
+
+    if (node->on_data_changed) {
+        node->on_data_changed(link, node);
+    }
+
+    ref_t *sid = dslink_map_get(link->responder->value_path_subs,
+                                (void *) node->path);
+    if (!sid || dslink_node_rate_limit_hold(link, node)) {
+        return 0;
+    }
+
+    if (!batch->top) {
+        batch->top = dslink_response_updates_new(&batch->updates);
+        if (!batch->top) {
+            return DSLINK_ALLOC_ERR;
+        }
+    }
+    return dslink_response_updates_append(batch->updates, node,
+                                          *((uint32_t *) sid->data));
+}
+
+int dslink_node_update_batch_commit(DSNodeUpdateBatch *batch) {
+    int ret = 0;
+    if (batch->top) {
+        if (json_array_size(batch->updates) > 0) {
+            ret = dslink_ws_send_obj(batch->link->_ws, batch->top);
+        }
+        json_delete(batch->top);
+    }
+    batch->top = NULL;
+    batch->updates = NULL;
+    return ret;
+}
+
+int dslink_node_update_values(struct DSLink *link, DSNode **nodes,
+                              json_t **values, size_t count) {
+    DSNodeUpdateBatch batch;
+    int ret = 0;
+
+    dslink_node_update_batch_begin(link, &batch);
+    for (size_t i = 0; i < count; ++i) {
+        int r = dslink_node_update_batch_add(&batch, nodes[i], values[i], NULL);
+        if (r != 0 && ret == 0) {
+            ret = r;
+        }
+    }
+    int r = dslink_node_update_batch_commit(&batch);
+    return ret != 0 ? ret : r;
+}
+
+void dslink_node_build_begin(DSLink *link) {
+    link->list_building++;
+}
+
+void dslink_node_build_end(DSLink *link) {
+    if (link->list_building > 0 && --link->list_building == 0) {
+        dslink_response_list_flush(link);
+    }
+}
+
 json_t *dslink_node_serialize(DSLink *link, DSNode *node) {
     if ( !node || node->serializable == 0 ) {
       return NULL;
@@ -525,7 +519,12 @@ json_t *dslink_node_serialize(DSLink *link, DSNode *node) {
 }
 
 void dslink_node_deserialize(DSLink *link, DSNode *node, json_t *data) {
+    // part of the entry of the node in the list of its parent, before or after
+    int summary = 0;
     if (node->meta_data) {
+        dslink_map_foreach(node->meta_data) {
+            summary |= dslink_response_list_summary_key(entry->key->data);
+        }
         dslink_map_clear(node->meta_data);
     } else {
         node->meta_data = dslink_malloc(sizeof(Map));
@@ -544,6 +543,7 @@ void dslink_node_deserialize(DSLink *link, DSNode *node, json_t *data) {
         if (strcmp(key,"?value") == 0) {
             dslink_node_update_value(NULL,node, value);
         } else {
+            summary |= dslink_response_list_summary_key(key);
             char *name = dslink_strdup(key);
             if (link && name[0] == '$' && name[1] == '$'
                 && json_is_string(value) && memcmp("\x1bpw:", json_string_value(value), 4) == 0) {
@@ -576,5 +576,10 @@ void dslink_node_deserialize(DSLink *link, DSNode *node, json_t *data) {
             }
         }
     }
+
+    node->list_version++;
+    if (summary && node->parent) {
+        node->parent->list_version++;
+    }
 }
 
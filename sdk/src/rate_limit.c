@@ -0,0 +1,123 @@
+#include "dslink/rate_limit.h"
+#include "dslink/msg/sub_response.h"
+#include "dslink/mem/mem.h"
+#include "dslink/err.h"
+
+// Never before the interval has passed. With a settle time the update then
+// waits for the node to stop changing, but at most settle ms longer.
+static
+uint64_t rate_limit_due(DSNodeRateLimit *limit) {
+    uint64_t due = limit->last_sent + limit->min_interval;
+    uint64_t settled = limit->last_update + limit->settle;
+    if (limit->settle && settled > due) {
+        due = settled < due + limit->settle ? settled : due + limit->settle;
+    }
+    return due;
+}
+
+static
+void rate_limit_flush(DSNodeRateLimit *limit, uint64_t now) {
+    limit->pending = 0;
+    limit->last_sent = now;
+
+    DSLink *link = limit->link;
+    if (!link->responder) {
+        return;
+    }
+    // the subscription may be gone by now
+    ref_t *sid = dslink_map_get(link->responder->value_path_subs,
+                                (void *) limit->node->path);
+    if (sid) {
+        dslink_response_send_val(link, limit->node, *((uint32_t *) sid->data));
+    }
+}
+
+static
+void rate_limit_timer_cb(uv_timer_t *timer) {
+    DSNodeRateLimit *limit = (DSNodeRateLimit *) timer;
+    if (!limit->pending) {
+        return;
+    }
+
+    uint64_t now = uv_now(timer->loop);
+    uint64_t due = rate_limit_due(limit);
+    if (now < due) {
+        // the settle time moved with newer updates
+        uv_timer_start(timer, rate_limit_timer_cb, due - now, 0);
+        return;
+    }
+    rate_limit_flush(limit, now);
+}
+
+static
+void rate_limit_on_close(uv_handle_t *handle) {
+    dslink_free(handle);
+}
+
+int dslink_node_set_rate_limit(DSLink *link, DSNode *node,
+                               uint32_t min_interval, uint32_t settle) {
+    DSNodeRateLimit *limit = node->rate_limit;
+    if (min_interval == 0) {
+        if (limit && limit->pending) {
+            rate_limit_flush(limit, uv_now(&link->loop));
+        }
+        dslink_node_rate_limit_free(node);
+        return 0;
+    }
+
+    if (!limit) {
+        limit = dslink_calloc(1, sizeof(DSNodeRateLimit));
+        if (!limit) {
+            return DSLINK_ALLOC_ERR;
+        }
+        uv_timer_init(&link->loop, &limit->timer);
+        limit->link = link;
+        limit->node = node;
+        node->rate_limit = limit;
+    }
+    limit->min_interval = min_interval;
+    limit->settle = settle;
+
+    if (limit->pending) {
+        uint64_t now = uv_now(&link->loop);
+        uint64_t due = rate_limit_due(limit);
+        uv_timer_start(&limit->timer, rate_limit_timer_cb,
+                       due > now ? due - now : 0, 0);
+    }
+    return 0;
+}
+
+int dslink_node_rate_limit_hold(DSLink *link, DSNode *node) {
+    DSNodeRateLimit *limit = node->rate_limit;
+    if (!limit) {
+        return 0;
+    }
+
+    uint64_t now = uv_now(&link->loop);
+    limit->last_update = now;
+    if (limit->pending) {
+        // the timer is armed already, it picks up the newest value
+        limit->conflated++;
+        return 1;
+    }
+    if (now - limit->last_sent >= limit->min_interval) {
+        limit->last_sent = now;
+        return 0;
+    }
+
+    limit->pending = 1;
+    uint64_t due = rate_limit_due(limit);
+    uv_timer_start(&limit->timer, rate_limit_timer_cb,
+                   due > now ? due - now : 0, 0);
+    return 1;
+}
+
+void dslink_node_rate_limit_free(DSNode *node) {
+    DSNodeRateLimit *limit = node->rate_limit;
+    if (!limit) {
+        return;
+    }
+    node->rate_limit = NULL;
+    uv_timer_stop(&limit->timer);
+    uv_close((uv_handle_t *) &limit->timer, rate_limit_on_close);
+}
@@ -1,6 +1,7 @@
 #include "dslink/dslink.h"
 #include "dslink/requester.h"
 #include "dslink/ws.h"
+#include "dslink/utils.h"
 
 static
 void dslink_requester_ignore_response(DSLink *link, ref_t *req, json_t *resp) {
@@ -35,6 +36,13 @@ void dslink_requester_holder_free(void *obj) {
     dslink_free(holder);
 }
 
+static
+void dslink_requester_sub_holder_free(void *obj) {
+    SubscribeCallbackHolder *holder = obj;
+    dslink_free(holder->path);
+    dslink_free(holder);
+}
+
 ref_t* dslink_requester_send_request(DSLink *link, json_t *req, request_handler_cb cb) {
     uint32_t rid = dslink_requester_incr_rid(link->requester);
 
@@ -94,7 +102,9 @@ ref_t* dslink_requester_subscribe2(DSLink* link, const char* path, value_sub_cb
 
     SubscribeCallbackHolder *subhold = dslink_malloc(sizeof(SubscribeCallbackHolder));
     subhold->cb = cbs;
-    ref_t *cbref = dslink_ref(subhold, dslink_free);
+    subhold->path = dslink_strdup(path);
+    subhold->qos = qos;
+    ref_t *cbref = dslink_ref(subhold, dslink_requester_sub_holder_free);
 
     dslink_map_set(
         link->requester->value_handlers,
@@ -183,3 +193,30 @@ int dslink_requester_close(DSLink *link, uint32_t rid) {
     json_delete(top);
     return 0;
 }
+
+int dslink_requester_resubscribe(DSLink *link) {
+    if (!(link->requester && link->requester->value_handlers->size > 0)) {
+        return 0;
+    }
+
+    json_t *paths = json_array();
+    dslink_map_foreach(link->requester->value_handlers) {
+        SubscribeCallbackHolder *subhold = entry->value->data;
+        if (!subhold->path) {
+            continue;
+        }
+        json_t *obj = json_object();
+        json_object_set_new(obj, "path", json_string_nocheck(subhold->path));
+        json_object_set_new(obj, "sid", json_integer(*((uint32_t *) entry->key->data)));
+        json_object_set_new(obj, "qos", json_integer(subhold->qos));
+        json_array_append_new(paths, obj);
+    }
+
+    json_t *json = json_object();
+    json_object_set_new(json, "method", json_string_nocheck("subscribe"));
+    json_object_set_new(json, "paths", paths);
+
+    // the request takes the reference
+    dslink_requester_send_request(link, json, dslink_requester_ignore_response);
+    return 0;
+}
@@ -0,0 +1,378 @@
+#include <string.h>
+
+#include "dslink/send_window.h"
+#include "dslink/mem/mem.h"
+#include "dslink/err.h"
+#include "dslink/ws.h"
+
+#define LOG_TAG "send_window"
+#include "dslink/log.h"
+
+typedef struct {
+    uint32_t msg;
+    uint32_t bytes;
+} InFlightMsg;
+
+struct DSLinkSendWindow {
+    uint32_t max_msgs;
+    size_t max_bytes;
+    // Held bytes above which the held messages are sent past the window
+    size_t max_held;
+    // Limit of the message a flush sends at once
+    size_t chunk_bytes;
+
+    // Circular array of the messages in flight, oldest first
+    InFlightMsg *in_flight;
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t count;
+    size_t bytes;
+
+    // Held back while the window is full
+    json_t *responses;
+    json_t *requests;
+    // Encoded size of responses and requests
+    size_t held_bytes;
+    // Map<uint32 sid, json_t update>, the latest update of every sid
+    Map updates;
+    // Set while held messages are sent, they mustn't be held again
+    uint8_t flushing;
+
+    DSLinkSendWindowStats stats;
+};
+
+int dslink_send_window_init(DSLink *link) {
+    if (link->config.send_window == 0 && link->config.send_window_bytes == 0) {
+        return 0;
+    }
+
+    DSLinkSendWindow *window = dslink_calloc(1, sizeof(DSLinkSendWindow));
+    if (!window) {
+        return DSLINK_ALLOC_ERR;
+    }
+    window->max_msgs = link->config.send_window;
+    window->max_bytes = link->config.send_window_bytes;
+    window->max_held = link->config.send_window_held_bytes;
+    if (window->max_held == 0) {
+        window->max_held = DSLINK_SEND_WINDOW_HELD_BYTES;
+    }
+    window->chunk_bytes = window->max_bytes ? window->max_bytes
+                                            : DSLINK_SEND_WINDOW_CHUNK_BYTES;
+    if (window->chunk_bytes > window->max_held) {
+        window->chunk_bytes = window->max_held;
+    }
+    window->capacity = 16;
+    window->in_flight = dslink_malloc(window->capacity * sizeof(InFlightMsg));
+    if (!window->in_flight
+        || dslink_map_init(&window->updates, dslink_map_uint32_cmp,
+                           dslink_map_uint32_key_len_cal,
+                           dslink_map_hash_key) != 0) {
+        dslink_free(window->in_flight);
+        dslink_free(window);
+        return DSLINK_ALLOC_ERR;
+    }
+
+    link->send_window = window;
+    return 0;
+}
+
+void dslink_send_window_free(DSLink *link) {
+    DSLinkSendWindow *window = link->send_window;
+    if (!window) {
+        return;
+    }
+    link->send_window = NULL;
+
+    dslink_map_free(&window->updates);
+    json_decref(window->responses);
+    json_decref(window->requests);
+    dslink_free(window->in_flight);
+    dslink_free(window);
+}
+
+static inline
+int window_full(DSLinkSendWindow *window) {
+    return (window->max_msgs && window->count >= window->max_msgs)
+           || (window->max_bytes && window->bytes >= window->max_bytes);
+}
+
+static inline
+int window_holding(DSLinkSendWindow *window) {
+    return window->responses || window->requests || window->updates.size > 0;
+}
+
+int dslink_send_window_full(DSLink *link) {
+    return link->send_window && window_full(link->send_window);
+}
+
+int dslink_send_window_blocked(DSLink *link) {
+    DSLinkSendWindow *window = link->send_window;
+    return window && (window_full(window) || window_holding(window));
+}
+
+static
+void window_hold_updates(DSLinkSendWindow *window, json_t *updates) {
+    size_t index;
+    json_t *update;
+    json_array_foreach(updates, index, update) {
+        json_t *sid;
+        if (json_is_array(update)) {
+            sid = json_array_get(update, 0);
+        } else {
+            sid = json_object_get(update, "sid");
+        }
+        if (!json_is_integer(sid)) {
+            continue;
+        }
+
+        uint32_t sidi = (uint32_t) json_integer_value(sid);
+        if (dslink_map_contains(&window->updates, &sidi)) {
+            window->stats.conflated++;
+        }
+        dslink_map_set(&window->updates, dslink_int_ref(sidi),
+                       dslink_ref(json_incref(update), (free_callback) json_decref));
+    }
+}
+
+// Size of item in a message sent by dslink_ws_send_obj, with its separator
+static inline
+size_t held_size(json_t *item) {
+    return json_dumpb(item, NULL, 0, JSON_PRESERVE_ORDER) + 2;
+}
+
+static
+void window_flush(DSLink *link);
+
+int dslink_send_window_hold(DSLink *link, json_t *obj) {
+    DSLinkSendWindow *window = link->send_window;
+    if (!window || window->flushing
+        || !(window_full(window) || window_holding(window))) {
+        return 0;
+    }
+
+    if (!window_holding(window)) {
+        window->stats.stalls++;
+        log_debug("Send window full, holding back messages\n");
+    }
+
+    json_t *responses = json_object_get(obj, "responses");
+    size_t index;
+    json_t *resp;
+    json_array_foreach(responses, index, resp) {
+        json_t *updates = json_object_get(resp, "updates");
+        if (json_integer_value(json_object_get(resp, "rid")) == 0 && updates) {
+            window_hold_updates(window, updates);
+        } else {
+            if (!window->responses) {
+                window->responses = json_array();
+            }
+            json_array_append(window->responses, resp);
+            window->held_bytes += held_size(resp);
+        }
+    }
+
+    json_t *requests = json_object_get(obj, "requests");
+    json_t *req;
+    json_array_foreach(requests, index, req) {
+        if (!window->requests) {
+            window->requests = json_array();
+        }
+        json_array_append(window->requests, req);
+        window->held_bytes += held_size(req);
+    }
+
+    // flushes if acked in the meantime or if too much is held back
+    window_flush(link);
+    return 1;
+}
+
+void dslink_send_window_sent(DSLink *link, uint32_t msg, size_t bytes) {
+    DSLinkSendWindow *window = link->send_window;
+    if (!window) {
+        return;
+    }
+
+    if (window->count == window->capacity) {
+        uint32_t capacity = window->capacity * 2;
+        InFlightMsg *in_flight = dslink_malloc(capacity * sizeof(InFlightMsg));
+        if (!in_flight) {
+            return;
+        }
+        for (uint32_t i = 0; i < window->count; ++i) {
+            in_flight[i] = window->in_flight[(window->head + i) % window->capacity];
+        }
+        dslink_free(window->in_flight);
+        window->in_flight = in_flight;
+        window->capacity = capacity;
+        window->head = 0;
+    }
+
+    InFlightMsg *entry = &window->in_flight[(window->head + window->count) % window->capacity];
+    entry->msg = msg;
+    entry->bytes = (uint32_t) bytes;
+    window->count++;
+    window->bytes += bytes;
+    if (window->count > window->stats.max_in_flight) {
+        window->stats.max_in_flight = window->count;
+    }
+}
+
+// Moves the items at the front of *held to chunk, as long as the chunk
+// stays within the limit. At least one item is moved.
+static
+void window_take(DSLinkSendWindow *window, json_t **held,
+                 json_t *chunk, size_t *size) {
+    size_t count = json_array_size(*held);
+    size_t index = 0;
+    for (; index < count; ++index) {
+        json_t *item = json_array_get(*held, index);
+        size_t len = held_size(item);
+        if (*size > 0 && *size + len > window->chunk_bytes) {
+            break;
+        }
+        *size += len;
+        window->held_bytes -= len < window->held_bytes ? len : window->held_bytes;
+        json_array_append(chunk, item);
+    }
+
+    if (index == count) {
+        json_decref(*held);
+        *held = NULL;
+        return;
+    }
+    json_t *rest = json_array();
+    for (; index < count; ++index) {
+        json_array_append(rest, json_array_get(*held, index));
+    }
+    json_decref(*held);
+    *held = rest;
+}
+
+// Takes the next message to send out of what is held back, in the order
+// it was held. Conflated updates follow the held responses.
+static
+json_t *window_take_chunk(DSLinkSendWindow *window) {
+    size_t size = 0;
+    json_t *top = json_object();
+    json_t *responses = json_array();
+    if (window->responses) {
+        window_take(window, &window->responses, responses, &size);
+    }
+
+    if (!window->responses && window->updates.size > 0
+        && size < window->chunk_bytes) {
+        json_t *updates = json_array();
+        dslink_map_foreach_nonext(&window->updates) {
+            json_t *update = entry->value->data;
+            size_t len = held_size(update);
+            if (size > 0 && size + len > window->chunk_bytes) {
+                break;
+            }
+            size += len;
+            json_array_append(updates, update);
+
+            uint32_t sid = *((uint32_t *) entry->key->data);
+            entry = entry->next;
+            dslink_map_remove(&window->updates, &sid);
+        }
+
+        if (json_array_size(updates) > 0) {
+            json_t *resp = json_object();
+            json_object_set_new_nocheck(resp, "rid", json_integer(0));
+            json_object_set_new_nocheck(resp, "updates", updates);
+            json_array_append_new(responses, resp);
+        } else {
+            json_decref(updates);
+        }
+    }
+
+    if (json_array_size(responses) > 0) {
+        json_object_set_new_nocheck(top, "responses", responses);
+    } else {
+        json_decref(responses);
+    }
+
+    if (window->requests && !window->responses && window->updates.size == 0
+        && size < window->chunk_bytes) {
+        json_t *requests = json_array();
+        window_take(window, &window->requests, requests, &size);
+        json_object_set_new_nocheck(top, "requests", requests);
+    }
+
+    if (!window->responses && !window->requests) {
+        window->held_bytes = 0;
+    }
+    return top;
+}
+
+// Sends what is held back in messages of at most chunk_bytes, until the
+// window is full again. Beyond max_held the messages are sent past the
+// window, the queue of the web socket and the writable callbacks of the
+// link take over the back pressure.
+static
+void window_flush(DSLink *link) {
+    DSLinkSendWindow *window = link->send_window;
+    if (!link->_ws) {
+        return;
+    }
+
+    window->flushing = 1;
+    while (window_holding(window)) {
+        if (window_full(window)) {
+            if (window->held_bytes <= window->max_held) {
+                break;
+            }
+            window->stats.overflows++;
+        }
+        json_t *top = window_take_chunk(window);
+        dslink_ws_send_obj(link->_ws, top);
+        json_decref(top);
+    }
+    window->flushing = 0;
+}
+
+// The broker handles messages in order, so an ack covers all messages up
+// to its id. Ids loop around from INT32_MAX to 1, see dslink_incr_msg.
+static inline
+int msg_acked(uint32_t ack, uint32_t msg) {
+    int64_t diff = (int64_t) ack - msg;
+    if (diff < -(INT32_MAX / 2)) {
+        diff += INT32_MAX;
+    } else if (diff > INT32_MAX / 2) {
+        diff -= INT32_MAX;
+    }
+    return diff >= 0;
+}
+
+void dslink_send_window_ack(DSLink *link, uint32_t msg) {
+    DSLinkSendWindow *window = link->send_window;
+    if (!window) {
+        return;
+    }
+
+    while (window->count > 0) {
+        InFlightMsg *entry = &window->in_flight[window->head];
+        if (!msg_acked(msg, entry->msg)) {
+            break;
+        }
+        window->bytes -= entry->bytes;
+        window->head = (window->head + 1) % window->capacity;
+        window->count--;
+    }
+
+    window_flush(link);
+}
+
+void dslink_send_window_stats(DSLink *link, DSLinkSendWindowStats *stats) {
+    DSLinkSendWindow *window = link->send_window;
+    if (!window) {
+        memset(stats, 0, sizeof(DSLinkSendWindowStats));
+        return;
+    }
+    *stats = window->stats;
+    stats->in_flight = window->count;
+    stats->in_flight_bytes = window->bytes;
+    stats->held = json_array_size(window->responses) + json_array_size(window->requests);
+    stats->held_bytes = window->held_bytes;
+    stats->pending_updates = window->updates.size;
+}
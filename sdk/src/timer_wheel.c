@@ -0,0 +1,171 @@
+#include <string.h>
+
+#include "dslink/timer_wheel.h"
+
+#define WHEEL_MASK (DSLINK_TIMER_WHEEL_SIZE - 1)
+#define WHEEL_MAX_TICKS \
+    ((uint64_t) 1 << (DSLINK_TIMER_WHEEL_BITS * DSLINK_TIMER_WHEEL_LEVELS))
+
+static
+void wheel_tick_cb(uv_timer_t *handle) {
+    dslink_timer_wheel_run(handle->data, uv_now(handle->loop));
+}
+
+int dslink_timer_wheel_init(DSLinkTimerWheel *wheel, uv_loop_t *loop,
+                            uint64_t tick) {
+    memset(wheel, 0, sizeof(DSLinkTimerWheel));
+    wheel->tick = tick > 0 ? tick : 1;
+    wheel->start = uv_now(loop);
+    wheel->time = wheel->start;
+
+    int ret = uv_timer_init(loop, &wheel->handle);
+    wheel->handle.data = wheel;
+    return ret;
+}
+
+void dslink_timer_wheel_close(DSLinkTimerWheel *wheel, uv_close_cb close_cb) {
+    for (int level = 0; level < DSLINK_TIMER_WHEEL_LEVELS; ++level) {
+        for (int i = 0; i < DSLINK_TIMER_WHEEL_SIZE; ++i) {
+            DSLinkTimer *timer = wheel->slots[level][i];
+            while (timer) {
+                DSLinkTimer *next = timer->next;
+                timer->next = NULL;
+                timer->pprev = NULL;
+                timer = next;
+            }
+            wheel->slots[level][i] = NULL;
+        }
+    }
+    wheel->count = 0;
+
+    uv_timer_stop(&wheel->handle);
+    uv_close((uv_handle_t *) &wheel->handle, close_cb);
+}
+
+// Level n holds the timers due within 2^(BITS * (n + 1)) ticks, indexed
+// by the bits of their tick at that level. Higher levels are cascaded
+// down when the lower level wraps around, see dslink_timer_wheel_run.
+static
+void wheel_add(DSLinkTimerWheel *wheel, DSLinkTimer *timer) {
+    if (timer->expire < wheel->now) {
+        timer->expire = wheel->now;
+    }
+    uint64_t delta = timer->expire - wheel->now;
+    if (delta >= WHEEL_MAX_TICKS) {
+        delta = WHEEL_MAX_TICKS - 1;
+        timer->expire = wheel->now + delta;
+    }
+
+    int level = 0;
+    while (delta >= ((uint64_t) 1 << (DSLINK_TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+
+    uint64_t index = (timer->expire >> (DSLINK_TIMER_WHEEL_BITS * level)) & WHEEL_MASK;
+    DSLinkTimer **slot = &wheel->slots[level][index];
+    timer->next = *slot;
+    if (*slot) {
+        (*slot)->pprev = &timer->next;
+    }
+    *slot = timer;
+    timer->pprev = slot;
+}
+
+static
+uint64_t wheel_cascade(DSLinkTimerWheel *wheel, int level, uint64_t index) {
+    DSLinkTimer *timer = wheel->slots[level][index];
+    wheel->slots[level][index] = NULL;
+    while (timer) {
+        DSLinkTimer *next = timer->next;
+        wheel_add(wheel, timer);
+        timer = next;
+    }
+    return index;
+}
+
+static inline
+uint64_t wheel_ticks(DSLinkTimerWheel *wheel, uint64_t ms) {
+    return (ms + wheel->tick - 1) / wheel->tick;
+}
+
+void dslink_timer_wheel_run(DSLinkTimerWheel *wheel, uint64_t now) {
+    if (now > wheel->time) {
+        wheel->time = now;
+    }
+    uint64_t target = (wheel->time - wheel->start) / wheel->tick;
+
+    while (wheel->count > 0 && wheel->now <= target) {
+        uint64_t index = wheel->now & WHEEL_MASK;
+        if (index == 0) {
+            for (int level = 1; level < DSLINK_TIMER_WHEEL_LEVELS; ++level) {
+                uint64_t i = (wheel->now >> (DSLINK_TIMER_WHEEL_BITS * level)) & WHEEL_MASK;
+                if (wheel_cascade(wheel, level, i) != 0) {
+                    break;
+                }
+            }
+        }
+        wheel->now++;
+
+        // Detach the slot, callbacks may stop or re-arm any timer
+        DSLinkTimer *head = wheel->slots[0][index];
+        wheel->slots[0][index] = NULL;
+        if (head) {
+            head->pprev = &head;
+        }
+        while (head) {
+            DSLinkTimer *timer = head;
+            dslink_timer_stop(timer);
+            if (timer->repeat) {
+                timer->expire += wheel_ticks(wheel, timer->repeat);
+                wheel_add(wheel, timer);
+                wheel->count++;
+            }
+            timer->cb(timer);
+        }
+    }
+
+    if (wheel->count == 0) {
+        uv_timer_stop(&wheel->handle);
+    }
+}
+
+void dslink_timer_init(DSLinkTimer *timer, dslink_timer_cb cb, void *data) {
+    memset(timer, 0, sizeof(DSLinkTimer));
+    timer->cb = cb;
+    timer->data = data;
+}
+
+void dslink_timer_start(DSLinkTimerWheel *wheel, DSLinkTimer *timer,
+                        uint64_t timeout, uint64_t repeat) {
+    dslink_timer_stop(timer);
+
+    uint64_t time = uv_now(wheel->handle.loop);
+    if (time < wheel->time) {
+        time = wheel->time;
+    }
+    if (wheel->count == 0) {
+        // nothing armed, the wheel can skip the idle ticks
+        wheel->time = time;
+        wheel->now = (time - wheel->start) / wheel->tick;
+        uv_timer_start(&wheel->handle, wheel_tick_cb, wheel->tick, wheel->tick);
+    }
+
+    timer->wheel = wheel;
+    timer->repeat = repeat;
+    timer->expire = wheel_ticks(wheel, time - wheel->start + timeout);
+    wheel_add(wheel, timer);
+    wheel->count++;
+}
+
+void dslink_timer_stop(DSLinkTimer *timer) {
+    if (!timer->pprev) {
+        return;
+    }
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->wheel->count--;
+}
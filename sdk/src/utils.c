@@ -200,35 +200,68 @@ int dslink_str_starts_with(const char *a, const char *b) {
     return 1;
 }
 
-size_t dslink_create_ts(char *buf, size_t bufLen) {
-    struct timeval now;
-    gettimeofday(&now, NULL);
-    time_t nowtime = now.tv_sec;
+static
+void dslink_ts_format_second(char *buf, size_t bufLen, time_t sec) {
     struct tm result;
 
     strftime(buf, bufLen,
-                    "%Y-%m-%dT%H:%M:%S.000?%z", localtime_r(&nowtime, &result));
-    unsigned ms = (unsigned)(now.tv_usec / 1000);
-    char msstr[4];
-
-    if (ms > 99) {
-        snprintf(msstr, 4, "%u", ms);
-        memcpy(buf+20, msstr, 3);
-    } else if (ms > 9) {
-        snprintf(msstr, 4, "0%u", ms);
-        memcpy(buf+20, msstr, 3);
-    } else if (ms > 0) {
-        snprintf(msstr, 4, "00%u", ms);
-        memcpy(buf+20, msstr, 3);
-    }
+                    "%Y-%m-%dT%H:%M:%S.000?%z", localtime_r(&sec, &result));
     // change timezone format from ?+0000 to +00:00
     buf[23] = buf[24];
     buf[24] = buf[25];
     buf[25] = buf[26];
     buf[26] = ':';
+}
+
+static inline
+void dslink_ts_patch_ms(char *buf, unsigned ms) {
+    buf[20] = (char) ('0' + ms / 100);
+    buf[21] = (char) ('0' + (ms / 10) % 10);
+    buf[22] = (char) ('0' + ms % 10);
+}
+
+size_t dslink_create_ts(char *buf, size_t bufLen) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    dslink_ts_format_second(buf, bufLen, now.tv_sec);
+    dslink_ts_patch_ms(buf, (unsigned)(now.tv_usec / 1000));
     return 29;
 }
 
+// The formatted second is cached per thread, so the event loop (and any
+// producer thread) only pays for localtime_r/strftime once per second.
+static __thread time_t ts_cache_sec = -1;
+static __thread char ts_cache_buf[DSLINK_TS_LEN + 1];
+
+size_t dslink_format_ts(char *buf, size_t bufLen, int64_t millis) {
+    if (bufLen < DSLINK_TS_LEN + 1) {
+        return 0;
+    }
+    time_t sec = (time_t) (millis / 1000);
+    int64_t ms = millis % 1000;
+    if (ms < 0) {
+        sec--;
+        ms += 1000;
+    }
+
+    if (sec != ts_cache_sec) {
+        dslink_ts_format_second(ts_cache_buf, sizeof(ts_cache_buf), sec);
+        ts_cache_sec = sec;
+    }
+
+    memcpy(buf, ts_cache_buf, DSLINK_TS_LEN + 1);
+    dslink_ts_patch_ms(buf, (unsigned) ms);
+    return DSLINK_TS_LEN;
+}
+
+size_t dslink_create_ts_cached(char *buf, size_t bufLen) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return dslink_format_ts(buf, bufLen,
+                            (int64_t) now.tv_sec * 1000 + now.tv_usec / 1000);
+}
+
 int dslink_sleep(long ms) {
     struct timespec req;
 
@@ -243,6 +276,24 @@ int dslink_sleep(long ms) {
     return nanosleep(&req, NULL);
 }
 
+long dslink_backoff_delay(uint32_t attempt, long base, long cap, uint32_t rnd) {
+    if (base <= 0 || cap <= 0) {
+        return 0;
+    }
+    long window = base;
+    while (attempt-- > 0 && window < cap) {
+        if (window > cap / 2) {
+            window = cap;
+            break;
+        }
+        window *= 2;
+    }
+    if (window > cap) {
+        window = cap;
+    }
+    return (long) (rnd % ((unsigned long) window + 1));
+}
+
 const char* dslink_checkIpv4Address(const char* address)
 {
     const char* host = address;
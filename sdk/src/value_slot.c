@@ -0,0 +1,212 @@
+#include <string.h>
+#include <sys/time.h>
+
+#include "dslink/value_slot.h"
+#include "dslink/mem/mem.h"
+#include "dslink/err.h"
+#include "dslink/utils.h"
+
+DSNodeValueSlot *dslink_node_value_slot_create(DSLink *link, DSNode *node) {
+    if (!link || !node) {
+        return NULL;
+    }
+    DSNodeValueSlot *slot = dslink_calloc(1, sizeof(DSNodeValueSlot));
+    if (!slot) {
+        return NULL;
+    }
+    slot->link = link;
+    slot->node = node;
+    return slot;
+}
+
+static
+void dslink_node_value_slot_destroy(DSNodeValueSlot *slot) {
+    if (slot->type == DSLINK_SLOT_JSON) {
+        json_decref(slot->value.json);
+    }
+    dslink_free(slot);
+}
+
+void dslink_node_value_slot_free(DSNodeValueSlot *slot) {
+    if (!slot) {
+        return;
+    }
+    if (__atomic_load_n(&slot->dirty, __ATOMIC_ACQUIRE)) {
+        // still on the dirty list, the next drain frees it
+        slot->released = 1;
+        return;
+    }
+    dslink_node_value_slot_destroy(slot);
+}
+
+static inline
+uint32_t slot_lock(DSNodeValueSlot *slot) {
+    uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    for (;;) {
+        if ((seq & 1) == 0
+            && __atomic_compare_exchange_n(&slot->seq, &seq, seq + 1, 1,
+                                           __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return seq;
+        }
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    }
+}
+
+static inline
+void slot_unlock(DSNodeValueSlot *slot, uint32_t seq) {
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+static
+int slot_mark_dirty(DSNodeValueSlot *slot) {
+    if (__atomic_exchange_n(&slot->dirty, 1, __ATOMIC_ACQ_REL)) {
+        // already queued, the loop will pick up the new value
+        return 0;
+    }
+
+    DSLink *link = slot->link;
+    DSNodeValueSlot *head = __atomic_load_n(&link->dirty_value_slots, __ATOMIC_RELAXED);
+    do {
+        slot->next_dirty = head;
+    } while (!__atomic_compare_exchange_n(&link->dirty_value_slots, &head, slot, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    if (!head) {
+        return uv_async_send(&link->async_tasks);
+    }
+    return 0;
+}
+
+static
+int slot_set(DSNodeValueSlot *slot, uint8_t type, int64_t i, double d, json_t *json) {
+    if (!slot) {
+        DSLINK_CHECKED_EXEC(json_decref, json);
+        return EINVAL;
+    }
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    // the payload is accessed with relaxed atomics, so the optimistic reads
+    // of the loop are well defined
+    int64_t bits = i;
+    if (type == DSLINK_SLOT_DOUBLE) {
+        memcpy(&bits, &d, sizeof(bits));
+    } else if (type == DSLINK_SLOT_JSON) {
+        bits = (int64_t) (intptr_t) json;
+    }
+
+    json_t *replaced = NULL;
+    uint32_t seq = slot_lock(slot);
+    if (slot->type == DSLINK_SLOT_JSON) {
+        replaced = slot->value.json;
+    }
+    __atomic_store_n(&slot->type, type, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->value.i, bits, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->ts, (int64_t) now.tv_sec * 1000 + now.tv_usec / 1000,
+                     __ATOMIC_RELAXED);
+    slot_unlock(slot, seq);
+
+    // a value that was never published is simply dropped
+    DSLINK_CHECKED_EXEC(json_decref, replaced);
+    return slot_mark_dirty(slot);
+}
+
+int dslink_node_value_slot_set_bool(DSNodeValueSlot *slot, int value) {
+    return slot_set(slot, DSLINK_SLOT_BOOL, value ? 1 : 0, 0, NULL);
+}
+
+int dslink_node_value_slot_set_int(DSNodeValueSlot *slot, int64_t value) {
+    return slot_set(slot, DSLINK_SLOT_INT, value, 0, NULL);
+}
+
+int dslink_node_value_slot_set_double(DSNodeValueSlot *slot, double value) {
+    return slot_set(slot, DSLINK_SLOT_DOUBLE, 0, value, NULL);
+}
+
+int dslink_node_value_slot_set_json(DSNodeValueSlot *slot, json_t *value) {
+    if (!value) {
+        return EINVAL;
+    }
+    return slot_set(slot, DSLINK_SLOT_JSON, 0, 0, value);
+}
+
+static
+json_t *slot_take_value(DSNodeValueSlot *slot, int64_t *ts) {
+    uint8_t type = DSLINK_SLOT_NONE;
+    int64_t i = 0;
+    double d = 0;
+    uint32_t seq;
+
+    // scalars are read optimistically, retrying if a producer interfered
+    do {
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;
+        }
+        type = __atomic_load_n(&slot->type, __ATOMIC_RELAXED);
+        i = __atomic_load_n(&slot->value.i, __ATOMIC_RELAXED);
+        *ts = __atomic_load_n(&slot->ts, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&slot->seq, __ATOMIC_RELAXED));
+    memcpy(&d, &i, sizeof(d));
+
+    if (seq == slot->published) {
+        // already sent with an earlier drain
+        return NULL;
+    }
+    slot->published = seq;
+
+    switch (type) {
+        case DSLINK_SLOT_BOOL:
+            return json_boolean(i);
+        case DSLINK_SLOT_INT:
+            return json_integer(i);
+        case DSLINK_SLOT_DOUBLE:
+            return json_real(d);
+        case DSLINK_SLOT_JSON: {
+            // the json value changes hands, so this needs the lock
+            json_t *json = NULL;
+            seq = slot_lock(slot);
+            if (slot->type == DSLINK_SLOT_JSON) {
+                json = slot->value.json;
+                slot->type = DSLINK_SLOT_NONE;
+                *ts = slot->ts;
+            }
+            slot_unlock(slot, seq);
+            return json;
+        }
+        default:
+            return NULL;
+    }
+}
+
+void dslink_node_value_slots_drain(DSLink *link) {
+    DSNodeValueSlot *slot = __atomic_exchange_n(&link->dirty_value_slots, NULL,
+                                                __ATOMIC_ACQUIRE);
+    if (!slot) {
+        return;
+    }
+
+    DSNodeUpdateBatch batch;
+    dslink_node_update_batch_begin(link, &batch);
+    while (slot) {
+        // read the link before clearing the flag, a producer may queue
+        // the slot again right after that
+        DSNodeValueSlot *next = slot->next_dirty;
+        __atomic_store_n(&slot->dirty, 0, __ATOMIC_SEQ_CST);
+
+        if (slot->released) {
+            dslink_node_value_slot_destroy(slot);
+        } else {
+            int64_t ts;
+            json_t *value = slot_take_value(slot, &ts);
+            if (value) {
+                dslink_node_update_batch_add(&batch, slot->node, value,
+                                             json_integer(ts));
+            }
+        }
+        slot = next;
+    }
+    dslink_node_update_batch_commit(&batch);
+}
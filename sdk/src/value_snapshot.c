@@ -0,0 +1,158 @@
+#include <string.h>
+
+#include "dslink/value_snapshot.h"
+#include "dslink/dslink.h"
+#include "dslink/col/vector.h"
+#include "dslink/mem/mem.h"
+#include "dslink/err.h"
+
+static
+void snapshot_free(DSNodeValueSnapshot *snapshot) {
+    json_decref(snapshot->value);
+    json_decref(snapshot->ts);
+    dslink_free(snapshot);
+}
+
+static
+void snapshot_retire(DSNodeValueSnapshots *snapshots,
+                     DSNodeValueSnapshot *snapshot) {
+    if (__atomic_sub_fetch(&snapshot->refs, 1, __ATOMIC_SEQ_CST) == 0
+        && __atomic_load_n(&snapshots->readers, __ATOMIC_SEQ_CST) == 0) {
+        snapshot_free(snapshot);
+        return;
+    }
+
+    if (vector_append(&snapshots->retired, &snapshot) < 0) {
+        // leaking is the only safe option here
+        return;
+    }
+}
+
+static
+size_t snapshots_reclaim(DSNodeValueSnapshots *snapshots) {
+    Vector *retired = &snapshots->retired;
+    if (retired->size == 0) {
+        return 0;
+    }
+    if (__atomic_load_n(&snapshots->readers, __ATOMIC_SEQ_CST) != 0) {
+        return retired->size;
+    }
+
+    DSNodeValueSnapshot **list = retired->data;
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < retired->size; ++i) {
+        if (__atomic_load_n(&list[i]->refs, __ATOMIC_SEQ_CST) == 0) {
+            snapshot_free(list[i]);
+        } else {
+            list[kept++] = list[i];
+        }
+    }
+    retired->size = kept;
+    return kept;
+}
+
+size_t dslink_node_value_snapshots_reclaim(DSLink *link) {
+    if (!link || !link->responder || !link->responder->snapshots) {
+        return 0;
+    }
+    return snapshots_reclaim(link->responder->snapshots);
+}
+
+void dslink_node_value_snapshots_free(DSLink *link) {
+    if (!link || !link->responder || !link->responder->snapshots) {
+        return;
+    }
+
+    DSNodeValueSnapshots *snapshots = link->responder->snapshots;
+    DSNodeValueSnapshot **list = snapshots->retired.data;
+    for (uint32_t i = 0; i < snapshots->retired.size; ++i) {
+        snapshot_free(list[i]);
+    }
+    vector_free(&snapshots->retired);
+    dslink_free(snapshots);
+    link->responder->snapshots = NULL;
+}
+
+int dslink_node_value_snapshot_publish(DSNode *node) {
+    DSNodeValueSnapshots *snapshots = node->snapshots;
+    if (!snapshots) {
+        return 0;
+    }
+
+    DSNodeValueSnapshot *snapshot = NULL;
+    if (node->value) {
+        snapshot = dslink_malloc(sizeof(DSNodeValueSnapshot));
+        if (!snapshot) {
+            return DSLINK_ALLOC_ERR;
+        }
+        snapshot->refs = 1;
+        snapshot->value = json_incref(node->value);
+        snapshot->ts = json_incref(node->value_timestamp);
+    }
+
+    DSNodeValueSnapshot *old = __atomic_exchange_n(&node->snapshot, snapshot,
+                                                   __ATOMIC_SEQ_CST);
+    if (old) {
+        snapshot_retire(snapshots, old);
+    }
+    snapshots_reclaim(snapshots);
+    return 0;
+}
+
+int dslink_node_value_snapshot_enable(DSLink *link, DSNode *node) {
+    if (!link || !link->responder || !node) {
+        return EINVAL;
+    }
+
+    Responder *responder = link->responder;
+    if (!responder->snapshots) {
+        DSNodeValueSnapshots *snapshots = dslink_calloc(1, sizeof(DSNodeValueSnapshots));
+        if (!snapshots) {
+            return DSLINK_ALLOC_ERR;
+        }
+        if (vector_init(&snapshots->retired, 16, sizeof(DSNodeValueSnapshot *)) != 0) {
+            dslink_free(snapshots);
+            return DSLINK_ALLOC_ERR;
+        }
+        responder->snapshots = snapshots;
+    }
+    __atomic_store_n(&node->snapshots, responder->snapshots, __ATOMIC_SEQ_CST);
+    return dslink_node_value_snapshot_publish(node);
+}
+
+void dslink_node_value_snapshot_retire(DSNode *node) {
+    DSNodeValueSnapshots *snapshots = node->snapshots;
+    if (!snapshots) {
+        return;
+    }
+    DSNodeValueSnapshot *old = __atomic_exchange_n(&node->snapshot, NULL,
+                                                   __ATOMIC_SEQ_CST);
+    if (old) {
+        snapshot_retire(snapshots, old);
+    }
+}
+
+DSNodeValueSnapshot *dslink_node_value_snapshot_acquire(DSNode *node) {
+    if (!node) {
+        return NULL;
+    }
+    DSNodeValueSnapshots *snapshots = __atomic_load_n(&node->snapshots, __ATOMIC_SEQ_CST);
+    if (!snapshots) {
+        return NULL;
+    }
+
+    __atomic_add_fetch(&snapshots->readers, 1, __ATOMIC_SEQ_CST);
+    DSNodeValueSnapshot *snapshot = __atomic_load_n(&node->snapshot, __ATOMIC_SEQ_CST);
+    if (snapshot) {
+        __atomic_add_fetch(&snapshot->refs, 1, __ATOMIC_SEQ_CST);
+    }
+    __atomic_sub_fetch(&snapshots->readers, 1, __ATOMIC_SEQ_CST);
+
+    return snapshot;
+}
+
+void dslink_node_value_snapshot_release(DSNodeValueSnapshot *snapshot) {
+    if (snapshot) {
+        __atomic_sub_fetch(&snapshot->refs, 1, __ATOMIC_SEQ_CST);
+    }
+}
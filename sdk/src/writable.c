@@ -0,0 +1,259 @@
+#include <wslay/wslay.h>
+
+#include "dslink/writable.h"
+#include "dslink/ws.h"
+#include "dslink/mem/mem.h"
+#include "dslink/err.h"
+#include "dslink/utils.h"
+
+static
+DSLinkWritable *link_writable(DSLink *link) {
+    if (!link->writable) {
+        link->writable = dslink_calloc(1, sizeof(DSLinkWritable));
+        if (link->writable) {
+            link->writable->sent_total = link->queued_total;
+        }
+    }
+    return link->writable;
+}
+
+static
+void stream_unlink(DSStreamWritable *s) {
+    if (s->pprev) {
+        *s->pprev = s->next;
+        if (s->next) {
+            s->next->pprev = s->pprev;
+        }
+        s->next = NULL;
+        s->pprev = NULL;
+    }
+}
+
+static
+void stream_link(DSStreamWritable **head, DSStreamWritable *s) {
+    s->next = *head;
+    if (s->next) {
+        s->next->pprev = &s->next;
+    }
+    s->pprev = head;
+    *head = s;
+}
+
+static
+void stream_drain(DSStreamWritable *s, uint64_t sent_total) {
+    while (s->count > 0 && s->ends[s->head] <= sent_total) {
+        s->queued -= s->lens[s->head];
+        s->head = (s->head + 1) % s->capacity;
+        s->count--;
+    }
+}
+
+static
+int stream_queued(DSStreamWritable *s, uint64_t end, uint32_t len) {
+    if (s->count == s->capacity) {
+        uint32_t capacity = s->capacity ? s->capacity * 2 : 16;
+        uint64_t *ends = dslink_malloc(capacity * sizeof(uint64_t));
+        uint32_t *lens = dslink_malloc(capacity * sizeof(uint32_t));
+        if (!ends || !lens) {
+            DSLINK_CHECKED_EXEC(dslink_free, ends);
+            DSLINK_CHECKED_EXEC(dslink_free, lens);
+            return DSLINK_ALLOC_ERR;
+        }
+        for (uint32_t i = 0; i < s->count; ++i) {
+            ends[i] = s->ends[(s->head + i) % s->capacity];
+            lens[i] = s->lens[(s->head + i) % s->capacity];
+        }
+        DSLINK_CHECKED_EXEC(dslink_free, s->ends);
+        DSLINK_CHECKED_EXEC(dslink_free, s->lens);
+        s->ends = ends;
+        s->lens = lens;
+        s->capacity = capacity;
+        s->head = 0;
+    }
+
+    uint32_t tail = (s->head + s->count) % s->capacity;
+    s->ends[tail] = end;
+    s->lens[tail] = len;
+    s->count++;
+    s->queued += len;
+    return 0;
+}
+
+size_t dslink_queued_bytes(DSLink *link) {
+    if (!link->_ws) {
+        return 0;
+    }
+    return wslay_event_get_queued_msg_length(link->_ws);
+}
+
+int dslink_is_writable(DSLink *link) {
+    return !(link->writable && link->writable->unwritable);
+}
+
+int dslink_set_writable_cb(DSLink *link, size_t high, size_t low,
+                           link_writable_cb cb) {
+    DSLinkWritable *w = link_writable(link);
+    if (!w) {
+        return DSLINK_ALLOC_ERR;
+    }
+    // kept allocated, this may be called from the callback
+    w->high = high;
+    w->low = low < high ? low : high;
+    w->cb = high ? cb : NULL;
+    w->unwritable = 0;
+    dslink_writable_update(link);
+    return 0;
+}
+
+int dslink_stream_set_writable_cb(DSLink *link, Stream *stream,
+                                  size_t high, size_t low,
+                                  stream_writable_cb cb) {
+    DSLinkWritable *w = link_writable(link);
+    if (!w) {
+        return DSLINK_ALLOC_ERR;
+    }
+
+    DSStreamWritable *s = stream->writable;
+    if (!s) {
+        s = dslink_calloc(1, sizeof(DSStreamWritable));
+        if (!s) {
+            return DSLINK_ALLOC_ERR;
+        }
+        s->link = link;
+        s->stream = stream;
+        stream->writable = s;
+        stream_link(&w->streams, s);
+    }
+    s->high = high;
+    s->low = low < high ? low : high;
+    s->cb = high ? cb : NULL;
+    s->unwritable = s->cb && s->queued >= s->high;
+    return 0;
+}
+
+size_t dslink_stream_queued_bytes(Stream *stream) {
+    return stream->writable ? stream->writable->queued : 0;
+}
+
+int dslink_stream_is_writable(Stream *stream) {
+    return !(stream->writable && stream->writable->unwritable);
+}
+
+int dslink_stream_send(DSLink *link, Stream *stream, json_t *resp) {
+    if (!link->_ws) {
+        return DSLINK_SOCK_WRITE_ERR;
+    }
+
+    json_t *top = json_object();
+    json_t *resps = json_array();
+    if (!top || !resps) {
+        DSLINK_CHECKED_EXEC(json_delete, top);
+        DSLINK_CHECKED_EXEC(json_delete, resps);
+        return DSLINK_ALLOC_ERR;
+    }
+    json_object_set_new_nocheck(top, "responses", resps);
+    json_array_append(resps, resp);
+    json_object_set_new_nocheck(resp, "rid", json_integer(stream->rid));
+
+    uint64_t before = link->queued_total;
+    int ret = dslink_ws_send_obj(link->_ws, top);
+    json_decref(top);
+
+    // nothing is queued while the send window holds the message back
+    DSStreamWritable *s = stream->writable;
+    if (ret != 0 || !s || link->queued_total == before) {
+        return ret;
+    }
+    ret = stream_queued(s, link->queued_total,
+                        (uint32_t) (link->queued_total - before));
+    if (s->cb && !s->unwritable && s->queued >= s->high) {
+        s->unwritable = 1;
+        s->cb(link, stream, 0);
+    }
+    return ret;
+}
+
+void dslink_writable_update(DSLink *link) {
+    DSLinkWritable *w = link->writable;
+    if (!w) {
+        return;
+    }
+
+    size_t queued = dslink_queued_bytes(link);
+    if (link->queued_total - queued > w->sent_total) {
+        w->sent_total = link->queued_total - queued;
+    }
+
+    // Streams which drained are notified after the walk, the callbacks
+    // may send or close streams
+    DSStreamWritable *ready = NULL;
+    for (DSStreamWritable *s = w->streams, *next; s; s = next) {
+        next = s->next;
+        stream_drain(s, w->sent_total);
+        if (s->unwritable && s->queued <= s->low) {
+            s->unwritable = 0;
+            stream_unlink(s);
+            stream_link(&ready, s);
+        }
+    }
+    while (ready) {
+        DSStreamWritable *s = ready;
+        stream_unlink(s);
+        stream_link(&w->streams, s);
+        if (s->cb) {
+            s->cb(link, s->stream, 1);
+        }
+    }
+
+    if (!w->cb) {
+        return;
+    }
+    if (!w->unwritable && queued >= w->high) {
+        w->unwritable = 1;
+        w->cb(link, 0);
+    } else if (w->unwritable && queued <= w->low) {
+        w->unwritable = 0;
+        w->cb(link, 1);
+    }
+}
+
+void dslink_stream_writable_free(Stream *stream) {
+    DSStreamWritable *s = stream->writable;
+    if (!s) {
+        return;
+    }
+    stream->writable = NULL;
+    stream_unlink(s);
+    DSLINK_CHECKED_EXEC(dslink_free, s->ends);
+    DSLINK_CHECKED_EXEC(dslink_free, s->lens);
+    dslink_free(s);
+}
+
+void dslink_writable_reset(DSLink *link) {
+    DSLinkWritable *w = link->writable;
+    if (!w) {
+        return;
+    }
+    // the streams are closed with the connection
+    while (w->streams) {
+        DSStreamWritable *s = w->streams;
+        stream_unlink(s);
+    }
+    // the bytes still queued are gone, an unwritable link turns writable
+    // with the first update of the next connection
+    w->sent_total = link->queued_total;
+}
+
+void dslink_writable_free(DSLink *link) {
+    DSLinkWritable *w = link->writable;
+    if (!w) {
+        return;
+    }
+    // the streams outlive this, they only lose their accounting
+    while (w->streams) {
+        DSStreamWritable *s = w->streams;
+        stream_unlink(s);
+    }
+    link->writable = NULL;
+    dslink_free(w);
+}
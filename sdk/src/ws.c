@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
 
 #include <mbedtls/base64.h>
 #include <mbedtls/ecdh.h>
@@ -11,6 +12,9 @@
 
 #include "dslink/msg/request_handler.h"
 #include "dslink/msg/response_handler.h"
+#include "dslink/requester.h"
+#include "dslink/send_window.h"
+#include "dslink/writable.h"
 #include "dslink/handshake.h"
 #include "dslink/ws.h"
 #include "dslink/utils.h"
@@ -29,6 +33,11 @@
     "Sec-WebSocket-Version: 13\r\n" \
     "\r\n"
 
+// Pings and the idle timeout run on the timer wheel of the connection
+#define DSLINK_TIMER_TICK 1000
+#define DSLINK_PING_INTERVAL 30000
+#define DSLINK_IDLE_TIMEOUT 90000
+
 static
 int gen_mask_cb(wslay_event_context_ptr ctx,
                 uint8_t *buf, size_t len,
@@ -108,23 +117,47 @@ void io_handler(uv_poll_t *poll, int status, int events) {
                 uv_stop(&link->loop);
                 return;
             }
+            dslink_writable_update(link);
         }
     }
 }
 
 int dslink_ws_send_obj(wslay_event_context_ptr ctx, json_t *obj) {
     DSLink *link = ctx->user_data;
+
+    // Only messages the broker acks count against the send window
+    uint8_t tracked = link->send_window
+                      && (json_object_get(obj, "responses")
+                          || json_object_get(obj, "requests"));
+    if (tracked && dslink_send_window_hold(link, obj)) {
+        return 0;
+    }
+
     uint32_t msg = dslink_incr_msg(link);
 
     json_t *jsonMsg = json_integer(msg);
     json_object_set(obj, "msg", jsonMsg);
 
+    // piggyback the pending ack
+    uint8_t ack = 0;
+    if (link->pending_ack && !json_object_get(obj, "ack")) {
+        json_object_set_new_nocheck(obj, "ack", json_integer(link->pending_ack));
+        link->pending_ack = 0;
+        ack = 1;
+    }
+
     char *data = json_dumps(obj, JSON_PRESERVE_ORDER);
+    if (ack) {
+        json_object_del(obj, "ack");
+    }
     if (!data) {
         return DSLINK_ALLOC_ERR;
     }
 
     dslink_ws_send(ctx, data);
+    if (tracked) {
+        dslink_send_window_sent(link, msg, strlen(data));
+    }
     dslink_free(data);
 
     json_object_del(obj, "msg");
@@ -133,6 +166,52 @@ int dslink_ws_send_obj(wslay_event_context_ptr ctx, json_t *obj) {
     return 0;
 }
 
+int dslink_ws_send_updates(wslay_event_context_ptr ctx, uint32_t rid,
+                           const char *updates, size_t len) {
+    DSLink *link = ctx->user_data;
+
+    if (dslink_send_window_blocked(link)) {
+        // the window keeps held messages as json
+        json_t *top = json_pack("{s:[{s:i,s:s,s:o}]}", "responses",
+                                "rid", (json_int_t) rid, "stream", "open",
+                                "updates", json_loadb(updates, len, 0, NULL));
+        if (!top) {
+            return DSLINK_ALLOC_ERR;
+        }
+        int ret = dslink_ws_send_obj(ctx, top);
+        json_decref(top);
+        return ret;
+    }
+
+    char head[64];
+    char tail[64];
+    int headLen = snprintf(head, sizeof(head),
+                           "{\"responses\":[{\"rid\":%" PRIu32 ",\"stream\":\"open\",\"updates\":",
+                           rid);
+    uint32_t msg = dslink_incr_msg(link);
+    int tailLen;
+    if (link->pending_ack) {
+        tailLen = snprintf(tail, sizeof(tail), "}],\"msg\":%" PRIu32 ",\"ack\":%" PRIu32 "}",
+                           msg, link->pending_ack);
+        link->pending_ack = 0;
+    } else {
+        tailLen = snprintf(tail, sizeof(tail), "}],\"msg\":%" PRIu32 "}", msg);
+    }
+
+    char *data = dslink_malloc(headLen + len + tailLen + 1);
+    if (!data) {
+        return DSLINK_ALLOC_ERR;
+    }
+    memcpy(data, head, (size_t) headLen);
+    memcpy(data + headLen, updates, len);
+    memcpy(data + headLen + len, tail, (size_t) tailLen + 1);
+
+    dslink_ws_send(ctx, data);
+    dslink_send_window_sent(link, msg, headLen + len + tailLen);
+    dslink_free(data);
+    return 0;
+}
+
 static
 int dslink_ws_send_internal(wslay_event_context_ptr ctx, const char *data, uint8_t resend) {
     (void) resend;
@@ -149,11 +228,15 @@ int dslink_ws_send_internal(wslay_event_context_ptr ctx, const char *data, uint8
         return 1;
     }
 
+    link->last_send_time = uv_now(&link->loop);
+    link->queued_total += msg.msg_length;
+
     // start polling on the socket, to trigger writes (We always want to poll reads)
     if(link->poll && !uv_is_closing((uv_handle_t*)link->poll)) {
         uv_poll_start(link->poll, UV_READABLE | UV_WRITABLE, io_handler);
 
         log_debug("Message queued to be sent: %s\n", data);
+        dslink_writable_update(link);
         return 0;
     }
 
@@ -315,6 +398,11 @@ void recv_frame_cb(wslay_event_context_ptr ctx,
                   (int) arg->msg_length, arg->msg);
     }
 
+    json_t *ack = json_object_get(obj, "ack");
+    if (json_is_integer(ack)) {
+        dslink_send_window_ack(link, (uint32_t) json_integer_value(ack));
+    }
+
     json_t *reqs = json_object_get(obj, "requests");
     if (link->is_responder && reqs) {
         size_t index;
@@ -338,15 +426,9 @@ void recv_frame_cb(wslay_event_context_ptr ctx,
         }
     }
 
-    json_t *msg = json_incref(json_object_get(obj, "msg"));
-
-    if ((resps || reqs) && msg) {
-        json_t *top = json_object();
-        json_object_set_new(top, "ack", msg);
-        dslink_ws_send_obj(link->_ws, top);
-        json_delete(top);
-    } else {
-        json_decref(msg);
+    json_t *msg = json_object_get(obj, "msg");
+    if ((resps || reqs) && json_is_integer(msg)) {
+        dslink_ws_ack(link, (uint32_t) json_integer_value(msg));
     }
 
     json_decref(obj);
@@ -356,25 +438,74 @@ void recv_frame_cb(wslay_event_context_ptr ctx,
 }
 
 static
-void ping_handler(uv_timer_t *timer) {
-    log_debug("Pinging...\n");
+void dslink_ws_flush_ack(DSLink *link) {
+    if (!link->pending_ack || !link->_ws) {
+        return;
+    }
+    // the ack is added by dslink_ws_send_obj
+    json_t *top = json_object();
+    dslink_ws_send_obj(link->_ws, top);
+    json_decref(top);
+}
+
+static
+void ack_handler(uv_timer_t *timer) {
+    dslink_ws_flush_ack(timer->data);
+}
+
+void dslink_ws_ack(DSLink *link, uint32_t msg) {
+    uint8_t armed = link->pending_ack != 0;
+    link->pending_ack = msg;
+
+    if (link->config.ack_delay < 0 || !link->ack_timer) {
+        dslink_ws_flush_ack(link);
+        return;
+    }
+    if (!armed) {
+        uv_timer_start(link->ack_timer, ack_handler,
+                       (uint64_t) link->config.ack_delay, 0);
+    }
+}
 
+static
+void ping_handler(DSLinkTimer *timer) {
     DSLink *link = timer->data;
+
+    // Any message sent keeps the connection alive, only ping idle links
+    uint64_t idle = uv_now(&link->loop) - link->last_send_time;
+    if (link->last_send_time && idle < DSLINK_PING_INTERVAL) {
+        dslink_timer_start(link->timer_wheel, timer,
+                           DSLINK_PING_INTERVAL - idle, 0);
+        return;
+    }
+
+    log_debug("Pinging...\n");
     json_t *obj = json_object();
     dslink_ws_send_obj(link->_ws, obj);
     json_delete(obj);
+    dslink_timer_start(link->timer_wheel, timer, DSLINK_PING_INTERVAL, 0);
+}
+
+static
+void idle_handler(DSLinkTimer *timer) {
+    DSLink *link = timer->data;
 
     struct timeval current_time;
     gettimeofday(&current_time, NULL);
-    long time_diff = current_time.tv_sec - link->lastReceiveTime.tv_sec;
-    if (time_diff >= 90) {
+    long time_diff = (current_time.tv_sec - link->lastReceiveTime.tv_sec) * 1000
+                     + (current_time.tv_usec - link->lastReceiveTime.tv_usec) / 1000;
+    if (time_diff >= DSLINK_IDLE_TIMEOUT) {
         log_debug("Broker didn't send any requests for 90 seconds. Stopping dslink loop...\n");
         uv_stop(&link->loop);
+        return;
     }
+    // received something in the meantime, check again when it would expire
+    dslink_timer_start(link->timer_wheel, timer,
+                       (uint64_t) (DSLINK_IDLE_TIMEOUT - time_diff), 0);
 }
 
 static
-void ping_timer_on_close(uv_handle_t *handle) {
+void timer_on_close(uv_handle_t *handle) {
     dslink_free(handle);
 }
 
@@ -399,6 +530,9 @@ void dslink_handshake_handle_ws(DSLink *link, link_callback on_requester_ready_c
         return;
     }
     link->_ws = ptr;
+    if (dslink_send_window_init(link) != 0) {
+        log_warn("Failed to create the send window\n");
+    }
     link->poll = dslink_malloc(sizeof(uv_poll_t));
 
     mbedtls_net_set_nonblock(&link->_socket->socket_ctx);
@@ -408,24 +542,62 @@ void dslink_handshake_handle_ws(DSLink *link, link_callback on_requester_ready_c
         uv_poll_start(link->poll, UV_READABLE, io_handler);
     }
 
-    uv_timer_t *ping = dslink_malloc(sizeof(uv_timer_t));
+    link->pending_ack = 0;
+    link->ack_timer = dslink_malloc(sizeof(uv_timer_t));
+    uv_timer_init(&link->loop, link->ack_timer);
+    link->ack_timer->data = link;
+
+    link->list_timer = dslink_malloc(sizeof(uv_timer_t));
+    uv_timer_init(&link->loop, link->list_timer);
+    link->list_timer->data = link;
+
+    link->timer_wheel = dslink_malloc(sizeof(DSLinkTimerWheel));
+    dslink_timer_wheel_init(link->timer_wheel, &link->loop, DSLINK_TIMER_TICK);
     {
-        uv_timer_init(&link->loop, ping);
-        ping->data = link;
+        link->last_send_time = 0;
+        dslink_timer_init(&link->ping_timer, ping_handler, link);
+        dslink_timer_start(link->timer_wheel, &link->ping_timer, 0, 0);
+
         gettimeofday(&link->lastReceiveTime, NULL);
-        uv_timer_start(ping, ping_handler, 0, 30000);
+        dslink_timer_init(&link->idle_timer, idle_handler, link);
+        dslink_timer_start(link->timer_wheel, &link->idle_timer,
+                           DSLINK_IDLE_TIMEOUT, 0);
+    }
+
+    if (link->is_requester) {
+        dslink_requester_resubscribe(link);
     }
 
-    if (on_requester_ready_cb) {
+    // producers paused by the last connection resume
+    dslink_writable_update(link);
+
+    // a requester kept across reconnects already sent its subscriptions again
+    if (on_requester_ready_cb && !(link->requester && link->requester->ready)) {
+        if (link->requester) {
+            link->requester->ready = 1;
+        }
         on_requester_ready_cb(link);
     }
 
     uv_run(&link->loop, UV_RUN_DEFAULT);
 
-    uv_timer_stop(ping);
-    uv_close((uv_handle_t *) ping, ping_timer_on_close);
+    dslink_timer_wheel_close(link->timer_wheel, timer_on_close);
+    link->timer_wheel = NULL;
+    uv_timer_stop(link->ack_timer);
+    uv_close((uv_handle_t *) link->ack_timer, timer_on_close);
+    link->ack_timer = NULL;
+    uv_timer_stop(link->list_timer);
+    uv_close((uv_handle_t *) link->list_timer, timer_on_close);
+    link->list_timer = NULL;
+    if (link->list_changes) {
+        // the list streams are gone with the connection
+        dslink_map_free(link->list_changes);
+        dslink_free(link->list_changes);
+        link->list_changes = NULL;
+    }
     uv_close((uv_handle_t *) link->poll, poll_on_close);
 
+    dslink_send_window_free(link);
     wslay_event_context_free(ptr);
     link->_ws = NULL;
 }
@@ -0,0 +1,116 @@
+#include <string.h>
+
+#include "cmocka_init.h"
+#include "broker_test.h"
+
+#define TEST_VALUES 100
+
+static
+int pending_value(SubRequester *sub) {
+    return (int) json_integer_value(json_array_get(sub->pendingValue->varray, 1));
+}
+
+static
+void conflate_ack_window_test(void **state) {
+    (void) state;
+    TestRequester req;
+    test_requester_init(&req, "requester");
+
+    SubRequester *sub = broker_create_sub_requester(&req.node, "/downstream/responder/a", 1, 1, NULL);
+    for (int i = 0; i < TEST_VALUES; ++i) {
+        test_update_value(sub, i);
+    }
+    // the window is full, only the latest value waits
+    assert_int_equal(broker_max_ws_send_queue_size, wslay_event_get_queued_msg_count(req.link.ws));
+    assert_int_equal(broker_max_ws_send_queue_size, sub->messageOutputQueueCount);
+    assert_null(sub->messageQueue);
+    assert_non_null(sub->pendingValue);
+    assert_int_equal(TEST_VALUES - 1, pending_value(sub));
+    assert_int_equal(1, req.node.dirtySubs.size);
+
+    check_subscription_ack(&req.link, 1);
+    assert_int_equal(broker_max_ws_send_queue_size + 1, wslay_event_get_queued_msg_count(req.link.ws));
+    assert_null(sub->pendingValue);
+    assert_int_equal(0, req.node.dirtySubs.size);
+
+    check_subscription_ack(&req.link, req.link.msgId);
+    assert_int_equal(0, sub->messageOutputQueueCount);
+    test_update_value(sub, TEST_VALUES);
+    assert_null(sub->pendingValue);
+    assert_int_equal(broker_max_ws_send_queue_size + 2, wslay_event_get_queued_msg_count(req.link.ws));
+
+    broker_free_sub_requester(sub);
+    test_requester_free(&req);
+}
+
+static
+void conflate_ws_queue_test(void **state) {
+    (void) state;
+    TestRequester req;
+    test_requester_init(&req, "requester");
+    size_t maxQueuedBytes = broker_max_ws_queued_bytes;
+    broker_max_ws_queued_bytes = 1;
+
+    SubRequester *a = broker_create_sub_requester(&req.node, "/downstream/responder/a", 1, 0, NULL);
+    SubRequester *b = broker_create_sub_requester(&req.node, "/downstream/responder/b", 2, 1, NULL);
+    for (int i = 0; i < TEST_VALUES; ++i) {
+        test_update_value(a, i);
+        test_update_value(b, i);
+    }
+    // the socket didn't take the first message
+    assert_int_equal(1, wslay_event_get_queued_msg_count(req.link.ws));
+    assert_int_equal(TEST_VALUES - 1, pending_value(a));
+    assert_int_equal(TEST_VALUES - 1, pending_value(b));
+    assert_int_equal(2, req.node.dirtySubs.size);
+
+    broker_send_dirty_subs(&req.link);
+    assert_int_equal(2, req.node.dirtySubs.size);
+
+    broker_max_ws_queued_bytes = maxQueuedBytes;
+    broker_send_dirty_subs(&req.link);
+    assert_int_equal(3, wslay_event_get_queued_msg_count(req.link.ws));
+    assert_null(a->pendingValue);
+    assert_null(b->pendingValue);
+    assert_int_equal(0, req.node.dirtySubs.size);
+
+    broker_free_sub_requester(a);
+    broker_free_sub_requester(b);
+    test_requester_free(&req);
+}
+
+static
+void conflate_free_test(void **state) {
+    (void) state;
+    TestRequester req;
+    test_requester_init(&req, "requester");
+    // not connected yet
+    req.node.link = NULL;
+
+    SubRequester *a = broker_create_sub_requester(&req.node, "/downstream/responder/a", 1, 1, NULL);
+    SubRequester *b = broker_create_sub_requester(&req.node, "/downstream/responder/b", 2, 1, NULL);
+    test_update_value(a, 1);
+    test_update_value(b, 2);
+    test_update_value(b, 3);
+    assert_int_equal(2, req.node.dirtySubs.size);
+
+    // a higher qos keeps the conflated value in its queue
+    broker_update_sub_qos(b, 2);
+    assert_null(b->pendingValue);
+    assert_int_equal(1, req.node.dirtySubs.size);
+    assert_int_equal(1, rb_count(b->messageQueue));
+
+    broker_free_sub_requester(a);
+    assert_int_equal(0, req.node.dirtySubs.size);
+    broker_free_sub_requester(b);
+    test_requester_free(&req);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(conflate_ack_window_test),
+        cmocka_unit_test(conflate_ws_queue_test),
+        cmocka_unit_test(conflate_free_test)
+    };
+
+    return cmocka_run_group_tests(tests, test_broker_setup, test_broker_teardown);
+}
@@ -0,0 +1,145 @@
+/*
+ * Cost of acks and unsubscribes while a requester has 100k messages not
+ * acked yet, one per subscription. The previous sorted vector of pending
+ * acks is replayed next to the ring buffer of the broker.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <broker/subscription.h>
+#include <broker/config.h>
+#include <broker/broker.h>
+#include <broker/sys/throughput.h>
+#include <dslink/col/vector.h>
+#include <dslink/utils.h>
+
+#define BENCH_ACKS 100000
+// unsubscribes, the vector needs a full scan for each of them
+#define BENCH_REMOVED 10000
+
+typedef struct {
+    void *subscription;
+    uint32_t msg_id;
+} VectorAck;
+
+static
+int cmp_vector_ack(const void *lhs, const void *rhs) {
+    uint32_t l = ((VectorAck *) lhs)->msg_id;
+    uint32_t r = ((VectorAck *) rhs)->msg_id;
+    return l == r ? 0 : (l > r ? 1 : -1);
+}
+
+static
+int cmp_vector_sub(const void *lhs, const void *rhs) {
+    return ((VectorAck *) lhs)->subscription == ((VectorAck *) rhs)->subscription ? 0 : -1;
+}
+
+static
+double elapsed_ms(uint64_t start) {
+    return (uv_hrtime() - start) / 1000000.0;
+}
+
+static
+void bench_vector() {
+    Vector acks;
+    vector_init(&acks, 64, sizeof(VectorAck));
+    for (uint32_t i = 0; i < BENCH_ACKS; ++i) {
+        VectorAck ack = { (void *) (uintptr_t) (i + 1), i + 1 };
+        vector_append(&acks, &ack);
+    }
+
+    uint64_t start = uv_hrtime();
+    for (uint32_t i = 0; i < BENCH_REMOVED; ++i) {
+        VectorAck search = { (void *) (uintptr_t) (BENCH_ACKS - i), 0 };
+        uint32_t idx = vector_remove_if(&acks, &search, cmp_vector_sub);
+        vector_erase_range(&acks, idx, vector_count(&acks));
+    }
+    double removed = elapsed_ms(start);
+
+    start = uv_hrtime();
+    for (uint32_t i = 0; i < BENCH_ACKS - BENCH_REMOVED; ++i) {
+        VectorAck search = { NULL, i + 1 };
+        uint32_t last = vector_upper_bound(&acks, &search, cmp_vector_ack);
+        vector_erase_range(&acks, 0, last);
+    }
+    double acked = elapsed_ms(start);
+    vector_free(&acks);
+
+    printf("%-22s %8d unsubscribes %10.1f ms %8d acks %10.1f ms\n",
+           "sorted vector", BENCH_REMOVED, removed,
+           BENCH_ACKS - BENCH_REMOVED, acked);
+}
+
+static
+void bench_ringbuffer() {
+    DownstreamNode node;
+    RemoteDSLink link;
+    Client client;
+    memset(&node, 0, sizeof(DownstreamNode));
+    memset(&link, 0, sizeof(RemoteDSLink));
+    memset(&client, 0, sizeof(Client));
+    dslink_map_init(&node.req_sub_paths, dslink_map_str_cmp,
+                    dslink_map_str_key_len_cal, dslink_map_hash_key);
+    dslink_map_init(&node.req_sub_sids, dslink_map_uint32_cmp,
+                    dslink_map_uint32_key_len_cal, dslink_map_hash_key);
+    list_init(&node.dirtySubs);
+    node.path = "/downstream/requester";
+    node.link = &link;
+    link.node = &node;
+    link.client = &client;
+    struct wslay_event_callbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+    wslay_event_context_server_init(&link.ws, &callbacks, NULL);
+
+    SubRequester **subs = malloc(BENCH_ACKS * sizeof(SubRequester *));
+    json_t *value = json_pack("[n,f,s]", 42.5, "2026-01-01T00:00:00.000+00:00");
+    for (int i = 0; i < BENCH_ACKS; ++i) {
+        char path[64];
+        snprintf(path, sizeof(path), "/downstream/responder/point%d", i);
+        subs[i] = broker_create_sub_requester(&node, path, (uint32_t) i + 1, 0, NULL);
+        broker_update_sub_req(subs[i], value);
+    }
+
+    uint64_t start = uv_hrtime();
+    for (int i = 0; i < BENCH_REMOVED; ++i) {
+        broker_free_sub_requester(subs[BENCH_ACKS - 1 - i]);
+    }
+    double removed = elapsed_ms(start);
+
+    start = uv_hrtime();
+    for (uint32_t i = 0; i < BENCH_ACKS; ++i) {
+        check_subscription_ack(&link, i + 1);
+    }
+    double acked = elapsed_ms(start);
+
+    printf("%-22s %8d unsubscribes %10.1f ms %8d acks %10.1f ms\n",
+           "ring buffer", BENCH_REMOVED, removed, BENCH_ACKS, acked);
+
+    for (int i = 0; i < BENCH_ACKS - BENCH_REMOVED; ++i) {
+        broker_free_sub_requester(subs[i]);
+    }
+    free(subs);
+    json_decref(value);
+    broker_clear_pending_acks(&node);
+    dslink_map_free(&node.req_sub_paths);
+    dslink_map_free(&node.req_sub_sids);
+    wslay_event_context_free(link.ws);
+}
+
+int main() {
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+    mainLoop = &loop;
+    // broker_ws_send_obj counts the sent messages
+    BrokerNode *sys = broker_node_create("sys", "node");
+    sys->path = dslink_strdup("/sys");
+    init_throughput(sys);
+
+    printf("%d messages not acked\n", BENCH_ACKS);
+    bench_vector();
+    bench_ringbuffer();
+
+    broker_node_free(sys);
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include <string.h>
+
+#include "cmocka_init.h"
+#include "broker_test.h"
+
+static
+void pending_ack_order_test(void **state) {
+    (void) state;
+    TestRequester req;
+    test_requester_init(&req, "requester");
+
+    SubRequester *a = broker_create_sub_requester(&req.node, "/downstream/responder/a", 1, 2, NULL);
+    SubRequester *b = broker_create_sub_requester(&req.node, "/downstream/responder/b", 2, 2, NULL);
+    for (int i = 0; i < 3; ++i) {
+        test_update_value(a, i);
+        test_update_value(b, i);
+    }
+    assert_int_equal(6, rb_count(req.node.pendingAcks));
+
+    // msg 1 to 3 are a, b, a
+    check_subscription_ack(&req.link, 3);
+    assert_int_equal(3, rb_count(req.node.pendingAcks));
+    assert_int_equal(1, a->messageOutputQueueCount);
+    assert_int_equal(2, b->messageOutputQueueCount);
+    assert_int_equal(1, rb_count(a->messageQueue));
+    assert_int_equal(2, rb_count(b->messageQueue));
+
+    // an old ack changes nothing
+    check_subscription_ack(&req.link, 2);
+    assert_int_equal(3, rb_count(req.node.pendingAcks));
+
+    check_subscription_ack(&req.link, 6);
+    assert_int_equal(0, rb_count(req.node.pendingAcks));
+    assert_int_equal(0, a->messageOutputQueueCount);
+    assert_int_equal(0, b->messageOutputQueueCount);
+
+    broker_free_sub_requester(a);
+    broker_free_sub_requester(b);
+    test_requester_free(&req);
+}
+
+static
+void pending_ack_wrap_test(void **state) {
+    (void) state;
+    TestRequester req;
+    test_requester_init(&req, "requester");
+    // the msg ids wrap around to 1 after 2147483647
+    req.link.msgId = 2147483644;
+
+    SubRequester *a = broker_create_sub_requester(&req.node, "/downstream/responder/a", 1, 0, NULL);
+    for (int i = 0; i < 4; ++i) {
+        test_update_value(a, i);
+    }
+    assert_int_equal(1, req.link.msgId);
+    assert_int_equal(4, a->messageOutputQueueCount);
+
+    check_subscription_ack(&req.link, 2147483646);
+    assert_int_equal(2, a->messageOutputQueueCount);
+    check_subscription_ack(&req.link, 2147483647);
+    assert_int_equal(1, a->messageOutputQueueCount);
+    check_subscription_ack(&req.link, 1);
+    assert_int_equal(0, a->messageOutputQueueCount);
+    assert_int_equal(0, rb_count(req.node.pendingAcks));
+
+    broker_free_sub_requester(a);
+    test_requester_free(&req);
+}
+
+static
+void pending_ack_free_test(void **state) {
+    (void) state;
+    TestRequester req;
+    test_requester_init(&req, "requester");
+
+    SubRequester *a = broker_create_sub_requester(&req.node, "/downstream/responder/a", 1, 1, NULL);
+    SubRequester *b = broker_create_sub_requester(&req.node, "/downstream/responder/b", 2, 1, NULL);
+    SubRequester *c = broker_create_sub_requester(&req.node, "/downstream/responder/c", 3, 1, NULL);
+    test_update_value(a, 1);
+    test_update_value(b, 1);
+    test_update_value(c, 1);
+    test_update_value(a, 2);
+
+    // the acks of freed subscriptions stay queued until they arrive
+    broker_free_sub_requester(a);
+    broker_free_sub_requester(b);
+    assert_int_equal(4, rb_count(req.node.pendingAcks));
+
+    check_subscription_ack(&req.link, 3);
+    assert_int_equal(1, rb_count(req.node.pendingAcks));
+    assert_int_equal(0, c->messageOutputQueueCount);
+
+    // a disconnect drops the rest
+    broker_clear_pending_acks(&req.node);
+    assert_null(req.node.pendingAcks);
+
+    broker_free_sub_requester(c);
+    test_requester_free(&req);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(pending_ack_order_test),
+        cmocka_unit_test(pending_ack_wrap_test),
+        cmocka_unit_test(pending_ack_free_test)
+    };
+
+    return cmocka_run_group_tests(tests, test_broker_setup, test_broker_teardown);
+}
@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+#include "cmocka_init.h"
+#include "broker_test.h"
+#include <broker/qos_log.h>
+#include <dslink/storage/storage.h>
+
+static Broker test_broker;
+static StorageProvider test_storage;
+static char test_dir[] = "/tmp/qos_log_testXXXXXX";
+
+static
+void store_nothing(StorageProvider *provider, const char **key, json_t *value,
+                   storage_gen_done_cb cb, void *data) {
+    (void) provider;
+    (void) key;
+    (void) value;
+    (void) cb;
+    (void) data;
+}
+
+static
+int qos_log_setup(void **state) {
+    if (!mkdtemp(test_dir)) {
+        return 1;
+    }
+    if (test_broker_setup(state) != 0) {
+        return 1;
+    }
+    test_storage.store_cb = store_nothing;
+    test_broker.storage = &test_storage;
+    test_loop.data = &test_broker;
+    broker_storage_path = test_dir;
+    // fsync every append, no timer needed
+    broker_qos_log_sync_interval = 0;
+    return 0;
+}
+
+static
+char *log_dir(const char *name) {
+    size_t size = strlen(test_dir) + strlen(name) + 2;
+    char *dir = dslink_malloc(size);
+    snprintf(dir, size, "%s/%s", test_dir, name);
+    return dir;
+}
+
+static
+int qos_log_teardown(void **state) {
+    test_broker_teardown(state);
+    // the directory of the requester is left by its subscriptions
+    char *dir = log_dir("qos/%2Fdownstream%2Frequester");
+    rmdir(dir);
+    dslink_free(dir);
+    dir = log_dir("qos");
+    rmdir(dir);
+    dslink_free(dir);
+    rmdir(test_dir);
+    return 0;
+}
+
+static
+json_t *value(int i) {
+    return json_pack("[n,i,s]", i, TEST_TS);
+}
+
+static
+void append_values(QosLog *log, int from, int to) {
+    for (int i = from; i < to; ++i) {
+        json_t *varray = value(i);
+        assert_int_equal(0, broker_qos_log_append(log, varray));
+        json_decref(varray);
+    }
+}
+
+// Reads all unread values and checks they are from, from + 1, ...
+static
+void assert_read(QosLog *log, int from, size_t count) {
+    json_t *out = json_array();
+    uint64_t lastSeq = 0;
+    assert_int_equal(count, broker_qos_log_read(log, out, count + 1, &lastSeq));
+    for (size_t i = 0; i < count; ++i) {
+        json_t *varray = json_array_get(out, i);
+        assert_int_equal(from + (int) i, json_integer_value(json_array_get(varray, 1)));
+    }
+    json_decref(out);
+}
+
+static
+void qos_log_ack_test(void **state) {
+    (void) state;
+    size_t segmentSize = broker_qos_log_segment_size;
+    broker_qos_log_segment_size = 128;
+
+    char *dir = log_dir("ack");
+    QosLog *log = broker_qos_log_open(dir);
+    assert_non_null(log);
+    append_values(log, 0, 20);
+    assert_int_equal(20, broker_qos_log_size(log));
+    assert_true(log->segmentCount > 2);
+
+    json_t *out = json_array();
+    uint64_t lastSeq = 0;
+    assert_int_equal(5, broker_qos_log_read(log, out, 5, &lastSeq));
+    assert_int_equal(4, lastSeq);
+    assert_int_equal(15, broker_qos_log_unread(log));
+    json_decref(out);
+
+    // a fully acked segment is gone
+    uint32_t segments = log->segmentCount;
+    uint64_t second = log->segments[1].first;
+    broker_qos_log_ack(log, second);
+    assert_int_equal(segments - 1, log->segmentCount);
+    assert_int_equal(20 - second - 1, broker_qos_log_size(log));
+    assert_read(log, 5, 15);
+
+    // so is everything once the last value was acked
+    broker_qos_log_ack(log, 19);
+    assert_int_equal(0, log->segmentCount);
+    assert_int_equal(0, log->bytes);
+    append_values(log, 20, 22);
+    assert_read(log, 20, 2);
+
+    broker_qos_log_close(log, 1);
+    assert_int_not_equal(0, access(dir, F_OK));
+    dslink_free(dir);
+    broker_qos_log_segment_size = segmentSize;
+}
+
+static
+void qos_log_recover_test(void **state) {
+    (void) state;
+    size_t segmentSize = broker_qos_log_segment_size;
+    broker_qos_log_segment_size = 128;
+
+    char *dir = log_dir("recover");
+    QosLog *log = broker_qos_log_open(dir);
+    append_values(log, 0, 10);
+    broker_qos_log_ack(log, 2);
+    broker_qos_log_close(log, 0);
+
+    // the acked values aren't read again
+    log = broker_qos_log_open(dir);
+    assert_non_null(log);
+    assert_int_equal(7, broker_qos_log_size(log));
+    assert_int_equal(10, log->next);
+    assert_read(log, 3, 7);
+
+    // a record cut off by a crash is dropped
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%020" PRIu64 ".log", dir,
+             log->segments[log->segmentCount - 1].first);
+    broker_qos_log_close(log, 0);
+    FILE *f = fopen(path, "a");
+    fputs("10 [null,10,\"2026", f);
+    fclose(f);
+
+    log = broker_qos_log_open(dir);
+    assert_non_null(log);
+    assert_int_equal(7, broker_qos_log_size(log));
+    append_values(log, 10, 12);
+    assert_read(log, 3, 9);
+
+    broker_qos_log_close(log, 1);
+    dslink_free(dir);
+    broker_qos_log_segment_size = segmentSize;
+}
+
+static
+void qos_log_cap_test(void **state) {
+    (void) state;
+    size_t segmentSize = broker_qos_log_segment_size;
+    size_t maxSize = broker_max_qos_log_size;
+    broker_qos_log_segment_size = 128;
+    broker_max_qos_log_size = 512;
+
+    char *dir = log_dir("cap");
+    QosLog *log = broker_qos_log_open(dir);
+    append_values(log, 0, 200);
+    assert_true(log->bytes <= 512);
+    assert_int_equal(200, log->next);
+    assert_int_equal(log->segments[0].first, log->head);
+    assert_read(log, (int) log->head, broker_qos_log_size(log));
+
+    broker_qos_log_close(log, 1);
+    dslink_free(dir);
+    broker_qos_log_segment_size = segmentSize;
+    broker_max_qos_log_size = maxSize;
+}
+
+static
+void qos_log_no_sync_test(void **state) {
+    (void) state;
+    size_t segmentSize = broker_qos_log_segment_size;
+    broker_qos_log_segment_size = 128;
+    // batched fsyncs would leave the log dirty until the timer fires
+    broker_qos_log_sync_interval = 1000;
+
+    char *dir = log_dir("no_sync");
+    QosLog *log = broker_qos_log_open(dir);
+    assert_non_null(log);
+    log->noSync = 1;
+    append_values(log, 0, 20);
+    assert_true(log->segmentCount > 2);
+    assert_false(log->dirty);
+    assert_null(log->sync);
+    assert_read(log, 0, 20);
+
+    broker_qos_log_close(log, 1);
+    dslink_free(dir);
+    broker_qos_log_sync_interval = 0;
+    broker_qos_log_segment_size = segmentSize;
+}
+
+static
+void qos_log_subscription_test(void **state) {
+    (void) state;
+    TestRequester req;
+    test_requester_init(&req, "requester");
+
+    SubRequester *sub = broker_create_sub_requester(&req.node, "/downstream/responder/a", 1, 3, NULL);
+    assert_non_null(sub->qosLog);
+    for (int i = 0; i < 20; ++i) {
+        json_t *varray = value(i);
+        broker_update_sub_req(sub, varray);
+        json_decref(varray);
+    }
+    // one value per message until the window is full
+    size_t window = broker_max_ws_send_queue_size;
+    assert_int_equal(window, wslay_event_get_queued_msg_count(req.link.ws));
+    assert_int_equal(20, broker_qos_log_size(sub->qosLog));
+    assert_int_equal(20 - window, broker_qos_log_unread(sub->qosLog));
+
+    // the rest goes out in one message
+    check_subscription_ack(&req.link, 1);
+    assert_int_equal(19, broker_qos_log_size(sub->qosLog));
+    assert_int_equal(0, broker_qos_log_unread(sub->qosLog));
+    assert_int_equal(window + 1, wslay_event_get_queued_msg_count(req.link.ws));
+
+    // a reconnect sends the values not acked yet again
+    broker_clear_pending_acks(&req.node);
+    broker_clear_messsage_ids(sub);
+    assert_int_equal(19, broker_qos_log_unread(sub->qosLog));
+    broker_update_sub_req_qos(sub);
+    assert_int_equal(0, broker_qos_log_unread(sub->qosLog));
+    check_subscription_ack(&req.link, req.link.msgId);
+    assert_int_equal(0, broker_qos_log_size(sub->qosLog));
+
+    broker_free_sub_requester(sub);
+    test_requester_free(&req);
+}
+
+static
+int queued_value(SubRequester *sub, uint32_t idx) {
+    QueuedMessage *m = rb_at(sub->messageQueue, idx);
+    return (int) json_integer_value(json_array_get(m->value->varray, 1));
+}
+
+static
+void qos_log_spill_test(void **state) {
+    (void) state;
+    size_t maxQueue = broker_max_qos_queue_size;
+    broker_max_qos_queue_size = 16;
+    TestRequester req;
+    test_requester_init(&req, "requester");
+    // disconnected
+    req.node.link = NULL;
+
+    SubRequester *sub = broker_create_sub_requester(&req.node, "/downstream/responder/b", 1, 2, NULL);
+    for (int i = 0; i < 100; ++i) {
+        json_t *varray = value(i);
+        broker_update_sub_req(sub, varray);
+        json_decref(varray);
+    }
+    // nothing got lost
+    assert_int_equal(16, rb_count(sub->messageQueue));
+    assert_non_null(sub->spill);
+    assert_int_equal(84, broker_qos_log_size(sub->spill));
+    // the spill isn't kept across restarts, nothing to fsync
+    assert_true(sub->spill->noSync);
+    assert_int_equal(0, queued_value(sub, 0));
+
+    req.node.link = &req.link;
+    sendQueuedMessages(sub);
+    size_t window = broker_max_ws_send_queue_size;
+    assert_int_equal(window, sub->messageOutputQueueCount);
+
+    // acked values make room for the spilled ones, in order
+    check_subscription_ack(&req.link, req.link.msgId);
+    assert_int_equal(16, rb_count(sub->messageQueue));
+    assert_int_equal(window, queued_value(sub, 0));
+    assert_int_equal(window + 15, queued_value(sub, 15));
+    assert_int_equal(84 - window, broker_qos_log_size(sub->spill));
+
+    while (sub->messageOutputQueueCount > 0) {
+        check_subscription_ack(&req.link, req.link.msgId);
+    }
+    assert_null(sub->spill);
+    assert_int_equal(0, rb_count(sub->messageQueue));
+    assert_int_equal(100, wslay_event_get_queued_msg_count(req.link.ws));
+
+    broker_free_sub_requester(sub);
+    test_requester_free(&req);
+    broker_clear_qos_spill();
+    broker_max_qos_queue_size = maxQueue;
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(qos_log_ack_test),
+        cmocka_unit_test(qos_log_recover_test),
+        cmocka_unit_test(qos_log_cap_test),
+        cmocka_unit_test(qos_log_no_sync_test),
+        cmocka_unit_test(qos_log_subscription_test),
+        cmocka_unit_test(qos_log_spill_test)
+    };
+
+    return cmocka_run_group_tests(tests, qos_log_setup, qos_log_teardown);
+}
@@ -0,0 +1,116 @@
+/*
+ * Memory held by the message queues of many idle QoS 2 subscriptions,
+ * each of them got a single value while the requester was away, then the
+ * queues are drained like acks would do.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <malloc.h>
+
+#include <broker/subscription.h>
+#include <broker/config.h>
+#include <dslink/mem/mem.h>
+
+#define BENCH_SUBS 100000
+
+static size_t bench_live;
+
+static
+void *bench_malloc(size_t size) {
+    void *p = malloc(size);
+    if (p) {
+        bench_live += malloc_usable_size(p);
+    }
+    return p;
+}
+
+static
+void *bench_calloc(size_t n, size_t size) {
+    void *p = calloc(n, size);
+    if (p) {
+        bench_live += malloc_usable_size(p);
+    }
+    return p;
+}
+
+static
+void *bench_realloc(void *ptr, size_t size) {
+    size_t old = ptr ? malloc_usable_size(ptr) : 0;
+    void *p = realloc(ptr, size);
+    if (p) {
+        bench_live += malloc_usable_size(p) - old;
+    }
+    return p;
+}
+
+static
+void bench_free(void *ptr) {
+    if (ptr) {
+        bench_live -= malloc_usable_size(ptr);
+    }
+    free(ptr);
+}
+
+static
+size_t bench_queue_bytes(SubRequester **subs) {
+    size_t bytes = 0;
+    for (int i = 0; i < BENCH_SUBS; ++i) {
+        Ringbuffer *rb = subs[i]->messageQueue;
+        if (rb && rb->data) {
+            bytes += malloc_usable_size(rb->data);
+        }
+    }
+    return bytes;
+}
+
+int main() {
+    dslink_malloc = bench_malloc;
+    dslink_calloc = bench_calloc;
+    dslink_realloc = bench_realloc;
+    dslink_free = bench_free;
+
+    DownstreamNode requester;
+    memset(&requester, 0, sizeof(DownstreamNode));
+    requester.path = "/downstream/requester";
+    list_init(&requester.dirtySubs);
+
+    SubRequester **subs = malloc(BENCH_SUBS * sizeof(SubRequester *));
+    json_t *value = json_pack("[n,f,s]", 42.5, "2026-01-01T00:00:00.000+00:00");
+
+    size_t start = bench_live;
+    for (int i = 0; i < BENCH_SUBS; ++i) {
+        char path[64];
+        snprintf(path, sizeof(path), "/downstream/responder/point%d", i);
+        subs[i] = broker_create_sub_requester(&requester, path, (uint32_t) i + 1, 2, NULL);
+        json_t *varray = json_copy(value);
+        broker_update_sub_req(subs[i], varray);
+        json_decref(varray);
+    }
+    size_t queued = bench_live - start;
+    size_t queuedRb = bench_queue_bytes(subs);
+
+    for (int i = 0; i < BENCH_SUBS; ++i) {
+        while (rb_count(subs[i]->messageQueue) > 0) {
+            rb_pop(subs[i]->messageQueue);
+        }
+    }
+    size_t drained = bench_live - start;
+    size_t drainedRb = bench_queue_bytes(subs);
+
+    printf("%d subscriptions, max queue %zu\n", BENCH_SUBS, broker_max_qos_queue_size);
+    printf("one value queued: %10zu bytes total, %10zu bytes of queue slots\n",
+           queued, queuedRb);
+    printf("queues drained:   %10zu bytes total, %10zu bytes of queue slots\n",
+           drained, drainedRb);
+
+    for (int i = 0; i < BENCH_SUBS; ++i) {
+        rb_free(subs[i]->messageQueue);
+        dslink_free(subs[i]->messageQueue);
+        dslink_free(subs[i]->path);
+        dslink_free(subs[i]);
+    }
+    free(subs);
+    json_decref(value);
+    return 0;
+}
@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "cmocka_init.h"
+#include "broker_test.h"
+#include <broker/handshake.h>
+#include <broker/stream.h>
+#include <broker/msg/msg_list.h>
+
+#define TEST_SUBS 250
+#define TEST_LISTS 30
+
+typedef struct {
+    Broker broker;
+    BrokerNode *downstream;
+    DownstreamNode *node;
+    RemoteDSLink link;
+    Client client;
+} TestResponder;
+
+// A disconnected responder with sub and list streams of its requesters
+static
+void responder_init(TestResponder *resp) {
+    memset(resp, 0, sizeof(TestResponder));
+    dslink_map_init(&resp->broker.remote_pending_sub, dslink_map_str_cmp,
+                    dslink_map_str_key_len_cal, dslink_map_hash_key);
+    resp->downstream = broker_node_create("downstream", "node");
+    resp->downstream->path = dslink_strdup("/downstream");
+    resp->node = broker_init_downstream_node(resp->downstream, "responder");
+
+    for (int i = 0; i < TEST_SUBS; ++i) {
+        char path[32];
+        snprintf(path, sizeof(path), "/point%d", i);
+        BrokerSubStream *bss = broker_stream_sub_init();
+        bss->respSid = broker_node_incr_sid(resp->node);
+        bss->remote_path = dslink_strdup(path);
+        bss->respNode = (BrokerNode *) resp->node;
+        dslink_map_set(&resp->node->resp_sub_streams, dslink_str_ref(bss->remote_path), dslink_ref(bss, NULL));
+        dslink_map_set(&resp->node->resp_sub_sids, dslink_int_ref(bss->respSid), dslink_ref(bss, NULL));
+    }
+    for (int i = 0; i < TEST_LISTS; ++i) {
+        char path[32];
+        snprintf(path, sizeof(path), "/folder%d", i);
+        BrokerListStream *stream = broker_stream_list_init(resp->node);
+        stream->remote_path = dslink_strdup(path);
+        dslink_map_set(&resp->node->list_streams, dslink_str_ref(path), dslink_ref(stream, NULL));
+    }
+
+    dslink_map_init(&resp->link.responder_streams, dslink_map_uint32_cmp,
+                    dslink_map_uint32_key_len_cal, dslink_map_hash_key);
+    resp->link.broker = &resp->broker;
+    resp->link.node = resp->node;
+    resp->link.client = &resp->client;
+    struct wslay_event_callbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+    wslay_event_context_server_init(&resp->link.ws, &callbacks, NULL);
+}
+
+// broker_stream_free takes the streams out of the maps of the node, so
+// they can't be freed while iterating them in broker_node_free
+static
+void free_streams(DownstreamNode *node) {
+    dslink_map_foreach(&node->resp_sub_streams) {
+        BrokerSubStream *bss = entry->value->data;
+        dslink_map_free(&bss->reqSubs);
+        dslink_free(bss->remote_path);
+        dslink_free(bss);
+    }
+    dslink_map_clear(&node->resp_sub_streams);
+    dslink_map_clear(&node->resp_sub_sids);
+    dslink_map_foreach(&node->list_streams) {
+        BrokerListStream *stream = entry->value->data;
+        dslink_map_free(&stream->requester_links);
+        dslink_free(stream->remote_path);
+        json_decref(stream->updates_cache);
+        dslink_free(stream);
+    }
+    dslink_map_clear(&node->list_streams);
+}
+
+static
+void responder_free(TestResponder *resp) {
+    broker_stop_resync(resp->node);
+    broker_clear_sub_requests(&resp->link);
+    resp->node->link = NULL;
+    free_streams(resp->node);
+    broker_node_free(resp->downstream);
+    dslink_map_free(&resp->link.responder_streams);
+    dslink_map_free(&resp->broker.remote_pending_sub);
+    wslay_event_context_free(resp->link.ws);
+}
+
+static
+size_t sent(TestResponder *resp) {
+    return wslay_event_get_queued_msg_count(resp->link.ws);
+}
+
+static
+void resync_budget_test(void **state) {
+    (void) state;
+    size_t budget = broker_resync_budget;
+    broker_resync_budget = 100;
+    TestResponder resp;
+    responder_init(&resp);
+
+    // the lists and 70 paths go out right away
+    broker_dslink_connect(resp.node, &resp.link);
+    assert_non_null(resp.node->resync);
+    assert_int_equal(2, sent(&resp));
+    assert_int_equal(TEST_LISTS, resp.link.responder_streams.size);
+    assert_int_equal(70, resp.node->resync->subPos);
+
+    // a stream closed before its turn is skipped
+    uint32_t sid = *(uint32_t *) vector_get(&resp.node->resync->subSids, 100);
+    ref_t *ref = dslink_map_get(&resp.node->resp_sub_sids, &sid);
+    BrokerSubStream *bss = ref->data;
+    dslink_map_remove(&resp.node->resp_sub_streams, bss->remote_path);
+    dslink_map_remove(&resp.node->resp_sub_sids, &sid);
+    dslink_map_free(&bss->reqSubs);
+    dslink_free(bss->remote_path);
+    dslink_free(bss);
+
+    // then a batch per loop iteration
+    uv_run(&test_loop, UV_RUN_NOWAIT);
+    assert_int_equal(3, sent(&resp));
+    assert_int_equal(171, resp.node->resync->subPos);
+    uv_run(&test_loop, UV_RUN_NOWAIT);
+    assert_int_equal(4, sent(&resp));
+    assert_null(resp.node->resync);
+
+    responder_free(&resp);
+    broker_resync_budget = budget;
+}
+
+static
+void resync_disconnect_test(void **state) {
+    (void) state;
+    size_t budget = broker_resync_budget;
+    broker_resync_budget = 100;
+    TestResponder resp;
+    responder_init(&resp);
+
+    broker_dslink_connect(resp.node, &resp.link);
+    assert_non_null(resp.node->resync);
+
+    // the rest is sent after the next reconnect
+    broker_clear_sub_requests(&resp.link);
+    resp.node->link = NULL;
+    broker_dslink_disconnect(resp.node);
+    assert_null(resp.node->resync);
+    uv_run(&test_loop, UV_RUN_NOWAIT);
+    assert_int_equal(2, sent(&resp));
+
+    responder_free(&resp);
+    broker_resync_budget = budget;
+}
+
+static
+void resync_reopened_list_test(void **state) {
+    (void) state;
+    size_t budget = broker_resync_budget;
+    broker_resync_budget = 10;
+    TestResponder resp;
+    responder_init(&resp);
+
+    broker_dslink_connect(resp.node, &resp.link);
+    assert_int_equal(10, resp.link.responder_streams.size);
+
+    // a list closed and opened again before its turn is requested right away
+    char *path = *(char **) vector_get(&resp.node->resync->listPaths, 20);
+    ref_t *ref = dslink_map_get(&resp.node->list_streams, path);
+    BrokerListStream *old = ref->data;
+    dslink_map_remove(&resp.node->list_streams, path);
+    dslink_map_free(&old->requester_links);
+    dslink_free(old->remote_path);
+    json_decref(old->updates_cache);
+    dslink_free(old);
+
+    BrokerListStream *stream = broker_stream_list_init(resp.node);
+    stream->remote_path = dslink_strdup(path);
+    dslink_map_set(&resp.node->list_streams, dslink_str_ref(path), dslink_ref(stream, NULL));
+    broker_stream_list_connect(stream, resp.node);
+    assert_int_equal(11, resp.link.responder_streams.size);
+
+    // and not a second time by the resync
+    while (resp.node->resync) {
+        uv_run(&test_loop, UV_RUN_NOWAIT);
+    }
+    assert_int_equal(TEST_LISTS, resp.link.responder_streams.size);
+
+    responder_free(&resp);
+    broker_resync_budget = budget;
+}
+
+static void *(*test_malloc)(size_t);
+
+// Fails the batch of list requests of a resync step
+static
+void *malloc_no_batch(size_t size) {
+    if (size == broker_resync_budget * sizeof(BrokerListStream *)) {
+        return NULL;
+    }
+    return test_malloc(size);
+}
+
+static
+void resync_no_memory_test(void **state) {
+    (void) state;
+    size_t budget = broker_resync_budget;
+    broker_resync_budget = 10;
+    TestResponder resp;
+    responder_init(&resp);
+
+    test_malloc = dslink_malloc;
+    dslink_malloc = malloc_no_batch;
+    broker_dslink_connect(resp.node, &resp.link);
+    // a request per list, the resync doesn't get stuck on them
+    assert_int_equal(10, sent(&resp));
+    for (int i = 0; i < 100 && resp.node->resync; ++i) {
+        uv_run(&test_loop, UV_RUN_NOWAIT);
+    }
+    dslink_malloc = test_malloc;
+    assert_null(resp.node->resync);
+    assert_int_equal(TEST_LISTS, resp.link.responder_streams.size);
+
+    responder_free(&resp);
+    broker_resync_budget = budget;
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(resync_budget_test),
+        cmocka_unit_test(resync_disconnect_test),
+        cmocka_unit_test(resync_reopened_list_test),
+        cmocka_unit_test(resync_no_memory_test)
+    };
+
+    return cmocka_run_group_tests(tests, test_broker_setup, test_broker_teardown);
+}
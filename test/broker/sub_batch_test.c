@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "cmocka_init.h"
+#include "broker_test.h"
+
+typedef struct {
+    DownstreamNode node;
+    RemoteDSLink link;
+    Client client;
+} TestResponder;
+
+// The frames written by wslay_event_send, in the order they are sent
+static char written[4096];
+static size_t written_len;
+
+static
+ssize_t write_frames(wslay_event_context_ptr ctx, const uint8_t *data,
+                     size_t len, int flags, void *user_data) {
+    (void) ctx;
+    (void) flags;
+    (void) user_data;
+    if (len > sizeof(written) - written_len) {
+        len = sizeof(written) - written_len;
+    }
+    memcpy(written + written_len, data, len);
+    written_len += len;
+    return (ssize_t) len;
+}
+
+static
+size_t written_at(const char *str) {
+    size_t len = strlen(str);
+    for (size_t i = 0; i + len <= written_len; ++i) {
+        if (memcmp(written + i, str, len) == 0) {
+            return i;
+        }
+    }
+    return written_len;
+}
+
+static
+void responder_init(TestResponder *resp) {
+    memset(resp, 0, sizeof(TestResponder));
+    resp->node.path = "/downstream/responder";
+    resp->node.link = &resp->link;
+    resp->link.node = &resp->node;
+    resp->link.client = &resp->client;
+    struct wslay_event_callbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.send_callback = write_frames;
+    wslay_event_context_server_init(&resp->link.ws, &callbacks, NULL);
+}
+
+static
+void responder_free(TestResponder *resp) {
+    broker_clear_sub_requests(&resp->link);
+    wslay_event_context_free(resp->link.ws);
+}
+
+static
+size_t sent(TestResponder *resp) {
+    return wslay_event_get_queued_msg_count(resp->link.ws);
+}
+
+static
+void subscribe(TestResponder *resp, uint32_t from, uint32_t to) {
+    for (uint32_t sid = from; sid < to; ++sid) {
+        char path[32];
+        snprintf(path, sizeof(path), "/point%u", sid);
+        send_subscribe_request(&resp->node, path, sid, 0);
+    }
+}
+
+static
+void sub_batch_size_test(void **state) {
+    (void) state;
+    size_t batchSize = broker_max_sub_batch_size;
+    broker_max_sub_batch_size = 500;
+    TestResponder resp;
+    responder_init(&resp);
+
+    // a full batch goes out right away
+    subscribe(&resp, 1, 1201);
+    assert_int_equal(2, sent(&resp));
+    assert_int_equal(200, json_array_size(resp.link.pendingSubs));
+
+    broker_flush_sub_requests(&resp.link);
+    assert_int_equal(3, sent(&resp));
+    assert_null(resp.link.pendingSubs);
+    assert_int_equal(3, resp.node.rid);
+
+    responder_free(&resp);
+    broker_max_sub_batch_size = batchSize;
+}
+
+static
+void sub_batch_loop_test(void **state) {
+    (void) state;
+    TestResponder resp;
+    responder_init(&resp);
+
+    subscribe(&resp, 1, 101);
+    for (uint32_t sid = 200; sid < 250; ++sid) {
+        send_unsubscribe_request(&resp.node, sid);
+    }
+    assert_int_equal(0, sent(&resp));
+
+    // one subscribe and one unsubscribe request at the end of the iteration
+    uv_run(&test_loop, UV_RUN_NOWAIT);
+    assert_int_equal(2, sent(&resp));
+    assert_null(resp.link.pendingSubs);
+    assert_null(resp.link.pendingUnsubs);
+
+    // requests pending on a disconnect are dropped
+    subscribe(&resp, 300, 310);
+    broker_clear_sub_requests(&resp.link);
+    uv_run(&test_loop, UV_RUN_NOWAIT);
+    assert_int_equal(2, sent(&resp));
+
+    responder_free(&resp);
+}
+
+static
+void sub_batch_resubscribe_test(void **state) {
+    (void) state;
+    TestResponder resp;
+    responder_init(&resp);
+    send_subscribe_request(&resp.node, "/point", 1, 0);
+    broker_flush_sub_requests(&resp.link);
+
+    // the last requester leaves and another one comes within the iteration
+    send_unsubscribe_request(&resp.node, 1);
+    send_subscribe_request(&resp.node, "/point", 2, 0);
+    // never sent to the responder
+    send_subscribe_request(&resp.node, "/other", 3, 0);
+    send_unsubscribe_request(&resp.node, 3);
+    assert_int_equal(1, json_array_size(resp.link.pendingSubs));
+    assert_int_equal(2, json_array_size(resp.link.pendingUnsubs));
+
+    written_len = 0;
+    uv_run(&test_loop, UV_RUN_NOWAIT);
+    assert_int_equal(3, sent(&resp));
+    assert_int_equal(0, wslay_event_send(resp.link.ws));
+
+    // the responder unsubscribes the path of sid 1 before it gets sid 2
+    size_t unsub = written_at("\"unsubscribe\"");
+    size_t sub = written_at("\"sid\":2");
+    assert_true(unsub < written_len);
+    assert_true(sub < written_len);
+    assert_true(unsub < sub);
+    assert_true(written_at("\"sid\":1,") < unsub);
+    assert_int_equal(written_len, written_at("/other"));
+
+    responder_free(&resp);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(sub_batch_size_test),
+        cmocka_unit_test(sub_batch_loop_test),
+        cmocka_unit_test(sub_batch_resubscribe_test)
+    };
+
+    return cmocka_run_group_tests(tests, test_broker_setup, test_broker_teardown);
+}
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "cmocka_init.h"
+#include "broker_test.h"
+
+static
+void update(BrokerSubStream *stream, json_t *value) {
+    json_t *varray = json_pack("[i,o,s]", 1, value, TEST_TS);
+    broker_update_sub_stream(stream, varray, NULL);
+    json_decref(varray);
+}
+
+static
+void update_real(BrokerSubStream *stream, double value) {
+    update(stream, json_real(value));
+}
+
+static
+double queued_real(TestSubscriber *req, uint32_t idx) {
+    QueuedMessage *m = rb_at(req->sub->messageQueue, idx);
+    return json_number_value(json_array_get(m->value->varray, 1));
+}
+
+static
+void sub_filter_parse_test(void **state) {
+    (void) state;
+    SubFilter filter;
+    json_t *sub = json_pack("{s:f,s:s}", "deadband", 2.5, "deadbandType", "percent");
+    broker_sub_filter_parse(&filter, sub);
+    json_decref(sub);
+    assert_true(filter.deadband == 2.5);
+    assert_true(filter.deadbandPercent);
+    assert_false(filter.onChange);
+
+    sub = json_pack("{s:i,s:b}", "deadband", 1, "onChange", 1);
+    broker_sub_filter_parse(&filter, sub);
+    json_decref(sub);
+    assert_true(filter.deadband == 1);
+    assert_false(filter.deadbandPercent);
+    assert_true(filter.onChange);
+
+    // a negative deadband is ignored
+    sub = json_pack("{s:f}", "deadband", -1.0);
+    broker_sub_filter_parse(&filter, sub);
+    json_decref(sub);
+    assert_true(filter.deadband == 0);
+}
+
+static
+void sub_filter_deadband_test(void **state) {
+    (void) state;
+    BrokerSubStream *stream = broker_stream_sub_init();
+    TestSubscriber absolute, percent, all;
+    test_subscriber_init(&absolute, stream, 0, "{\"deadband\":0.5}");
+    test_subscriber_init(&percent, stream, 1, "{\"deadband\":10,\"deadbandType\":\"percent\"}");
+    test_subscriber_init(&all, stream, 2, "{}");
+
+    double values[] = {100, 100.4, 105, 110.6, 121.7, 121.3};
+    for (size_t i = 0; i < sizeof(values) / sizeof(double); ++i) {
+        update_real(stream, values[i]);
+    }
+    // moved by more than 0.5 since the value passed before
+    assert_int_equal(4, test_queued(&absolute));
+    assert_true(queued_real(&absolute, 1) == 105);
+    assert_true(queued_real(&absolute, 3) == 121.7);
+    // moved by more than 10 percent of it
+    assert_int_equal(3, test_queued(&percent));
+    assert_true(queued_real(&percent, 1) == 110.6);
+    assert_true(queued_real(&percent, 2) == 121.7);
+    assert_int_equal(6, test_queued(&all));
+
+    // values which aren't numbers aren't held back by a deadband
+    update(stream, json_string("error"));
+    update(stream, json_string("error"));
+    assert_int_equal(6, test_queued(&absolute));
+
+    test_subscriber_free(&absolute, stream);
+    test_subscriber_free(&percent, stream);
+    test_subscriber_free(&all, stream);
+    test_sub_stream_free(stream);
+}
+
+static
+void sub_filter_change_test(void **state) {
+    (void) state;
+    BrokerSubStream *stream = broker_stream_sub_init();
+    TestSubscriber req;
+    test_subscriber_init(&req, stream, 0, "{\"onChange\":true}");
+
+    update(stream, json_string("on"));
+    update(stream, json_string("on"));
+    update(stream, json_string("off"));
+    update(stream, json_pack("{s:i}", "a", 1));
+    update(stream, json_pack("{s:i}", "a", 1));
+    update(stream, json_integer(1));
+    update(stream, json_real(1.0));
+    assert_int_equal(4, test_queued(&req));
+
+    test_subscriber_free(&req, stream);
+    test_sub_stream_free(stream);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(sub_filter_parse_test),
+        cmocka_unit_test(sub_filter_deadband_test),
+        cmocka_unit_test(sub_filter_change_test)
+    };
+
+    return cmocka_run_group_tests(tests, test_broker_setup, test_broker_teardown);
+}
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "cmocka_init.h"
+#include "broker_test.h"
+
+static
+void update_values(BrokerSubStream *stream, int from, int to) {
+    for (int i = from; i < to; ++i) {
+        json_t *varray = json_pack("[i,i,s]", 1, i, TEST_TS);
+        broker_update_sub_stream(stream, varray, NULL);
+        json_decref(varray);
+    }
+}
+
+static
+int queued_value(TestSubscriber *req, uint32_t idx) {
+    QueuedMessage *m = rb_at(req->sub->messageQueue, idx);
+    return (int) json_integer_value(json_array_get(m->value->varray, 1));
+}
+
+static
+void sub_sample_interval_test(void **state) {
+    (void) state;
+    BrokerSubStream *stream = broker_stream_sub_init();
+    TestSubscriber fast, rounded, slow, all;
+    test_subscriber_init(&fast, stream, 0, "{\"minInterval\":100}");
+    test_subscriber_init(&rounded, stream, 1, "{\"minInterval\":40}");
+    test_subscriber_init(&slow, stream, 2, "{\"minInterval\":200}");
+    test_subscriber_init(&all, stream, 3, "{}");
+    assert_int_equal(100, rounded.sub->filter.interval);
+
+    update_values(stream, 0, 50);
+    assert_int_equal(50, test_queued(&all));
+    assert_int_equal(0, test_queued(&fast));
+    assert_int_equal(0, test_queued(&slow));
+    // one timer per interval
+    assert_ptr_equal(fast.sub->sampleNode.list, rounded.sub->sampleNode.list);
+    assert_ptr_not_equal(fast.sub->sampleNode.list, slow.sub->sampleNode.list);
+
+    // the latest value of the interval goes out on its tick
+    uint64_t start = uv_now(&test_loop);
+    uv_run(&test_loop, UV_RUN_ONCE);
+    assert_true(uv_now(&test_loop) - start >= 100);
+    assert_int_equal(1, test_queued(&fast));
+    assert_int_equal(49, queued_value(&fast, 0));
+    assert_int_equal(1, test_queued(&rounded));
+    assert_int_equal(0, test_queued(&slow));
+
+    update_values(stream, 50, 60);
+    while (test_queued(&slow) == 0 || test_queued(&fast) < 2) {
+        uv_run(&test_loop, UV_RUN_ONCE);
+    }
+    assert_int_equal(2, test_queued(&fast));
+    assert_int_equal(59, queued_value(&fast, 1));
+    assert_int_equal(1, test_queued(&slow));
+    assert_int_equal(59, queued_value(&slow, 0));
+    assert_null(slow.sub->sampledValue);
+
+    // the timers are freed once nothing was sampled for an interval
+    while (uv_now(&test_loop) - start < 450) {
+        uv_run(&test_loop, UV_RUN_ONCE);
+    }
+    assert_int_equal(2, test_queued(&fast));
+    assert_int_equal(1, test_queued(&slow));
+
+    test_subscriber_free(&fast, stream);
+    test_subscriber_free(&rounded, stream);
+    test_subscriber_free(&slow, stream);
+    test_subscriber_free(&all, stream);
+    test_sub_stream_free(stream);
+}
+
+static
+void sub_sample_free_test(void **state) {
+    (void) state;
+    BrokerSubStream *stream = broker_stream_sub_init();
+    TestSubscriber req;
+    test_subscriber_init(&req, stream, 0, "{\"minInterval\":100,\"onChange\":true}");
+
+    // values are filtered on the tick
+    update_values(stream, 0, 1);
+    update_values(stream, 0, 1);
+    assert_non_null(req.sub->sampledValue);
+
+    // freed with a value waiting for the tick
+    test_subscriber_free(&req, stream);
+    uint64_t start = uv_now(&test_loop);
+    while (uv_now(&test_loop) - start < 250) {
+        uv_run(&test_loop, UV_RUN_ONCE);
+    }
+    test_sub_stream_free(stream);
+}
+
+static
+void sub_sample_filter_test(void **state) {
+    (void) state;
+    BrokerSubStream *stream = broker_stream_sub_init();
+    TestSubscriber req;
+    test_subscriber_init(&req, stream, 0, "{\"minInterval\":100,\"onChange\":true}");
+
+    update_values(stream, 1, 2);
+    uint64_t start = uv_now(&test_loop);
+    while (test_queued(&req) == 0 && uv_now(&test_loop) - start < 1000) {
+        uv_run(&test_loop, UV_RUN_ONCE);
+    }
+    assert_int_equal(1, test_queued(&req));
+
+    // changed and back within the interval, the requester still has the
+    // current value
+    update_values(stream, 2, 3);
+    update_values(stream, 1, 2);
+    start = uv_now(&test_loop);
+    while (uv_now(&test_loop) - start < 250) {
+        uv_run(&test_loop, UV_RUN_ONCE);
+    }
+    assert_int_equal(1, test_queued(&req));
+    assert_null(req.sub->sampledValue);
+
+    // a change which stays goes out on the tick
+    update_values(stream, 3, 4);
+    start = uv_now(&test_loop);
+    while (test_queued(&req) == 1 && uv_now(&test_loop) - start < 1000) {
+        uv_run(&test_loop, UV_RUN_ONCE);
+    }
+    assert_int_equal(2, test_queued(&req));
+    assert_int_equal(3, queued_value(&req, 1));
+
+    test_subscriber_free(&req, stream);
+    test_sub_stream_free(stream);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(sub_sample_interval_test),
+        cmocka_unit_test(sub_sample_free_test),
+        cmocka_unit_test(sub_sample_filter_test)
+    };
+
+    return cmocka_run_group_tests(tests, test_broker_setup, test_broker_teardown);
+}
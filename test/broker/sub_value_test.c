@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "cmocka_init.h"
+#include "broker_test.h"
+
+#define TEST_REQUESTERS 20
+
+static
+void sub_value_data_test(void **state) {
+    (void) state;
+    json_t *varray = json_pack("[n,f,s]", 1.5, TEST_TS);
+    SubValue *value = broker_sub_value_create(varray);
+    json_decref(varray);
+    assert_string_equal(",1.5,\"" TEST_TS "\"]", broker_sub_value_data(value));
+    broker_sub_value_unref(value);
+
+    // the sid of the responder is left out, the other fields are kept
+    varray = json_pack("[i,{s:i},s,i]", 7, "a", 1, TEST_TS, 3);
+    value = broker_sub_value_create(varray);
+    json_decref(varray);
+    assert_string_equal(",{\"a\":1},\"" TEST_TS "\",3]", broker_sub_value_data(value));
+    broker_sub_value_unref(value);
+}
+
+static
+void sub_value_shared_test(void **state) {
+    (void) state;
+    TestRequester reqs[TEST_REQUESTERS];
+    SubRequester *subs[TEST_REQUESTERS];
+    BrokerSubStream *stream = broker_stream_sub_init();
+    for (int i = 0; i < TEST_REQUESTERS; ++i) {
+        char name[16];
+        snprintf(name, sizeof(name), "requester%d", i);
+        test_requester_init(&reqs[i], name);
+        // disconnected, the value is kept for them
+        reqs[i].node.link = NULL;
+        subs[i] = broker_create_sub_requester(&reqs[i].node, "/downstream/responder/a",
+                                              1, (uint8_t) (i % 3), NULL);
+        dslink_map_set(&stream->reqSubs, dslink_ref(&reqs[i].node, NULL),
+                       dslink_ref(subs[i], NULL));
+    }
+
+    json_t *varray = json_pack("[i,i,s]", 3, 42, TEST_TS);
+    broker_update_sub_stream(stream, varray, NULL);
+    json_decref(varray);
+
+    // one record for the stream and all subscriptions, which also keep it
+    // as the last value for their filter
+    SubValue *value = stream->last_value;
+    assert_int_equal(2 * TEST_REQUESTERS + 1, value->refs);
+    for (int i = 0; i < TEST_REQUESTERS; ++i) {
+        if (subs[i]->qos <= 1) {
+            assert_ptr_equal(value, subs[i]->pendingValue);
+        } else {
+            QueuedMessage *m = rb_front(subs[i]->messageQueue);
+            assert_ptr_equal(value, m->value);
+        }
+    }
+
+    // serialized once while it goes out to every requester
+    for (int i = 0; i < TEST_REQUESTERS; ++i) {
+        reqs[i].node.link = &reqs[i].link;
+        broker_send_dirty_subs(&reqs[i].link);
+        sendQueuedMessages(subs[i]);
+        assert_int_equal(1, wslay_event_get_queued_msg_count(reqs[i].link.ws));
+    }
+    assert_non_null(value->data);
+    const char *expected = "{\"responses\":[{\"rid\":0,\"updates\":[[1,42,\"" TEST_TS "\"]]}],\"msg\":1}";
+    assert_int_equal(strlen(expected), wslay_event_get_queued_msg_length(reqs[0].link.ws));
+
+    for (int i = 0; i < TEST_REQUESTERS; ++i) {
+        dslink_map_remove(&stream->reqSubs, &reqs[i].node);
+        broker_free_sub_requester(subs[i]);
+        test_requester_free(&reqs[i]);
+    }
+    // the stream holds the last reference
+    assert_int_equal(1, value->refs);
+    test_sub_stream_free(stream);
+}
+
+static
+void sub_value_ack_test(void **state) {
+    (void) state;
+    TestRequester req;
+    test_requester_init(&req, "requester");
+    SubRequester *sub = broker_create_sub_requester(&req.node, "/downstream/responder/a", 5, 0, NULL);
+
+    // a pending ack is piggybacked like on other messages
+    req.link.pendingAck = 12;
+    json_t *varray = json_pack("[n,b,s]", 1, TEST_TS);
+    broker_update_sub_req(sub, varray);
+    json_decref(varray);
+    const char *expected = "{\"responses\":[{\"rid\":0,\"updates\":[[5,true,\"" TEST_TS "\"]]}],\"msg\":1,\"ack\":12}";
+    assert_int_equal(strlen(expected), wslay_event_get_queued_msg_length(req.link.ws));
+    assert_int_equal(0, req.link.pendingAck);
+    assert_int_equal(1, req.link.msgId);
+
+    broker_free_sub_requester(sub);
+    test_requester_free(&req);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(sub_value_data_test),
+        cmocka_unit_test(sub_value_shared_test),
+        cmocka_unit_test(sub_value_ack_test)
+    };
+
+    return cmocka_run_group_tests(tests, test_broker_setup, test_broker_teardown);
+}
@@ -0,0 +1,138 @@
+#ifndef SDK_DSLINK_C_BROKER_TEST_H
+#define SDK_DSLINK_C_BROKER_TEST_H
+
+#include <stdio.h>
+#include <string.h>
+#include <wslay/wslay.h>
+#include <broker/subscription.h>
+#include <broker/config.h>
+#include <broker/broker.h>
+#include <broker/sys/throughput.h>
+#include <dslink/utils.h>
+
+// Broker state for tests which drive the broker without its server, the
+// loop of the test group is the main loop of the broker.
+
+#define TEST_TS "2026-01-01T00:00:00.000+00:00"
+
+static uv_loop_t test_loop;
+static BrokerNode *test_sys;
+
+static inline
+void test_close_handle(uv_handle_t *handle, void *arg) {
+    (void) arg;
+    if (!uv_is_closing(handle)) {
+        uv_close(handle, NULL);
+    }
+}
+
+// Group setup, the throughput counters are updated by every message sent.
+static inline
+int test_broker_setup(void **state) {
+    (void) state;
+    uv_loop_init(&test_loop);
+    mainLoop = &test_loop;
+    test_sys = broker_node_create("sys", "node");
+    test_sys->path = dslink_strdup("/sys");
+    return init_throughput(test_sys);
+}
+
+static inline
+int test_broker_teardown(void **state) {
+    (void) state;
+    broker_node_free(test_sys);
+    uv_walk(&test_loop, test_close_handle, NULL);
+    uv_run(&test_loop, UV_RUN_DEFAULT);
+    uv_loop_close(&test_loop);
+    return 0;
+}
+
+// A requester which never reads, the messages stay queued in its web
+// socket. Setting node.link to NULL disconnects it.
+typedef struct {
+    DownstreamNode node;
+    RemoteDSLink link;
+    Client client;
+    char path[32];
+} TestRequester;
+
+// The requester is added as /downstream/<name>.
+static inline
+void test_requester_init(TestRequester *req, const char *name) {
+    memset(req, 0, sizeof(TestRequester));
+    dslink_map_init(&req->node.req_sub_paths, dslink_map_str_cmp,
+                    dslink_map_str_key_len_cal, dslink_map_hash_key);
+    dslink_map_init(&req->node.req_sub_sids, dslink_map_uint32_cmp,
+                    dslink_map_uint32_key_len_cal, dslink_map_hash_key);
+    list_init(&req->node.dirtySubs);
+    snprintf(req->path, sizeof(req->path), "/downstream/%s", name);
+    req->node.path = req->path;
+    req->node.link = &req->link;
+    req->link.node = &req->node;
+    req->link.client = &req->client;
+    struct wslay_event_callbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+    wslay_event_context_server_init(&req->link.ws, &callbacks, NULL);
+}
+
+static inline
+void test_requester_free(TestRequester *req) {
+    wslay_event_context_free(req->link.ws);
+    dslink_map_free(&req->node.req_sub_paths);
+    dslink_map_free(&req->node.req_sub_sids);
+    broker_clear_pending_acks(&req->node);
+}
+
+// Updates the subscription with an integer value, the sid is filled in
+// when it is sent.
+static inline
+void test_update_value(SubRequester *sub, int value) {
+    json_t *varray = json_pack("[n,i,s]", value, TEST_TS);
+    broker_update_sub_req(sub, varray);
+    json_decref(varray);
+}
+
+// A disconnected requester subscribed to a stream with QoS 2, the values
+// passed by its filter stay in the queue of the subscription.
+typedef struct {
+    TestRequester req;
+    SubRequester *sub;
+} TestSubscriber;
+
+static inline
+void test_subscriber_init(TestSubscriber *s, BrokerSubStream *stream,
+                          int idx, const char *filter) {
+    char name[16];
+    snprintf(name, sizeof(name), "requester%d", idx);
+    test_requester_init(&s->req, name);
+    s->req.node.link = NULL;
+
+    s->sub = broker_create_sub_requester(&s->req.node, "/downstream/responder/a", 1, 2, NULL);
+    json_t *sub = json_loads(filter, 0, NULL);
+    broker_sub_filter_parse(&s->sub->filter, sub);
+    json_decref(sub);
+    dslink_map_set(&stream->reqSubs, dslink_ref(&s->req.node, NULL),
+                   dslink_ref(s->sub, NULL));
+}
+
+static inline
+void test_subscriber_free(TestSubscriber *s, BrokerSubStream *stream) {
+    dslink_map_remove(&stream->reqSubs, &s->req.node);
+    broker_free_sub_requester(s->sub);
+    test_requester_free(&s->req);
+}
+
+static inline
+size_t test_queued(TestSubscriber *s) {
+    return s->sub->messageQueue ? rb_count(s->sub->messageQueue) : 0;
+}
+
+// Frees a stream created by broker_stream_sub_init without a responder.
+static inline
+void test_sub_stream_free(BrokerSubStream *stream) {
+    broker_sub_value_unref(stream->last_value);
+    dslink_map_free(&stream->reqSubs);
+    dslink_free(stream);
+}
+
+#endif // SDK_DSLINK_C_BROKER_TEST_H
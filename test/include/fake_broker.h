@@ -0,0 +1,122 @@
+#ifndef SDK_DSLINK_C_FAKE_BROKER_H
+#define SDK_DSLINK_C_FAKE_BROKER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <uv.h>
+#include <dslink/dslink.h>
+#include <dslink/socket.h>
+#include <dslink/socket_private.h>
+#include <dslink/mem/mem.h>
+
+// The broker side of a link connected through a socket pair. The link side
+// is served by dslink_handshake_handle_ws, the broker side polls the socket
+// from a timer on the link's loop and reads the masked frames of the link.
+typedef struct FakeBroker FakeBroker;
+typedef void (*fake_broker_frame_cb)(FakeBroker *broker,
+                                     const char *payload, size_t len);
+
+struct FakeBroker {
+    int fd;
+    uv_timer_t timer;
+    fake_broker_frame_cb on_frame;
+
+    uint64_t frames;
+    uint64_t bytes;
+
+    uint8_t buf[1 << 20];
+    size_t len;
+};
+
+// Creates the socket pair, link->msg has to be set by the caller.
+static inline
+int fake_broker_connect(FakeBroker *broker, DSLink *link) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        return -1;
+    }
+    fcntl(sv[1], F_SETFL, fcntl(sv[1], F_GETFL) | O_NONBLOCK);
+
+    broker->fd = sv[1];
+    broker->len = 0;
+    broker->frames = 0;
+    broker->bytes = 0;
+    link->_socket = dslink_socket_init(0);
+    link->_socket->socket_ctx.fd = sv[0];
+    return 0;
+}
+
+static inline
+void fake_broker_close(FakeBroker *broker, DSLink *link) {
+    close(link->_socket->socket_ctx.fd);
+    dslink_free(link->_socket);
+    link->_socket = NULL;
+    close(broker->fd);
+}
+
+// Polls the socket every millisecond, the timer's data is the link.
+static inline
+void fake_broker_start(FakeBroker *broker, DSLink *link, uv_timer_cb tick) {
+    uv_timer_init(&link->loop, &broker->timer);
+    broker->timer.data = link;
+    uv_timer_start(&broker->timer, tick, 1, 1);
+}
+
+// Stops polling and ends dslink_handshake_handle_ws.
+static inline
+void fake_broker_stop(FakeBroker *broker, DSLink *link) {
+    uv_timer_stop(&broker->timer);
+    uv_close((uv_handle_t *) &broker->timer, NULL);
+    uv_stop(&link->loop);
+}
+
+// Reads the frames sent by the link, every complete frame is unmasked and
+// handed to on_frame.
+static inline
+void fake_broker_read_frames(FakeBroker *broker) {
+    ssize_t r;
+    while ((r = read(broker->fd, broker->buf + broker->len,
+                     sizeof(broker->buf) - broker->len)) > 0) {
+        broker->len += (size_t) r;
+    }
+
+    size_t pos = 0;
+    while (broker->len - pos >= 2) {
+        uint8_t *p = broker->buf + pos;
+        uint64_t len = p[1] & 0x7f;
+        size_t head = 2;
+        if (len == 126) {
+            len = ((uint64_t) p[2] << 8) | p[3];
+            head = 4;
+        } else if (len == 127) {
+            len = 0;
+            for (int i = 0; i < 8; ++i) {
+                len = (len << 8) | p[2 + i];
+            }
+            head = 10;
+        }
+        uint8_t *mask = p + head;
+        head += 4;
+        if (broker->len - pos < head + len) {
+            break;
+        }
+
+        uint8_t *payload = p + head;
+        for (uint64_t i = 0; i < len; ++i) {
+            payload[i] ^= mask[i % 4];
+        }
+        broker->frames++;
+        broker->bytes += len;
+        if (broker->on_frame) {
+            broker->on_frame(broker, (char *) payload, (size_t) len);
+        }
+        pos += head + len;
+    }
+    memmove(broker->buf, broker->buf + pos, broker->len - pos);
+    broker->len -= pos;
+}
+
+#endif // SDK_DSLINK_C_FAKE_BROKER_H
@@ -0,0 +1,74 @@
+#ifndef SDK_DSLINK_C_RESPONDER_FIXTURE_H
+#define SDK_DSLINK_C_RESPONDER_FIXTURE_H
+
+#include <string.h>
+#include <dslink/dslink.h>
+#include <dslink/node.h>
+#include <dslink/value_snapshot.h>
+#include <dslink/err.h>
+#include <dslink/mem/mem.h>
+#include <dslink/col/map.h>
+
+// Responder state for tests and benches which drive the SDK without
+// going through dslink_init.
+
+static inline
+Map *test_map(int uint32Keys) {
+    Map *map = dslink_calloc(1, sizeof(Map));
+    if (!map) {
+        return NULL;
+    }
+    if (dslink_map_init(map,
+                        uint32Keys ? dslink_map_uint32_cmp : dslink_map_str_cmp,
+                        uint32Keys ? dslink_map_uint32_key_len_cal : dslink_map_str_key_len_cal,
+                        dslink_map_hash_key) != 0) {
+        dslink_free(map);
+        return NULL;
+    }
+    return map;
+}
+
+// Attaches the responder to the link and creates its maps and super root.
+static inline
+int test_responder_init(DSLink *link, Responder *responder) {
+    memset(responder, 0, sizeof(Responder));
+    link->responder = responder;
+    link->is_responder = 1;
+
+    responder->open_streams = test_map(1);
+    responder->list_subs = test_map(0);
+    responder->value_path_subs = test_map(0);
+    responder->value_sid_subs = test_map(1);
+    responder->super_root = dslink_node_create(NULL, "/", "node");
+    if (!responder->open_streams || !responder->list_subs
+        || !responder->value_path_subs || !responder->value_sid_subs
+        || !responder->super_root) {
+        return DSLINK_ALLOC_ERR;
+    }
+    return 0;
+}
+
+static inline
+void test_responder_free(DSLink *link) {
+    Responder *responder = link->responder;
+    if (!responder) {
+        return;
+    }
+    if (responder->super_root) {
+        dslink_node_tree_free(link, responder->super_root);
+        responder->super_root = NULL;
+    }
+    dslink_node_value_snapshots_free(link);
+
+    Map **maps[] = { &responder->open_streams, &responder->list_subs,
+                     &responder->value_path_subs, &responder->value_sid_subs };
+    for (size_t i = 0; i < sizeof(maps) / sizeof(maps[0]); ++i) {
+        if (*maps[i]) {
+            dslink_map_free(*maps[i]);
+            dslink_free(*maps[i]);
+            *maps[i] = NULL;
+        }
+    }
+}
+
+#endif // SDK_DSLINK_C_RESPONDER_FIXTURE_H
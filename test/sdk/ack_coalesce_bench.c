@@ -0,0 +1,166 @@
+/*
+ * Number of frames the link sends to ack a stream of broker messages,
+ * acking every message versus coalescing acks per loop iteration or
+ * per ack delay. The broker side is simulated on a socket pair.
+ */
+
+#define LOG_TAG "ack_coalesce_bench"
+
+#include <dslink/log.h>
+#include <dslink/dslink.h>
+#include <dslink/ws.h>
+#include <dslink/socket.h>
+#include <dslink/socket_private.h>
+#include <dslink/mem/mem.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define BENCH_MESSAGES 20000
+#define BENCH_BURST 50
+
+typedef struct {
+    int fd;
+    uv_timer_t timer;
+    uint32_t sent;
+    uint32_t last_ack;
+    uint64_t frames;
+    uint64_t ack_frames;
+    uint8_t buf[1 << 16];
+    size_t len;
+} BenchBroker;
+
+static BenchBroker broker;
+
+static
+void broker_send_burst() {
+    char frame[128];
+    for (int i = 0; i < BENCH_BURST && broker.sent < BENCH_MESSAGES; ++i) {
+        int len = snprintf(frame + 2, sizeof(frame) - 2,
+                           "{\"msg\":%u,\"responses\":[]}", broker.sent + 1);
+        frame[0] = (char) 0x81;
+        frame[1] = (char) len;
+        if (write(broker.fd, frame, (size_t) len + 2) != len + 2) {
+            break;
+        }
+        broker.sent++;
+    }
+}
+
+// Parses the masked frames sent by the link
+static
+void broker_read_frames() {
+    ssize_t r;
+    while ((r = read(broker.fd, broker.buf + broker.len,
+                     sizeof(broker.buf) - broker.len)) > 0) {
+        broker.len += (size_t) r;
+    }
+
+    size_t pos = 0;
+    while (broker.len - pos >= 2) {
+        uint8_t *p = broker.buf + pos;
+        uint64_t len = p[1] & 0x7f;
+        size_t head = 2;
+        if (len == 126) {
+            len = ((uint64_t) p[2] << 8) | p[3];
+            head = 4;
+        } else if (len == 127) {
+            len = 0;
+            for (int i = 0; i < 8; ++i) {
+                len = (len << 8) | p[2 + i];
+            }
+            head = 10;
+        }
+        uint8_t *mask = p + head;
+        head += 4;
+        if (broker.len - pos < head + len) {
+            break;
+        }
+
+        char payload[256];
+        size_t n = len < sizeof(payload) - 1 ? len : sizeof(payload) - 1;
+        for (size_t i = 0; i < n; ++i) {
+            payload[i] = (char) (p[head + i] ^ mask[i % 4]);
+        }
+        payload[n] = '\0';
+
+        broker.frames++;
+        char *ack = strstr(payload, "\"ack\":");
+        if (ack) {
+            broker.ack_frames++;
+            broker.last_ack = (uint32_t) strtoul(ack + 6, NULL, 10);
+        }
+        pos += head + len;
+    }
+    memmove(broker.buf, broker.buf + pos, broker.len - pos);
+    broker.len -= pos;
+}
+
+static
+void broker_tick(uv_timer_t *timer) {
+    DSLink *link = timer->data;
+    broker_read_frames();
+    if (broker.sent < BENCH_MESSAGES) {
+        broker_send_burst();
+    } else if (broker.last_ack == BENCH_MESSAGES) {
+        uv_timer_stop(timer);
+        uv_close((uv_handle_t *) timer, NULL);
+        uv_stop(&link->loop);
+    }
+}
+
+static
+void bench_ready(DSLink *link) {
+    uv_timer_init(&link->loop, &broker.timer);
+    broker.timer.data = link;
+    uv_timer_start(&broker.timer, broker_tick, 1, 1);
+}
+
+static
+void bench_run(const char *name, long ack_delay) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        return;
+    }
+    fcntl(sv[1], F_SETFL, fcntl(sv[1], F_GETFL) | O_NONBLOCK);
+
+    memset(&broker, 0, sizeof(BenchBroker));
+    broker.fd = sv[1];
+
+    DSLink link;
+    uint32_t msg = 0;
+    memset(&link, 0, sizeof(DSLink));
+    uv_loop_init(&link.loop);
+    link.loop.data = &link;
+    link.msg = &msg;
+    link.config.ack_delay = ack_delay;
+    link._socket = dslink_socket_init(0);
+    link._socket->socket_ctx.fd = sv[0];
+
+    uint64_t start = uv_hrtime();
+    dslink_handshake_handle_ws(&link, bench_ready);
+    uint64_t elapsed = uv_hrtime() - start;
+
+    // let the closed handles finish
+    uv_run(&link.loop, UV_RUN_NOWAIT);
+    uv_loop_close(&link.loop);
+    dslink_free(link._socket);
+    close(sv[0]);
+    close(sv[1]);
+
+    printf("%-22s %8u msgs %8llu frames %8llu acks %6.1f msgs/ack %6llu ms\n",
+           name, broker.sent, (unsigned long long) broker.frames,
+           (unsigned long long) broker.ack_frames,
+           broker.ack_frames ? (double) broker.sent / broker.ack_frames : 0.0,
+           (unsigned long long) (elapsed / 1000000));
+}
+
+int main() {
+    bench_run("ack every message", -1);
+    bench_run("ack per loop iteration", 0);
+    bench_run("ack delay 5 ms", 5);
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <dslink/col/mpsc_queue.h>
+#include "cmocka_init.h"
+
+static
+void col_mpsc_init_test(void **state) {
+    (void) state;
+
+    MpscQueue q;
+    assert_int_equal(mpsc_init(&q, 8, sizeof(int)), 0);
+    assert_int_equal(q.size, 8);
+    assert_true(mpsc_empty(&q));
+
+    mpsc_free(&q);
+}
+
+static
+void col_mpsc_misconfigure_test(void **state) {
+    (void) state;
+
+    MpscQueue q;
+    assert_int_equal(mpsc_init(&q, 0, sizeof(int)), -1);
+    assert_int_equal(mpsc_init(&q, 6, sizeof(int)), -1);
+
+    int n = 815;
+    assert_int_equal(mpsc_push(&q, &n), -1);
+    assert_int_equal(mpsc_pop(&q, &n), -1);
+    assert_int_equal(mpsc_free(&q), -1);
+}
+
+static
+void col_mpsc_push_pop_test(void **state) {
+    (void) state;
+
+    MpscQueue q;
+    mpsc_init(&q, 4, sizeof(int));
+
+    int n = 4711;
+    // the first push after the queue went idle requests a wake up
+    assert_int_equal(mpsc_push(&q, &n), 1);
+    n = 815;
+    assert_int_equal(mpsc_push(&q, &n), 0);
+    n = 42;
+    assert_int_equal(mpsc_push(&q, &n), 0);
+    n = 666;
+    assert_int_equal(mpsc_push(&q, &n), 0);
+    n = 1;
+    assert_int_equal(mpsc_push(&q, &n), -1);
+
+    assert_int_equal(mpsc_pop(&q, &n), 0);
+    assert_int_equal(n, 4711);
+    assert_int_equal(mpsc_pop(&q, &n), 0);
+    assert_int_equal(n, 815);
+
+    // not idle yet, no further wake up
+    n = 7;
+    assert_int_equal(mpsc_push(&q, &n), 0);
+
+    assert_int_equal(mpsc_pop(&q, &n), 0);
+    assert_int_equal(n, 42);
+    assert_int_equal(mpsc_pop(&q, &n), 0);
+    assert_int_equal(n, 666);
+    assert_int_equal(mpsc_pop(&q, &n), 0);
+    assert_int_equal(n, 7);
+    assert_int_equal(mpsc_pop(&q, &n), -1);
+    assert_true(mpsc_empty(&q));
+
+    n = 8;
+    assert_int_equal(mpsc_push(&q, &n), 1);
+    assert_int_equal(mpsc_pop(&q, &n), 0);
+    assert_int_equal(n, 8);
+
+    mpsc_free(&q);
+}
+
+#define PRODUCERS 4
+#define PER_PRODUCER 100000
+
+typedef struct {
+    MpscQueue *q;
+    int id;
+} ProducerArgs;
+
+static
+void *col_mpsc_producer(void *arg) {
+    ProducerArgs *args = arg;
+    for (int i = 0; i < PER_PRODUCER; ++i) {
+        int n = args->id * PER_PRODUCER + i;
+        while (mpsc_push(args->q, &n) < 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static
+void col_mpsc_threads_test(void **state) {
+    (void) state;
+
+    MpscQueue q;
+    mpsc_init(&q, 256, sizeof(int));
+
+    pthread_t threads[PRODUCERS];
+    ProducerArgs args[PRODUCERS];
+    for (int i = 0; i < PRODUCERS; ++i) {
+        args[i].q = &q;
+        args[i].id = i;
+        pthread_create(&threads[i], NULL, col_mpsc_producer, &args[i]);
+    }
+
+    // every producer's values have to arrive in order
+    int next[PRODUCERS] = {0};
+    int received = 0;
+    while (received < PRODUCERS * PER_PRODUCER) {
+        int n;
+        if (mpsc_pop(&q, &n) != 0) {
+            sched_yield();
+            continue;
+        }
+        int id = n / PER_PRODUCER;
+        assert_int_equal(n % PER_PRODUCER, next[id]);
+        ++next[id];
+        ++received;
+    }
+
+    for (int i = 0; i < PRODUCERS; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    assert_true(mpsc_empty(&q));
+
+    mpsc_free(&q);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(col_mpsc_init_test),
+        cmocka_unit_test(col_mpsc_misconfigure_test),
+        cmocka_unit_test(col_mpsc_push_pop_test),
+        cmocka_unit_test(col_mpsc_threads_test)
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
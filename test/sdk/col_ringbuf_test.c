@@ -216,6 +216,53 @@ void col_buf_load_test(void **state) {
     rb_free(&rb);
 }
 
+static
+void col_buf_grow_shrink_test(void **state) {
+    (void) state;
+
+    Ringbuffer rb;
+    rb_init(&rb, 1000, sizeof(int), NULL);
+    assert_int_equal(rb.capacity, 0);
+    assert_null(rb.data);
+
+    // wrap around before growing
+    int n = 0;
+    for(; n < 3; ++n) {
+        rb_push(&rb, &n);
+    }
+    rb_pop(&rb);
+    for(; n < 200; ++n) {
+        rb_push(&rb, &n);
+    }
+    assert_int_equal(rb.capacity, 256);
+    for(int i = 0; i < 199; ++i) {
+        assert_int_equal(*(int*)rb_at(&rb, i), i + 1);
+    }
+
+    // capped by the size
+    for(; n < 1500; ++n) {
+        rb_push(&rb, &n);
+    }
+    assert_int_equal(rb.capacity, 1000);
+    assert_int_equal(*(int*)rb_front(&rb), 500);
+
+    while(rb_count(&rb) > 10) {
+        rb_pop(&rb);
+    }
+    assert_true(rb.capacity <= 64);
+    assert_int_equal(*(int*)rb_front(&rb), 1490);
+    assert_int_equal(*(int*)rb_at(&rb, 9), 1499);
+
+    // drained, no memory is held
+    while(rb_count(&rb) > 0) {
+        rb_pop(&rb);
+    }
+    assert_int_equal(rb.capacity, 0);
+    assert_null(rb.data);
+
+    rb_free(&rb);
+}
+
 int main() {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(col_buf_init_test),
@@ -223,7 +270,8 @@ int main() {
         cmocka_unit_test(col_buf_append_test),
         cmocka_unit_test(col_buf_push_n_pop_test),
         cmocka_unit_test(col_buf_at_test),
-        cmocka_unit_test(col_buf_load_test)
+        cmocka_unit_test(col_buf_load_test),
+        cmocka_unit_test(col_buf_grow_shrink_test)
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,130 @@
+/*
+ * Repeated list requests of a folder with many children, rebuilding the
+ * list payload for every request versus the cached payload of
+ * dslink_response_list. The broker side is simulated on a socket pair.
+ */
+
+#define LOG_TAG "list_cache_bench"
+
+#include <dslink/log.h>
+#include <dslink/dslink.h>
+#include <dslink/ws.h>
+#include <dslink/msg/list_response.h>
+#include <dslink/mem/mem.h>
+#include <stdio.h>
+#include <string.h>
+#include "responder_fixture.h"
+#include "fake_broker.h"
+
+#define BENCH_CHILDREN 5000
+#define BENCH_LISTS 200
+
+typedef struct {
+    FakeBroker base;
+    uint64_t start;
+    uint64_t responded; // time spent in dslink_response_list
+    uint64_t lists;
+} BenchBroker;
+
+static BenchBroker broker;
+static Responder bench_responder;
+static DSNode *bench_folder;
+static int bench_cached;
+
+static
+void bench_init_responder(DSLink *link) {
+    test_responder_init(link, &bench_responder);
+    bench_folder = dslink_node_create(bench_responder.super_root, "folder", "node");
+    dslink_node_add_child(link, bench_folder);
+    for (int i = 0; i < BENCH_CHILDREN; ++i) {
+        char name[16];
+        snprintf(name, sizeof(name), "point%d", i);
+        DSNode *node = dslink_node_create(bench_folder, name, "node");
+        dslink_node_add_child(link, node);
+        dslink_node_set_meta_new(link, node, "$type", json_string("number"));
+        dslink_node_set_meta_new(link, node, "$name", json_string(name));
+    }
+}
+
+static
+void bench_free_responder(DSLink *link) {
+    test_responder_free(link);
+    link->responder = NULL;
+}
+
+static
+void broker_count_lists(FakeBroker *base, const char *payload, size_t len) {
+    (void) base;
+    json_t *obj = json_loadb(payload, len, 0, NULL);
+    json_t *resp = json_array_get(json_object_get(obj, "responses"), 0);
+    if (json_array_size(json_object_get(resp, "updates")) == BENCH_CHILDREN + 1) {
+        broker.lists++;
+    }
+    json_decref(obj);
+}
+
+static
+void broker_tick(uv_timer_t *timer) {
+    DSLink *link = timer->data;
+    fake_broker_read_frames(&broker.base);
+    if (broker.lists >= BENCH_LISTS) {
+        fake_broker_stop(&broker.base, link);
+    }
+}
+
+static
+void bench_ready(DSLink *link) {
+    fake_broker_start(&broker.base, link, broker_tick);
+
+    broker.start = uv_hrtime();
+    json_t *req = json_object();
+    for (int i = 0; i < BENCH_LISTS; ++i) {
+        if (!bench_cached) {
+            bench_folder->list_version++;
+        }
+        // a dashboard closing and reopening the folder
+        dslink_map_remove(bench_responder.list_subs, (void *) bench_folder->path);
+        json_object_set_new(req, "rid", json_integer(i + 1));
+        dslink_response_list(link, req, bench_folder);
+    }
+    json_decref(req);
+    broker.responded = uv_hrtime() - broker.start;
+}
+
+static
+void bench_run(const char *name, int cached) {
+    memset(&broker, 0, sizeof(BenchBroker));
+    broker.base.on_frame = broker_count_lists;
+    bench_cached = cached;
+
+    DSLink link;
+    uint32_t msg = 0;
+    memset(&link, 0, sizeof(DSLink));
+    if (fake_broker_connect(&broker.base, &link) != 0) {
+        return;
+    }
+    uv_loop_init(&link.loop);
+    link.loop.data = &link;
+    link.msg = &msg;
+    bench_init_responder(&link);
+
+    dslink_handshake_handle_ws(&link, bench_ready);
+    uint64_t elapsed = uv_hrtime() - broker.start;
+
+    bench_free_responder(&link);
+    uv_run(&link.loop, UV_RUN_NOWAIT);
+    uv_loop_close(&link.loop);
+    fake_broker_close(&broker.base, &link);
+
+    printf("%-16s %4llu lists %4llu frames %9llu bytes %8.1f ms responding %8.1f ms total\n",
+           name, (unsigned long long) broker.lists,
+           (unsigned long long) broker.base.frames,
+           (unsigned long long) broker.base.bytes,
+           broker.responded / 1000000.0, elapsed / 1000000.0);
+}
+
+int main() {
+    bench_run("rebuilt payload", 0);
+    bench_run("cached payload", 1);
+    return 0;
+}
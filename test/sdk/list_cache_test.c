@@ -0,0 +1,144 @@
+#include <string.h>
+
+#include <dslink/node.h>
+#include <dslink/msg/list_response.h>
+#include <dslink/mem/mem.h>
+#include "cmocka_init.h"
+#include "responder_fixture.h"
+
+// The link isn't connected, only the cache is checked.
+static DSLink test_link;
+static Responder test_responder;
+static DSNode *test_folder;
+
+static
+json_t *test_list(DSNode *node) {
+    DSNodeListCache *cache = dslink_response_list_payload(node);
+    assert_non_null(cache);
+    assert_int_equal(strlen(cache->data), cache->len);
+    return json_loadb(cache->data, cache->len, 0, NULL);
+}
+
+static
+int list_cache_setup(void **state) {
+    (void) state;
+    memset(&test_link, 0, sizeof(DSLink));
+    if (test_responder_init(&test_link, &test_responder) != 0) {
+        return -1;
+    }
+    test_folder = dslink_node_create(test_responder.super_root, "folder", "node");
+    return dslink_node_add_child(&test_link, test_folder);
+}
+
+static
+int list_cache_teardown(void **state) {
+    (void) state;
+    test_responder_free(&test_link);
+    return 0;
+}
+
+static
+void list_cache_reuse_test(void **state) {
+    (void) state;
+
+    DSNodeListCache *cache = dslink_response_list_payload(test_folder);
+    assert_non_null(cache);
+    char *data = cache->data;
+    assert_string_equal("[[\"$is\", \"node\"]]", data);
+
+    // unchanged, the same buffer is returned
+    for (int i = 0; i < 10; ++i) {
+        cache = dslink_response_list_payload(test_folder);
+        assert_ptr_equal(data, cache->data);
+    }
+}
+
+static
+void list_cache_invalidate_test(void **state) {
+    (void) state;
+
+    DSNode *child = dslink_node_create(test_folder, "temp", "node");
+    dslink_node_add_child(&test_link, child);
+    json_t *updates = test_list(test_folder);
+    assert_int_equal(2, json_array_size(updates));
+    json_decref(updates);
+
+    dslink_node_set_meta_new(&test_link, test_folder, "$name", json_string("Folder"));
+    updates = test_list(test_folder);
+    assert_int_equal(3, json_array_size(updates));
+    assert_string_equal("Folder", json_string_value(
+        json_array_get(json_array_get(updates, 1), 1)));
+    json_decref(updates);
+
+    // private meta doesn't show up, but the payload is rebuilt
+    uint32_t version = test_folder->list_version;
+    dslink_node_set_meta_new(&test_link, test_folder, "$$$password", json_string("x"));
+    assert_int_not_equal(version, test_folder->list_version);
+    updates = test_list(test_folder);
+    assert_int_equal(3, json_array_size(updates));
+    json_decref(updates);
+
+    // the type of a child is part of the entry in its parent's list
+    dslink_node_set_meta_new(&test_link, child, "$type", json_string("number"));
+    updates = test_list(test_folder);
+    json_t *entry = json_array_get(json_array_get(updates, 2), 1);
+    assert_string_equal("number", json_string_value(json_object_get(entry, "$type")));
+    json_decref(updates);
+
+    // other meta of a child isn't
+    version = test_folder->list_version;
+    dslink_node_set_meta_new(&test_link, child, "@unit", json_string("C"));
+    assert_int_equal(version, test_folder->list_version);
+
+    dslink_node_remove(&test_link, child);
+    updates = test_list(test_folder);
+    assert_int_equal(2, json_array_size(updates));
+    json_decref(updates);
+}
+
+static
+void list_cache_deserialize_test(void **state) {
+    (void) state;
+
+    DSNode *child = dslink_node_create(test_folder, "point", "node");
+    dslink_node_add_child(&test_link, child);
+    json_t *updates = test_list(child);
+    assert_int_equal(1, json_array_size(updates));
+    json_decref(updates);
+    updates = test_list(test_folder);
+    json_decref(updates);
+
+    // loaded from the nodes file, the cached lists are rebuilt
+    json_t *data = json_pack("{s:s,s:s}", "$type", "number", "@unit", "C");
+    dslink_node_deserialize(&test_link, child, data);
+    json_decref(data);
+    updates = test_list(child);
+    assert_int_equal(3, json_array_size(updates));
+    json_decref(updates);
+    updates = test_list(test_folder);
+    json_t *entry = json_array_get(json_array_get(updates, 1), 1);
+    assert_string_equal("number", json_string_value(json_object_get(entry, "$type")));
+    json_decref(updates);
+
+    // the summary keys which are gone are left out of the parent's list
+    data = json_pack("{s:s}", "@unit", "C");
+    dslink_node_deserialize(&test_link, child, data);
+    json_decref(data);
+    updates = test_list(test_folder);
+    entry = json_array_get(json_array_get(updates, 1), 1);
+    assert_null(json_object_get(entry, "$type"));
+    json_decref(updates);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(list_cache_reuse_test,
+                                        list_cache_setup, list_cache_teardown),
+        cmocka_unit_test_setup_teardown(list_cache_invalidate_test,
+                                        list_cache_setup, list_cache_teardown),
+        cmocka_unit_test_setup_teardown(list_cache_deserialize_test,
+                                        list_cache_setup, list_cache_teardown)
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,154 @@
+#include <string.h>
+
+#include <dslink/node.h>
+#include <dslink/msg/list_response.h>
+#include <dslink/mem/mem.h>
+#include "cmocka_init.h"
+#include "responder_fixture.h"
+
+// The link has no connection, so the tests close the list stream before
+// anything is flushed and only check what was collected.
+static DSLink test_link;
+static Responder test_responder;
+static DSNode *test_device;
+
+static
+void test_open_list(DSNode *node) {
+    uint32_t *rid = dslink_malloc(sizeof(uint32_t));
+    *rid = 1;
+    dslink_map_set(test_responder.list_subs,
+                   dslink_str_ref(node->path),
+                   dslink_ref(rid, dslink_free));
+}
+
+static
+void test_close_list(DSNode *node) {
+    dslink_map_remove(test_responder.list_subs, (void *) node->path);
+}
+
+static
+json_t *test_changed_names(DSNode *node) {
+    ref_t *ref = dslink_map_get(test_link.list_changes, (void *) node->path);
+    return ref ? ref->data : NULL;
+}
+
+static
+int list_changes_setup(void **state) {
+    (void) state;
+    memset(&test_link, 0, sizeof(DSLink));
+    uv_loop_init(&test_link.loop);
+    if (test_responder_init(&test_link, &test_responder) != 0) {
+        return -1;
+    }
+    // never written to, the streams are closed before a flush
+    test_link._ws = (void *) &test_link;
+
+    test_link.list_timer = dslink_malloc(sizeof(uv_timer_t));
+    uv_timer_init(&test_link.loop, test_link.list_timer);
+    test_link.list_timer->data = &test_link;
+
+    test_device = dslink_node_create(test_responder.super_root, "device", "node");
+    dslink_node_add_child(&test_link, test_device);
+    test_open_list(test_device);
+    return 0;
+}
+
+static
+void test_timer_on_close(uv_handle_t *handle) {
+    dslink_free(handle);
+}
+
+static
+int list_changes_teardown(void **state) {
+    (void) state;
+    test_close_list(test_device);
+    test_responder_free(&test_link);
+
+    uv_close((uv_handle_t *) test_link.list_timer, test_timer_on_close);
+    uv_run(&test_link.loop, UV_RUN_NOWAIT);
+    uv_loop_close(&test_link.loop);
+
+    if (test_link.list_changes) {
+        dslink_map_free(test_link.list_changes);
+        dslink_free(test_link.list_changes);
+    }
+    return 0;
+}
+
+static
+void list_changes_coalesce_test(void **state) {
+    (void) state;
+
+    for (int i = 0; i < 5; ++i) {
+        dslink_node_set_meta_new(&test_link, test_device, "@unit",
+                                 json_integer(i));
+    }
+    DSNode *child = dslink_node_create(test_device, "temp", "node");
+    dslink_node_add_child(&test_link, child);
+    dslink_node_set_meta_new(&test_link, child, "$type", json_string("number"));
+    dslink_node_remove(&test_link, child);
+
+    // one pending change per name, flushed once per loop iteration
+    json_t *names = test_changed_names(test_device);
+    assert_non_null(names);
+    assert_int_equal(2, json_object_size(names));
+    assert_non_null(json_object_get(names, "@unit"));
+    assert_non_null(json_object_get(names, "temp"));
+    assert_true(uv_is_active((uv_handle_t *) test_link.list_timer));
+
+    // the changes of a closed stream are dropped
+    test_close_list(test_device);
+    uv_run(&test_link.loop, UV_RUN_NOWAIT);
+    assert_int_equal(0, test_link.list_changes->size);
+
+    // nothing is collected without a list stream
+    dslink_node_set_meta_new(&test_link, test_device, "@unit", json_integer(1));
+    assert_int_equal(0, test_link.list_changes->size);
+    test_open_list(test_device);
+}
+
+static
+void list_changes_build_test(void **state) {
+    (void) state;
+
+    dslink_node_build_begin(&test_link);
+    dslink_node_build_begin(&test_link);
+    for (int i = 0; i < 200; ++i) {
+        char name[16];
+        snprintf(name, sizeof(name), "point%d", i);
+        DSNode *point = dslink_node_create(test_device, name, "node");
+        dslink_node_add_child(&test_link, point);
+        for (int j = 0; j < 10; ++j) {
+            snprintf(name, sizeof(name), "@attr%d", j);
+            dslink_node_set_meta_new(&test_link, point, name, json_integer(j));
+        }
+    }
+    dslink_node_build_end(&test_link);
+
+    // held back until the outermost build ends
+    assert_false(uv_is_active((uv_handle_t *) test_link.list_timer));
+    json_t *names = test_changed_names(test_device);
+    assert_non_null(names);
+    assert_int_equal(200, json_object_size(names));
+
+    test_close_list(test_device);
+    dslink_node_build_end(&test_link);
+    assert_int_equal(0, test_link.list_building);
+    assert_int_equal(0, test_link.list_changes->size);
+
+    // unbalanced ends are ignored
+    dslink_node_build_end(&test_link);
+    assert_int_equal(0, test_link.list_building);
+    test_open_list(test_device);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(list_changes_coalesce_test,
+                                        list_changes_setup, list_changes_teardown),
+        cmocka_unit_test_setup_teardown(list_changes_build_test,
+                                        list_changes_setup, list_changes_teardown)
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
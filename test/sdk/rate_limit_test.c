@@ -0,0 +1,169 @@
+#include <string.h>
+
+#include <dslink/rate_limit.h>
+#include <dslink/mem/mem.h>
+#include "cmocka_init.h"
+#include "responder_fixture.h"
+
+// Nothing is subscribed, so flushing a pending update only resets it.
+static DSLink test_link;
+static Responder test_responder;
+static DSNode *test_node;
+
+static
+int rate_limit_setup(void **state) {
+    (void) state;
+    memset(&test_link, 0, sizeof(DSLink));
+    uv_loop_init(&test_link.loop);
+    if (test_responder_init(&test_link, &test_responder) != 0) {
+        return 1;
+    }
+
+    test_node = dslink_node_create(test_responder.super_root, "node", "node");
+    if (!test_node) {
+        return 1;
+    }
+    return dslink_node_add_child(&test_link, test_node);
+}
+
+static
+int rate_limit_teardown(void **state) {
+    (void) state;
+    test_responder_free(&test_link);
+    uv_run(&test_link.loop, UV_RUN_NOWAIT);
+    uv_loop_close(&test_link.loop);
+    return 0;
+}
+
+static
+void rate_limit_off_test(void **state) {
+    (void) state;
+
+    for (int i = 0; i < 10; ++i) {
+        assert_int_equal(0, dslink_node_rate_limit_hold(&test_link, test_node));
+    }
+
+    assert_int_equal(0, dslink_node_set_rate_limit(&test_link, test_node, 1000, 0));
+    assert_non_null(test_node->rate_limit);
+    assert_int_equal(0, dslink_node_set_rate_limit(&test_link, test_node, 0, 0));
+    assert_null(test_node->rate_limit);
+
+    assert_int_equal(0, dslink_node_set_max_rate(&test_link, test_node, 4, 0));
+    assert_int_equal(250, test_node->rate_limit->min_interval);
+    assert_int_equal(0, dslink_node_set_max_rate(&test_link, test_node, 5000, 0));
+    assert_int_equal(1, test_node->rate_limit->min_interval);
+    assert_int_equal(0, dslink_node_set_max_rate(&test_link, test_node, 0, 0));
+    assert_null(test_node->rate_limit);
+}
+
+static
+void rate_limit_conflate_test(void **state) {
+    (void) state;
+
+    assert_int_equal(0, dslink_node_set_rate_limit(&test_link, test_node, 50, 0));
+    DSNodeRateLimit *limit = test_node->rate_limit;
+
+    uv_update_time(&test_link.loop);
+    uint64_t start = uv_now(&test_link.loop);
+    assert_int_equal(0, dslink_node_rate_limit_hold(&test_link, test_node));
+    for (int i = 0; i < 10; ++i) {
+        assert_int_equal(1, dslink_node_rate_limit_hold(&test_link, test_node));
+    }
+    assert_true(limit->pending);
+    assert_int_equal(9, limit->conflated);
+
+    // the timer sends the newest value after the interval
+    uv_run(&test_link.loop, UV_RUN_DEFAULT);
+    assert_false(limit->pending);
+    assert_true(limit->last_sent - start >= 50);
+}
+
+// Updates the node from a timer and records when updates were sent.
+typedef struct {
+    uv_timer_t timer;
+    int updates;
+    uint64_t sent[64];
+    int sends;
+} RateLimitDriver;
+
+static RateLimitDriver driver;
+
+static
+void rate_limit_record(DSNodeRateLimit *limit) {
+    if (driver.sends == 0 || driver.sent[driver.sends - 1] != limit->last_sent) {
+        driver.sent[driver.sends++] = limit->last_sent;
+    }
+}
+
+static
+void rate_limit_drive(uv_timer_t *timer) {
+    DSNodeRateLimit *limit = test_node->rate_limit;
+    rate_limit_record(limit);
+    dslink_node_rate_limit_hold(&test_link, test_node);
+    rate_limit_record(limit);
+    if (--driver.updates == 0) {
+        uv_timer_stop(timer);
+        uv_close((uv_handle_t *) timer, NULL);
+    }
+}
+
+static
+void rate_limit_run_driver(uint64_t every, int updates) {
+    memset(&driver, 0, sizeof(RateLimitDriver));
+    driver.updates = updates;
+    uv_update_time(&test_link.loop);
+    assert_int_equal(0, dslink_node_rate_limit_hold(&test_link, test_node));
+    rate_limit_record(test_node->rate_limit);
+
+    uv_timer_init(&test_link.loop, &driver.timer);
+    uv_timer_start(&driver.timer, rate_limit_drive, every, every);
+    uv_run(&test_link.loop, UV_RUN_DEFAULT);
+    rate_limit_record(test_node->rate_limit);
+}
+
+static
+void rate_limit_settle_test(void **state) {
+    (void) state;
+
+    assert_int_equal(0, dslink_node_set_rate_limit(&test_link, test_node, 50, 20));
+    DSNodeRateLimit *limit = test_node->rate_limit;
+
+    // a node that never settles is still sent, a settle time after the interval
+    rate_limit_run_driver(5, 40);
+    assert_false(limit->pending);
+    assert_true(driver.sends >= 3);
+    for (int i = 1; i < driver.sends; ++i) {
+        assert_true(driver.sent[i] - driver.sent[i - 1] >= 50);
+    }
+}
+
+static
+void rate_limit_settle_pause_test(void **state) {
+    (void) state;
+
+    assert_int_equal(0, dslink_node_set_rate_limit(&test_link, test_node, 50, 20));
+    DSNodeRateLimit *limit = test_node->rate_limit;
+
+    // pausing for just over the settle time doesn't send before the interval
+    rate_limit_run_driver(21, 12);
+    assert_false(limit->pending);
+    assert_true(driver.sends >= 3);
+    for (int i = 1; i < driver.sends; ++i) {
+        assert_true(driver.sent[i] - driver.sent[i - 1] >= 50);
+    }
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(rate_limit_off_test,
+                                        rate_limit_setup, rate_limit_teardown),
+        cmocka_unit_test_setup_teardown(rate_limit_conflate_test,
+                                        rate_limit_setup, rate_limit_teardown),
+        cmocka_unit_test_setup_teardown(rate_limit_settle_test,
+                                        rate_limit_setup, rate_limit_teardown),
+        cmocka_unit_test_setup_teardown(rate_limit_settle_pause_test,
+                                        rate_limit_setup, rate_limit_teardown)
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,209 @@
+#include <string.h>
+
+#include <wslay/wslay.h>
+
+#include <dslink/ws.h>
+#include <dslink/requester.h>
+#include "cmocka_init.h"
+#include "responder_fixture.h"
+#include "fake_broker.h"
+
+// Two connections of a link keeping its node tree, cleared in between the
+// way dslink_init does before reconnecting.
+#define TEST_CONNECTS 2
+
+static FakeBroker broker;
+static uint64_t broker_updates;
+
+static Responder test_responder;
+static DSNode *test_node;
+static int test_sent;
+
+static
+void test_on_frame(FakeBroker *b, const char *payload, size_t len) {
+    (void) b;
+    json_t *obj = json_loadb(payload, len, 0, NULL);
+    size_t index;
+    json_t *resp;
+    json_array_foreach(json_object_get(obj, "responses"), index, resp) {
+        broker_updates += json_array_size(json_object_get(resp, "updates"));
+    }
+    json_decref(obj);
+}
+
+static
+void test_broker_tick(uv_timer_t *timer) {
+    DSLink *link = timer->data;
+    fake_broker_read_frames(&broker);
+    if (test_sent && !wslay_event_want_write(link->_ws)) {
+        fake_broker_read_frames(&broker);
+        fake_broker_stop(&broker, link);
+    }
+}
+
+static
+void test_ready(DSLink *link) {
+    fake_broker_start(&broker, link, test_broker_tick);
+    assert_int_equal(0, dslink_node_update_value_new(link, test_node,
+                                                     json_integer(test_sent + 1)));
+    test_sent = 1;
+}
+
+static
+void reconnect_keep_state_test(void **state) {
+    (void) state;
+
+    DSLink *link = dslink_calloc(1, sizeof(DSLink));
+    link->config.keep_state_on_reconnect = 1;
+    uv_loop_init(&link->loop);
+    link->loop.data = link;
+    assert_int_equal(0, test_responder_init(link, &test_responder));
+
+    // what the init callback sets up, it only runs for the first connection
+    link->link_data = json_pack("{s:b}", "test", 1);
+    test_node = dslink_node_create(test_responder.super_root, "node", "node");
+    assert_int_equal(0, dslink_node_add_child(link, test_node));
+    dslink_map_set(test_responder.value_path_subs,
+                   dslink_str_ref(test_node->path), dslink_int_ref(1));
+
+    memset(&broker, 0, sizeof(FakeBroker));
+    broker.on_frame = test_on_frame;
+    for (int i = 0; i < TEST_CONNECTS; ++i) {
+        // the state of a single connection, see dslink_init_do
+        link->msg = dslink_calloc(1, sizeof(uint32_t));
+        link->dslink_json = json_object();
+        test_sent = 0;
+        broker_updates = 0;
+
+        assert_int_equal(0, fake_broker_connect(&broker, link));
+        dslink_handshake_handle_ws(link, test_ready);
+        uv_run(&link->loop, UV_RUN_NOWAIT);
+        fake_broker_close(&broker, link);
+        assert_int_equal(1, broker_updates);
+
+        dslink_link_clear(link);
+        assert_null(link->_ws);
+        assert_null(link->msg);
+        assert_null(link->dslink_json);
+
+        // kept for the handshake of the next connection
+        assert_non_null(link->link_data);
+        assert_true(json_is_true(json_object_get(link->link_data, "test")));
+        assert_ptr_equal(test_node, dslink_node_get_path(test_responder.super_root,
+                                                         "/node"));
+    }
+
+    test_responder_free(link);
+    uv_loop_close(&link->loop);
+    dslink_link_free(link);
+}
+
+static Requester test_requester;
+static uint64_t broker_subscribes;
+static int test_ready_calls;
+
+static
+void test_requester_on_frame(FakeBroker *b, const char *payload, size_t len) {
+    (void) b;
+    json_t *obj = json_loadb(payload, len, 0, NULL);
+    size_t index;
+    json_t *req;
+    json_array_foreach(json_object_get(obj, "requests"), index, req) {
+        const char *method = json_string_value(json_object_get(req, "method"));
+        if (method && strcmp(method, "subscribe") == 0) {
+            broker_subscribes += json_array_size(json_object_get(req, "paths"));
+        }
+    }
+    json_decref(obj);
+}
+
+static
+void test_requester_tick(uv_timer_t *timer) {
+    DSLink *link = timer->data;
+    fake_broker_read_frames(&broker);
+    if (broker_subscribes > 0 && !wslay_event_want_write(link->_ws)) {
+        fake_broker_stop(&broker, link);
+    }
+}
+
+static
+void test_value(DSLink *link, uint32_t sid, json_t *val, json_t *ts) {
+    (void) link;
+    (void) sid;
+    (void) val;
+    (void) ts;
+}
+
+static
+void test_requester_ready(DSLink *link) {
+    test_ready_calls++;
+    dslink_requester_subscribe(link, "/data/point", test_value, 0);
+}
+
+static
+void reconnect_requester_ready_test(void **state) {
+    (void) state;
+
+    DSLink *link = dslink_calloc(1, sizeof(DSLink));
+    link->config.keep_state_on_reconnect = 1;
+    link->is_requester = 1;
+    uv_loop_init(&link->loop);
+    link->loop.data = link;
+
+    // what dslink_init_do sets up for the first connection
+    memset(&test_requester, 0, sizeof(Requester));
+    uint32_t rid = 0;
+    uint32_t sid = 0;
+    test_requester.rid = &rid;
+    test_requester.sid = &sid;
+    test_requester.request_handlers = test_map(1);
+    test_requester.open_streams = test_map(1);
+    test_requester.list_subs = test_map(0);
+    test_requester.value_handlers = test_map(1);
+    link->requester = &test_requester;
+
+    memset(&broker, 0, sizeof(FakeBroker));
+    broker.on_frame = test_requester_on_frame;
+    test_ready_calls = 0;
+    for (int i = 0; i < TEST_CONNECTS; ++i) {
+        link->msg = dslink_calloc(1, sizeof(uint32_t));
+        link->dslink_json = json_object();
+        broker_subscribes = 0;
+
+        assert_int_equal(0, fake_broker_connect(&broker, link));
+        fake_broker_start(&broker, link, test_requester_tick);
+        dslink_handshake_handle_ws(link, test_requester_ready);
+        uv_run(&link->loop, UV_RUN_NOWAIT);
+        fake_broker_close(&broker, link);
+
+        // subscribed once, sent again by the SDK on the next connection
+        assert_int_equal(1, test_ready_calls);
+        assert_int_equal(1, broker_subscribes);
+        assert_int_equal(1, test_requester.value_handlers->size);
+
+        // what dslink_reset_requester drops
+        dslink_map_clear(test_requester.request_handlers);
+        dslink_map_clear(test_requester.open_streams);
+        dslink_map_clear(test_requester.list_subs);
+        dslink_link_clear(link);
+    }
+
+    Map *maps[] = { test_requester.request_handlers, test_requester.open_streams,
+                    test_requester.list_subs, test_requester.value_handlers };
+    for (size_t i = 0; i < sizeof(maps) / sizeof(maps[0]); ++i) {
+        dslink_map_free(maps[i]);
+        dslink_free(maps[i]);
+    }
+    link->requester = NULL;
+    uv_loop_close(&link->loop);
+    dslink_link_free(link);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(reconnect_keep_state_test),
+        cmocka_unit_test(reconnect_requester_ready_test)
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,245 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <wslay/wslay.h>
+#include <dslink/send_window.h>
+#include <dslink/mem/mem.h>
+#include "cmocka_init.h"
+
+// Without a web socket nothing is sent, held messages stay in the window.
+static DSLink test_link;
+
+static
+int send_window_setup(void **state) {
+    (void) state;
+    memset(&test_link, 0, sizeof(DSLink));
+    test_link.config.send_window = 2;
+    return dslink_send_window_init(&test_link);
+}
+
+static
+int send_window_teardown(void **state) {
+    (void) state;
+    dslink_send_window_free(&test_link);
+    return 0;
+}
+
+static
+json_t *updates_msg(uint32_t sid, int value) {
+    return json_pack("{s:[{s:i,s:[[i,i,s]]}]}", "responses", "rid", 0,
+                     "updates", sid, value, "ts");
+}
+
+static
+void send_window_disabled_test(void **state) {
+    (void) state;
+
+    DSLink link;
+    memset(&link, 0, sizeof(DSLink));
+    assert_int_equal(0, dslink_send_window_init(&link));
+    assert_null(link.send_window);
+
+    json_t *msg = updates_msg(1, 1);
+    assert_int_equal(0, dslink_send_window_hold(&link, msg));
+    json_decref(msg);
+}
+
+static
+void send_window_conflate_test(void **state) {
+    (void) state;
+
+    DSLinkSendWindowStats stats;
+    json_t *msg = updates_msg(1, 1);
+    assert_int_equal(0, dslink_send_window_hold(&test_link, msg));
+    json_decref(msg);
+
+    dslink_send_window_sent(&test_link, 1, 100);
+    assert_false(dslink_send_window_full(&test_link));
+    dslink_send_window_sent(&test_link, 2, 100);
+    assert_true(dslink_send_window_full(&test_link));
+
+    for (int i = 0; i < 10; ++i) {
+        msg = updates_msg(1, i);
+        assert_int_equal(1, dslink_send_window_hold(&test_link, msg));
+        json_decref(msg);
+    }
+    msg = updates_msg(2, 0);
+    assert_int_equal(1, dslink_send_window_hold(&test_link, msg));
+    json_decref(msg);
+
+    msg = json_pack("{s:[{s:i,s:s}]}", "responses", "rid", 3, "stream", "open");
+    assert_int_equal(1, dslink_send_window_hold(&test_link, msg));
+    json_decref(msg);
+
+    dslink_send_window_stats(&test_link, &stats);
+    assert_int_equal(2, stats.in_flight);
+    assert_int_equal(200, stats.in_flight_bytes);
+    assert_int_equal(1, stats.stalls);
+    assert_int_equal(9, stats.conflated);
+    assert_int_equal(2, stats.pending_updates);
+    assert_int_equal(1, stats.held);
+
+    // acks are cumulative
+    dslink_send_window_ack(&test_link, 2);
+    dslink_send_window_stats(&test_link, &stats);
+    assert_int_equal(0, stats.in_flight);
+    assert_int_equal(0, stats.in_flight_bytes);
+    assert_int_equal(2, stats.max_in_flight);
+
+    // still held, as long as nothing is sent the order has to be kept
+    msg = updates_msg(3, 0);
+    assert_int_equal(1, dslink_send_window_hold(&test_link, msg));
+    json_decref(msg);
+}
+
+static
+void send_window_wrap_test(void **state) {
+    (void) state;
+
+    DSLinkSendWindowStats stats;
+    dslink_send_window_sent(&test_link, INT32_MAX - 1, 10);
+    dslink_send_window_sent(&test_link, INT32_MAX, 10);
+    dslink_send_window_ack(&test_link, 5);
+    dslink_send_window_stats(&test_link, &stats);
+    assert_int_equal(0, stats.in_flight);
+
+    dslink_send_window_sent(&test_link, INT32_MAX, 10);
+    dslink_send_window_sent(&test_link, 1, 10);
+    dslink_send_window_ack(&test_link, INT32_MAX);
+    dslink_send_window_stats(&test_link, &stats);
+    assert_int_equal(1, stats.in_flight);
+    dslink_send_window_ack(&test_link, INT32_MAX - 10);
+    dslink_send_window_stats(&test_link, &stats);
+    assert_int_equal(1, stats.in_flight);
+}
+
+static
+void send_window_grow_test(void **state) {
+    (void) state;
+
+    DSLinkSendWindowStats stats;
+    for (uint32_t i = 1; i <= 100; ++i) {
+        dslink_send_window_sent(&test_link, i, 1);
+    }
+    dslink_send_window_ack(&test_link, 60);
+    dslink_send_window_stats(&test_link, &stats);
+    assert_int_equal(40, stats.in_flight);
+    assert_int_equal(40, stats.in_flight_bytes);
+    assert_int_equal(100, stats.max_in_flight);
+}
+
+// A link whose messages are queued in a web socket which is never written,
+// so the window tracks what a flush sends.
+static uint32_t test_msg;
+
+static
+void connected_link_init(DSLink *link) {
+    memset(link, 0, sizeof(DSLink));
+    test_msg = 0;
+    link->msg = &test_msg;
+    uv_loop_init(&link->loop);
+    struct wslay_event_callbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+    wslay_event_context_client_init(&link->_ws, &callbacks, link);
+}
+
+static
+void connected_link_free(DSLink *link) {
+    dslink_send_window_free(link);
+    wslay_event_context_free(link->_ws);
+    uv_loop_close(&link->loop);
+}
+
+static
+void hold_responses(DSLink *link, int count) {
+    char value[101];
+    memset(value, 'x', sizeof(value) - 1);
+    value[sizeof(value) - 1] = '\0';
+    for (int i = 1; i <= count; ++i) {
+        json_t *msg = json_pack("{s:[{s:i,s:s,s:[[s]]}]}", "responses",
+                                "rid", i, "stream", "open", "updates", value);
+        assert_int_equal(1, dslink_send_window_hold(link, msg));
+        json_decref(msg);
+    }
+}
+
+static
+void send_window_chunk_test(void **state) {
+    (void) state;
+
+    DSLink link;
+    DSLinkSendWindowStats stats;
+    connected_link_init(&link);
+    link.config.send_window_bytes = 1000;
+    assert_int_equal(0, dslink_send_window_init(&link));
+
+    test_msg = 1;
+    dslink_send_window_sent(&link, test_msg, 1000);
+    hold_responses(&link, 50);
+    for (uint32_t sid = 1; sid <= 3; ++sid) {
+        json_t *msg = updates_msg(sid, 1);
+        assert_int_equal(1, dslink_send_window_hold(&link, msg));
+        json_decref(msg);
+    }
+    dslink_send_window_stats(&link, &stats);
+    assert_int_equal(50, stats.held);
+    assert_true(stats.held_bytes > 5000);
+    assert_int_equal(3, stats.pending_updates);
+
+    // every ack sends what fits in the window, in messages of about the
+    // size of the window
+    int acks = 0;
+    while (stats.held > 0 || stats.pending_updates > 0) {
+        size_t held = stats.held + stats.pending_updates;
+        dslink_send_window_ack(&link, test_msg);
+        dslink_send_window_stats(&link, &stats);
+        assert_true(stats.held + stats.pending_updates < held);
+        assert_true(stats.in_flight >= 1);
+        assert_true(stats.in_flight_bytes <= stats.in_flight * (1000 + 64));
+        assert_true(++acks < 10);
+    }
+    assert_true(acks > 1);
+    assert_int_equal(0, stats.held_bytes);
+    assert_int_equal(0, stats.overflows);
+
+    connected_link_free(&link);
+}
+
+static
+void send_window_held_limit_test(void **state) {
+    (void) state;
+
+    DSLink link;
+    DSLinkSendWindowStats stats;
+    connected_link_init(&link);
+    link.config.send_window = 1;
+    link.config.send_window_held_bytes = 2000;
+    assert_int_equal(0, dslink_send_window_init(&link));
+
+    test_msg = 1;
+    dslink_send_window_sent(&link, test_msg, 100);
+    hold_responses(&link, 50);
+    dslink_send_window_stats(&link, &stats);
+    assert_true(stats.held > 0);
+    assert_true(stats.held_bytes <= 2000);
+    assert_true(stats.overflows > 0);
+    assert_int_equal(stats.overflows + 1, stats.in_flight);
+
+    connected_link_free(&link);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(send_window_disabled_test),
+        cmocka_unit_test_setup_teardown(send_window_conflate_test,
+                                        send_window_setup, send_window_teardown),
+        cmocka_unit_test_setup_teardown(send_window_wrap_test,
+                                        send_window_setup, send_window_teardown),
+        cmocka_unit_test_setup_teardown(send_window_grow_test,
+                                        send_window_setup, send_window_teardown),
+        cmocka_unit_test(send_window_chunk_test),
+        cmocka_unit_test(send_window_held_limit_test)
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,129 @@
+/*
+ * Time until a requester has the initial values of a large subscribe
+ * request, sending one message per path versus the batched updates of
+ * dslink_response_sub. The broker side is simulated on a socket pair.
+ */
+
+#define LOG_TAG "sub_batch_bench"
+
+#include <dslink/log.h>
+#include <dslink/dslink.h>
+#include <dslink/ws.h>
+#include <dslink/msg/sub_response.h>
+#include <dslink/mem/mem.h>
+#include <stdio.h>
+#include <string.h>
+#include "responder_fixture.h"
+#include "fake_broker.h"
+
+#define BENCH_NODES 50000
+
+typedef struct {
+    FakeBroker base;
+    uint64_t start;
+    uint64_t values;
+} BenchBroker;
+
+static BenchBroker broker;
+static Responder bench_responder;
+static DSNode *bench_nodes[BENCH_NODES];
+static json_t *bench_paths;
+static int bench_batched;
+
+static
+void bench_init_responder(DSLink *link) {
+    test_responder_init(link, &bench_responder);
+    bench_paths = json_array();
+    for (int i = 0; i < BENCH_NODES; ++i) {
+        char name[16];
+        snprintf(name, sizeof(name), "node%d", i);
+        bench_nodes[i] = dslink_node_create(bench_responder.super_root, name, "node");
+        dslink_node_add_child(link, bench_nodes[i]);
+        dslink_node_update_value_new(link, bench_nodes[i], json_real(i * 0.5));
+        json_array_append_new(bench_paths, json_pack("{s:s,s:i}", "path",
+                                                     bench_nodes[i]->path,
+                                                     "sid", i + 1));
+    }
+}
+
+static
+void bench_free_responder(DSLink *link) {
+    test_responder_free(link);
+    json_decref(bench_paths);
+    link->responder = NULL;
+}
+
+static
+void broker_count_values(FakeBroker *base, const char *payload, size_t len) {
+    (void) base;
+    json_t *obj = json_loadb(payload, len, 0, NULL);
+    size_t index;
+    json_t *resp;
+    json_array_foreach(json_object_get(obj, "responses"), index, resp) {
+        broker.values += json_array_size(json_object_get(resp, "updates"));
+    }
+    json_decref(obj);
+}
+
+static
+void broker_tick(uv_timer_t *timer) {
+    DSLink *link = timer->data;
+    fake_broker_read_frames(&broker.base);
+    if (broker.values >= BENCH_NODES) {
+        fake_broker_stop(&broker.base, link);
+    }
+}
+
+static
+void bench_ready(DSLink *link) {
+    fake_broker_start(&broker.base, link, broker_tick);
+
+    broker.start = uv_hrtime();
+    if (bench_batched) {
+        json_t *rid = json_integer(1);
+        dslink_response_sub(link, bench_paths, rid);
+        json_decref(rid);
+    } else {
+        for (int i = 0; i < BENCH_NODES; ++i) {
+            dslink_response_send_val(link, bench_nodes[i], (uint32_t) i + 1);
+        }
+    }
+}
+
+static
+void bench_run(const char *name, int batched) {
+    memset(&broker, 0, sizeof(BenchBroker));
+    broker.base.on_frame = broker_count_values;
+    bench_batched = batched;
+
+    DSLink link;
+    uint32_t msg = 0;
+    memset(&link, 0, sizeof(DSLink));
+    if (fake_broker_connect(&broker.base, &link) != 0) {
+        return;
+    }
+    uv_loop_init(&link.loop);
+    link.loop.data = &link;
+    link.msg = &msg;
+    bench_init_responder(&link);
+
+    dslink_handshake_handle_ws(&link, bench_ready);
+    uint64_t elapsed = uv_hrtime() - broker.start;
+
+    bench_free_responder(&link);
+    uv_run(&link.loop, UV_RUN_NOWAIT);
+    uv_loop_close(&link.loop);
+    fake_broker_close(&broker.base, &link);
+
+    printf("%-22s %8llu values %8llu frames %10llu bytes %8.1f ms\n",
+           name, (unsigned long long) broker.values,
+           (unsigned long long) broker.base.frames,
+           (unsigned long long) broker.base.bytes,
+           elapsed / 1000000.0);
+}
+
+int main() {
+    bench_run("one message per path", 0);
+    bench_run("batched updates", 1);
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <string.h>
+
+#include <wslay/wslay.h>
+
+#include <dslink/ws.h>
+#include <dslink/msg/sub_response.h>
+#include "cmocka_init.h"
+#include "responder_fixture.h"
+#include "fake_broker.h"
+
+// The initial values of a subscribe request are split into messages by
+// their size, the broker side counts the messages carrying values.
+#define TEST_NODES 8
+#define TEST_VALUE_SIZE (10 * 1024)
+
+static FakeBroker broker;
+static uint64_t broker_messages;
+static uint64_t broker_values;
+
+static Responder test_responder;
+static json_t *test_paths;
+static int test_sent;
+
+static
+void test_on_frame(FakeBroker *b, const char *payload, size_t len) {
+    (void) b;
+    json_t *obj = json_loadb(payload, len, 0, NULL);
+    size_t index;
+    json_t *resp;
+    size_t values = 0;
+    json_array_foreach(json_object_get(obj, "responses"), index, resp) {
+        values += json_array_size(json_object_get(resp, "updates"));
+    }
+    if (values > 0) {
+        broker_messages++;
+        broker_values += values;
+    }
+    json_decref(obj);
+}
+
+static
+void test_broker_tick(uv_timer_t *timer) {
+    DSLink *link = timer->data;
+    fake_broker_read_frames(&broker);
+    if (test_sent && !wslay_event_want_write(link->_ws)) {
+        fake_broker_read_frames(&broker);
+        fake_broker_stop(&broker, link);
+    }
+}
+
+static
+void test_ready(DSLink *link) {
+    fake_broker_start(&broker, link, test_broker_tick);
+
+    json_t *rid = json_integer(1);
+    assert_int_equal(0, dslink_response_sub(link, test_paths, rid));
+    json_decref(rid);
+    test_sent = 1;
+}
+
+static
+void sub_batch_large_values_test(void **state) {
+    (void) state;
+
+    DSLink link;
+    uint32_t msg = 0;
+    memset(&link, 0, sizeof(DSLink));
+    memset(&broker, 0, sizeof(FakeBroker));
+    broker.on_frame = test_on_frame;
+    broker_messages = 0;
+    broker_values = 0;
+    test_sent = 0;
+
+    uv_loop_init(&link.loop);
+    link.loop.data = &link;
+    link.msg = &msg;
+    assert_int_equal(0, fake_broker_connect(&broker, &link));
+    assert_int_equal(0, test_responder_init(&link, &test_responder));
+
+    char data[TEST_VALUE_SIZE];
+    memset(data, 'x', sizeof(data) - 1);
+    data[sizeof(data) - 1] = '\0';
+    test_paths = json_array();
+    for (int i = 0; i < TEST_NODES; ++i) {
+        char name[16];
+        snprintf(name, sizeof(name), "node%d", i);
+        DSNode *node = dslink_node_create(test_responder.super_root, name, "node");
+        assert_int_equal(0, dslink_node_add_child(&link, node));
+        dslink_node_update_value_new(&link, node, json_pack("{s:s}", "data", data));
+        json_array_append_new(test_paths, json_pack("{s:s,s:i}", "path", node->path,
+                                                    "sid", i + 1));
+    }
+
+    dslink_handshake_handle_ws(&link, test_ready);
+
+    // far over the size of a single message
+    assert_int_equal(TEST_NODES, broker_values);
+    assert_true(broker_messages > 1);
+
+    json_decref(test_paths);
+    test_responder_free(&link);
+    uv_run(&link.loop, UV_RUN_NOWAIT);
+    uv_loop_close(&link.loop);
+    fake_broker_close(&broker, &link);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(sub_batch_large_values_test)
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,122 @@
+/*
+ * Throughput benchmark of the thread-safe API.
+ * Producer threads push dslink_node_update_value_safe calls into a link
+ * whose loop runs on the main thread, and the updates/s are printed for
+ * an increasing number of producers. No broker connection is needed.
+ */
+
+#define LOG_TAG "thread_safe_api_bench"
+
+#include <dslink/log.h>
+#include <dslink/dslink.h>
+#include <dslink/utils.h>
+#include <dslink/mem/mem.h>
+#include <stdio.h>
+#include <string.h>
+#include "responder_fixture.h"
+
+#define BENCH_NODES 64
+#define BENCH_TOTAL_UPDATES 1000000
+
+typedef struct {
+    DSLink *link;
+    int id;
+    int count;
+} BenchProducer;
+
+static int bench_received;
+static int bench_expected;
+
+static
+void bench_on_data_changed(DSLink *link, DSNode *node) {
+    (void) node;
+    if (++bench_received == bench_expected) {
+        uv_stop(&link->loop);
+    }
+}
+
+static
+void bench_producer(void *arg) {
+    BenchProducer *producer = arg;
+    char path[32];
+    for (int i = 0; i < producer->count; ++i) {
+        snprintf(path, sizeof(path), "/node%d", (producer->id + i) % BENCH_NODES);
+        dslink_node_update_value_safe(producer->link, dslink_strdup(path),
+                                      json_integer(i), NULL, NULL);
+    }
+}
+
+static
+int bench_init_link(DSLink *link, Responder *responder) {
+    memset(link, 0, sizeof(DSLink));
+    uv_loop_init(&link->loop);
+    link->loop.data = link;
+    if (test_responder_init(link, responder) != 0) {
+        return 1;
+    }
+
+    for (int i = 0; i < BENCH_NODES; ++i) {
+        char name[16];
+        snprintf(name, sizeof(name), "node%d", i);
+        DSNode *node = dslink_node_create(responder->super_root, name, "node");
+        node->on_data_changed = bench_on_data_changed;
+        if (dslink_node_add_child(link, node) != 0) {
+            return 1;
+        }
+    }
+
+    return dslink_async_tasks_init(link);
+}
+
+static
+void bench_free_link(DSLink *link) {
+    uv_close((uv_handle_t *) &link->async_tasks, NULL);
+    uv_run(&link->loop, UV_RUN_NOWAIT);
+    dslink_async_tasks_free(link);
+    uv_loop_close(&link->loop);
+
+    test_responder_free(link);
+}
+
+static
+double bench_run(int producers) {
+    DSLink link;
+    Responder responder;
+    if (bench_init_link(&link, &responder) != 0) {
+        log_err("Failed to set up the benchmark link\n");
+        return 0;
+    }
+
+    bench_received = 0;
+    bench_expected = BENCH_TOTAL_UPDATES - BENCH_TOTAL_UPDATES % producers;
+
+    BenchProducer args[producers];
+    uv_thread_t threads[producers];
+
+    uint64_t start = uv_hrtime();
+    for (int i = 0; i < producers; ++i) {
+        args[i].link = &link;
+        args[i].id = i;
+        args[i].count = bench_expected / producers;
+        uv_thread_create(&threads[i], bench_producer, &args[i]);
+    }
+
+    uv_run(&link.loop, UV_RUN_DEFAULT);
+    uint64_t elapsed = uv_hrtime() - start;
+
+    for (int i = 0; i < producers; ++i) {
+        uv_thread_join(&threads[i]);
+    }
+    bench_free_link(&link);
+
+    return bench_received / (elapsed / 1e9);
+}
+
+int main() {
+    int producers[] = { 1, 2, 4, 8, 16 };
+    printf("producers  updates/s\n");
+    for (size_t i = 0; i < sizeof(producers) / sizeof(producers[0]); ++i) {
+        printf("%9d  %9.0f\n", producers[i], bench_run(producers[i]));
+    }
+    return 0;
+}
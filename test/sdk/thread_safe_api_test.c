@@ -7,6 +7,7 @@
  * test steps:
  * 1) get test node value : compares with the init value
  * 2) set test node value
+ * 2b) set test node value again via the batch api
  * 3) run async -> gets the test node value and compares with the set value in step 2
  * If everything was successful, removes the test node.
  */
@@ -23,6 +24,7 @@
 
 void thread_safe_api_test1(void *arg);
 void thread_safe_api_test2(void *arg);
+void thread_safe_api_test2b(void *arg);
 void thread_safe_api_test3(void *arg);
 
 int testRes;
@@ -88,6 +90,39 @@ void thread_safe_api_test3(void *arg) {
     dslink_run_safe((DSLink*)arg,async_run_callback_test3,sTest);
 
 }
+void nodval_async_set_callback_test2b(int res, void* cbData) {
+
+#ifdef PRINT_MODE
+    if(!cbData) {
+        log_warn("callback data error\n");
+        testRes = 0;
+    }
+    if(res) {
+        log_warn("test node batch value set error\n");
+        testRes = 0;
+    }
+#else
+    assert(cbData);
+    assert(!res);
+#endif
+
+    if(testRes) {
+        log_info("Test 2b done\n");
+        thread_safe_api_test3((DSLink *) cbData);
+    }
+}
+
+void thread_safe_api_test2b(void *arg) {
+    char *paths[] = { strdup("test_node") };
+    json_t *values[] = { json_string("Changed_TestNodeVal") };
+    dslink_node_update_values_safe((DSLink*)arg,
+                                   paths,
+                                   values,
+                                   1,
+                                   nodval_async_set_callback_test2b,
+                                   arg);
+}
+
 void nodval_async_set_callback_test2(int res, void* cbData) {
 
 #ifdef PRINT_MODE
@@ -107,14 +142,14 @@ void nodval_async_set_callback_test2(int res, void* cbData) {
 //    dslink_free(cbData);
     if(testRes) {
         log_info("Test 2 done\n");
-        thread_safe_api_test3((DSLink *) cbData);
+        thread_safe_api_test2b((DSLink *) cbData);
     }
 }
 
 void thread_safe_api_test2(void *arg) {
     dslink_node_update_value_safe((DSLink*)arg,
                                   strdup("test_node"),
-                                  json_string("Changed_TestNodeVal"),
+                                  json_string("TestNodeVal_2"),
                                   nodval_async_set_callback_test2,
                                   arg);
 
@@ -0,0 +1,155 @@
+#include <string.h>
+
+#include <dslink/timer_wheel.h>
+#include "cmocka_init.h"
+
+// The loop isn't run, the wheel is driven by dslink_timer_wheel_run.
+static uv_loop_t test_loop;
+static DSLinkTimerWheel test_wheel;
+
+typedef struct {
+    DSLinkTimer timer;
+    int fired;
+    uint64_t fired_at;
+} TestTimer;
+
+static uint64_t test_now;
+
+static
+void test_timer_cb(DSLinkTimer *timer) {
+    TestTimer *t = timer->data;
+    t->fired++;
+    t->fired_at = test_now;
+}
+
+static
+void run_until(uint64_t ms) {
+    for (; test_now <= ms; test_now += 100) {
+        dslink_timer_wheel_run(&test_wheel, test_wheel.start + test_now);
+    }
+}
+
+static
+int timer_wheel_setup(void **state) {
+    (void) state;
+    test_now = 0;
+    uv_loop_init(&test_loop);
+    return dslink_timer_wheel_init(&test_wheel, &test_loop, 100);
+}
+
+static
+int timer_wheel_teardown(void **state) {
+    (void) state;
+    dslink_timer_wheel_close(&test_wheel, NULL);
+    uv_run(&test_loop, UV_RUN_NOWAIT);
+    uv_loop_close(&test_loop);
+    return 0;
+}
+
+static
+void timer_wheel_levels_test(void **state) {
+    (void) state;
+
+    // one timer per level of the wheel
+    uint64_t timeouts[] = { 500, 10000, 700000, 30000000 };
+    TestTimer timers[4];
+    for (int i = 0; i < 4; ++i) {
+        memset(&timers[i], 0, sizeof(TestTimer));
+        dslink_timer_init(&timers[i].timer, test_timer_cb, &timers[i]);
+        dslink_timer_start(&test_wheel, &timers[i].timer, timeouts[i], 0);
+    }
+    assert_int_equal(4, test_wheel.count);
+
+    for (int i = 0; i < 4; ++i) {
+        run_until(timeouts[i] - 100);
+        assert_int_equal(0, timers[i].fired);
+        run_until(timeouts[i]);
+        assert_int_equal(1, timers[i].fired);
+        assert_int_equal(timeouts[i], timers[i].fired_at);
+        assert_false(dslink_timer_is_active(&timers[i].timer));
+    }
+    assert_int_equal(0, test_wheel.count);
+}
+
+static
+void timer_wheel_stop_test(void **state) {
+    (void) state;
+
+    TestTimer a, b, c;
+    memset(&a, 0, sizeof(TestTimer));
+    memset(&b, 0, sizeof(TestTimer));
+    memset(&c, 0, sizeof(TestTimer));
+    dslink_timer_init(&a.timer, test_timer_cb, &a);
+    dslink_timer_init(&b.timer, test_timer_cb, &b);
+    dslink_timer_init(&c.timer, test_timer_cb, &c);
+
+    // same slot
+    dslink_timer_start(&test_wheel, &a.timer, 1000, 0);
+    dslink_timer_start(&test_wheel, &b.timer, 1000, 0);
+    dslink_timer_start(&test_wheel, &c.timer, 1000, 0);
+    dslink_timer_stop(&b.timer);
+    dslink_timer_stop(&b.timer);
+    assert_int_equal(2, test_wheel.count);
+
+    // re-arming moves the timer
+    dslink_timer_start(&test_wheel, &c.timer, 2000, 0);
+    assert_int_equal(2, test_wheel.count);
+
+    run_until(1000);
+    assert_int_equal(1, a.fired);
+    assert_int_equal(0, b.fired);
+    assert_int_equal(0, c.fired);
+    run_until(2000);
+    assert_int_equal(1, c.fired);
+}
+
+static
+void timer_wheel_repeat_test(void **state) {
+    (void) state;
+
+    TestTimer t;
+    memset(&t, 0, sizeof(TestTimer));
+    dslink_timer_init(&t.timer, test_timer_cb, &t);
+    dslink_timer_start(&test_wheel, &t.timer, 300, 1000);
+
+    run_until(5300);
+    assert_int_equal(6, t.fired);
+    assert_int_equal(5300, t.fired_at);
+    assert_true(dslink_timer_is_active(&t.timer));
+
+    dslink_timer_stop(&t.timer);
+    assert_int_equal(0, test_wheel.count);
+}
+
+static
+void timer_wheel_close_test(void **state) {
+    (void) state;
+
+    TestTimer t;
+    memset(&t, 0, sizeof(TestTimer));
+    dslink_timer_init(&t.timer, test_timer_cb, &t);
+    dslink_timer_start(&test_wheel, &t.timer, 300, 0);
+
+    dslink_timer_wheel_close(&test_wheel, NULL);
+    assert_false(dslink_timer_is_active(&t.timer));
+    // stopping a timer of a closed wheel is fine
+    dslink_timer_stop(&t.timer);
+
+    uv_run(&test_loop, UV_RUN_NOWAIT);
+    dslink_timer_wheel_init(&test_wheel, &test_loop, 100);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(timer_wheel_levels_test,
+                                        timer_wheel_setup, timer_wheel_teardown),
+        cmocka_unit_test_setup_teardown(timer_wheel_stop_test,
+                                        timer_wheel_setup, timer_wheel_teardown),
+        cmocka_unit_test_setup_teardown(timer_wheel_repeat_test,
+                                        timer_wheel_setup, timer_wheel_teardown),
+        cmocka_unit_test_setup_teardown(timer_wheel_close_test,
+                                        timer_wheel_setup, timer_wheel_teardown)
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
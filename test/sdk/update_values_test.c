@@ -0,0 +1,133 @@
+#include <string.h>
+
+#include <wslay/wslay.h>
+
+#include <dslink/ws.h>
+#include <dslink/utils.h>
+#include "cmocka_init.h"
+#include "responder_fixture.h"
+#include "fake_broker.h"
+
+// Batch updates of subscribed nodes through dslink_node_update_values_safe,
+// the broker side counts the response messages it receives.
+#define TEST_NODES 3
+
+static FakeBroker broker;
+static uint64_t broker_responses;
+static uint64_t broker_updates;
+
+static Responder test_responder;
+static DSNode *test_nodes[TEST_NODES];
+static int test_done;
+static int test_result;
+
+static
+void test_subscribe(DSLink *link, DSNode *node, uint32_t sid) {
+    ref_t *sidRef = dslink_int_ref(sid);
+    ref_t *pathRef = dslink_str_ref(node->path);
+    dslink_map_set(link->responder->value_path_subs, pathRef, sidRef);
+    dslink_map_set(link->responder->value_sid_subs,
+                   dslink_incref(sidRef), dslink_incref(pathRef));
+}
+
+static
+void test_on_frame(FakeBroker *b, const char *payload, size_t len) {
+    (void) b;
+    json_t *obj = json_loadb(payload, len, 0, NULL);
+    json_t *responses = json_object_get(obj, "responses");
+    if (responses) {
+        broker_responses++;
+        size_t index;
+        json_t *resp;
+        json_array_foreach(responses, index, resp) {
+            broker_updates += json_array_size(json_object_get(resp, "updates"));
+        }
+    }
+    json_decref(obj);
+}
+
+static
+void test_broker_tick(uv_timer_t *timer) {
+    DSLink *link = timer->data;
+    fake_broker_read_frames(&broker);
+    if (test_done && !wslay_event_want_write(link->_ws)) {
+        fake_broker_read_frames(&broker);
+        fake_broker_stop(&broker, link);
+    }
+}
+
+static
+void test_update_done(int result, void *data) {
+    (void) data;
+    test_result = result;
+    test_done = 1;
+}
+
+static
+void test_ready(DSLink *link) {
+    fake_broker_start(&broker, link, test_broker_tick);
+
+    char *paths[TEST_NODES];
+    json_t *values[TEST_NODES];
+    for (int i = 0; i < TEST_NODES; ++i) {
+        paths[i] = dslink_strdup(test_nodes[i]->path);
+        values[i] = json_integer(i + 10);
+    }
+    assert_int_equal(0, dslink_node_update_values_safe(link, paths, values,
+                                                       TEST_NODES,
+                                                       test_update_done, NULL));
+}
+
+static
+void update_values_single_message_test(void **state) {
+    (void) state;
+
+    DSLink link;
+    uint32_t msg = 0;
+    memset(&link, 0, sizeof(DSLink));
+    memset(&broker, 0, sizeof(FakeBroker));
+    broker.on_frame = test_on_frame;
+    broker_responses = 0;
+    broker_updates = 0;
+    test_done = 0;
+    test_result = -1;
+
+    uv_loop_init(&link.loop);
+    link.loop.data = &link;
+    link.msg = &msg;
+    assert_int_equal(0, fake_broker_connect(&broker, &link));
+    assert_int_equal(0, test_responder_init(&link, &test_responder));
+    for (int i = 0; i < TEST_NODES; ++i) {
+        char name[16];
+        snprintf(name, sizeof(name), "node%d", i);
+        test_nodes[i] = dslink_node_create(test_responder.super_root, name, "node");
+        assert_int_equal(0, dslink_node_add_child(&link, test_nodes[i]));
+        test_subscribe(&link, test_nodes[i], (uint32_t) i + 1);
+    }
+    assert_int_equal(0, dslink_async_tasks_init(&link));
+
+    dslink_handshake_handle_ws(&link, test_ready);
+
+    assert_int_equal(0, test_result);
+    for (int i = 0; i < TEST_NODES; ++i) {
+        assert_int_equal(i + 10, json_integer_value(test_nodes[i]->value));
+    }
+    // all values in a single message
+    assert_int_equal(1, broker_responses);
+    assert_int_equal(TEST_NODES, broker_updates);
+
+    uv_close((uv_handle_t *) &link.async_tasks, NULL);
+    uv_run(&link.loop, UV_RUN_NOWAIT);
+    dslink_async_tasks_free(&link);
+    test_responder_free(&link);
+    uv_loop_close(&link.loop);
+    fake_broker_close(&broker, &link);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(update_values_single_message_test)
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
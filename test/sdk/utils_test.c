@@ -1,6 +1,10 @@
 #include "cmocka_init.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <dslink/utils.h>
 #include <dslink/url.h>
+#include <dslink/handshake.h>
 #include <dslink/mem/mem.h>
 
 static
@@ -146,13 +150,93 @@ void checkIpv6Address_test(void** state)
     assert_string_equal("::1", host);
 }
 
+static
+void format_ts_test(void **state) {
+    (void) state;
+
+    setenv("TZ", "UTC", 1);
+    tzset();
+
+    char buf[32];
+    assert_int_equal(DSLINK_TS_LEN, dslink_format_ts(buf, sizeof(buf), 1500000000123LL));
+    assert_string_equal("2017-07-14T02:40:00.123+00:00", buf);
+
+    // same second, only the milliseconds change
+    dslink_format_ts(buf, sizeof(buf), 1500000000007LL);
+    assert_string_equal("2017-07-14T02:40:00.007+00:00", buf);
+
+    dslink_format_ts(buf, sizeof(buf), 1500000001000LL);
+    assert_string_equal("2017-07-14T02:40:01.000+00:00", buf);
+
+    assert_int_equal(0, dslink_format_ts(buf, DSLINK_TS_LEN, 0));
+}
+
+static
+void create_ts_cached_test(void **state) {
+    (void) state;
+
+    char cached[32];
+    char uncached[32];
+    assert_int_equal(DSLINK_TS_LEN, dslink_create_ts_cached(cached, sizeof(cached)));
+    dslink_create_ts(uncached, sizeof(uncached));
+    assert_int_equal(DSLINK_TS_LEN, strlen(cached));
+    // everything up to the seconds matches, unless we crossed a second
+    if (memcmp(cached, uncached, 19) == 0) {
+        assert_string_equal(cached + 23, uncached + 23);
+    }
+    assert_true(cached[10] == 'T' && cached[19] == '.' && cached[26] == ':');
+}
+
+static
+void backoff_delay_test(void **state) {
+    (void) state;
+
+    assert_int_equal(0, dslink_backoff_delay(0, 1000, 60000, 0));
+    assert_int_equal(1000, dslink_backoff_delay(0, 1000, 60000, 1000));
+    assert_int_equal(0, dslink_backoff_delay(0, 1000, 60000, 1001));
+    assert_int_equal(4000, dslink_backoff_delay(2, 1000, 60000, 4000));
+    assert_int_equal(0, dslink_backoff_delay(2, 1000, 60000, 4001));
+
+    // the window is capped
+    assert_int_equal(60000, dslink_backoff_delay(6, 1000, 60000, 60000));
+    assert_int_equal(60000, dslink_backoff_delay(100, 1000, 60000, 60000));
+    assert_int_equal(0, dslink_backoff_delay(100, 1000, 60000, 60001));
+    uint32_t rnd = 1;
+    for (int i = 0; i < 100; ++i, rnd = rnd * 1103515245 + 12345) {
+        assert_true(dslink_backoff_delay(1000, 1000, 60000, rnd) <= 60000);
+    }
+
+    assert_int_equal(0, dslink_backoff_delay(3, 0, 60000, 12345));
+}
+
+static
+void handshake_retry_after_test(void **state) {
+    (void) state;
+
+    assert_int_equal(0, dslink_handshake_retry_after(NULL));
+    assert_int_equal(0, dslink_handshake_retry_after(
+        "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n{}"));
+    assert_int_equal(30000, dslink_handshake_retry_after(
+        "HTTP/1.1 503 Service Unavailable\r\nretry-after: 30\r\n\r\n"));
+    // a date or a value in the body is ignored
+    assert_int_equal(0, dslink_handshake_retry_after(
+        "HTTP/1.1 503 Service Unavailable\r\n"
+        "Retry-After: Fri, 31 Dec 1999 23:59:59 GMT\r\n\r\n"));
+    assert_int_equal(0, dslink_handshake_retry_after(
+        "HTTP/1.1 200 OK\r\n\r\n\r\nRetry-After: 5\r\n"));
+}
+
 int main() {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(utils_str_replace_all_test),
         cmocka_unit_test(url_parse_test),
         cmocka_unit_test(ipv6_test),
         cmocka_unit_test(checkIpv4Address_test),
-        cmocka_unit_test(checkIpv6Address_test)
+        cmocka_unit_test(checkIpv6Address_test),
+        cmocka_unit_test(format_ts_test),
+        cmocka_unit_test(create_ts_cached_test),
+        cmocka_unit_test(backoff_delay_test),
+        cmocka_unit_test(handshake_retry_after_test)
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,159 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <dslink/value_slot.h>
+#include <dslink/mem/mem.h>
+#include "cmocka_init.h"
+
+#define SLOT_TEST_NODES 16
+#define SLOT_TEST_PRODUCERS 4
+#define SLOT_TEST_WRITES 20000
+
+static DSLink test_link;
+static Responder test_responder;
+
+static
+int value_slot_setup(void **state) {
+    (void) state;
+    memset(&test_link, 0, sizeof(DSLink));
+    memset(&test_responder, 0, sizeof(Responder));
+    uv_loop_init(&test_link.loop);
+    test_link.loop.data = &test_link;
+    test_link.responder = &test_responder;
+
+    test_responder.value_path_subs = dslink_calloc(1, sizeof(Map));
+    dslink_map_init(test_responder.value_path_subs, dslink_map_str_cmp,
+                    dslink_map_str_key_len_cal, dslink_map_hash_key);
+    test_responder.super_root = dslink_node_create(NULL, "/", "node");
+    for (int i = 0; i < SLOT_TEST_NODES; ++i) {
+        char name[16];
+        snprintf(name, sizeof(name), "n%d", i);
+        dslink_node_add_child(&test_link, dslink_node_create(test_responder.super_root, name, "node"));
+    }
+    return dslink_async_tasks_init(&test_link);
+}
+
+static
+int value_slot_teardown(void **state) {
+    (void) state;
+    uv_close((uv_handle_t *) &test_link.async_tasks, NULL);
+    uv_run(&test_link.loop, UV_RUN_NOWAIT);
+    dslink_async_tasks_free(&test_link);
+    uv_loop_close(&test_link.loop);
+    return 0;
+}
+
+static
+DSNode *node_at(int i) {
+    char path[16];
+    snprintf(path, sizeof(path), "/n%d", i);
+    return dslink_node_get_path(test_responder.super_root, path);
+}
+
+static
+void value_slot_conflate_test(void **state) {
+    (void) state;
+
+    DSNode *node = node_at(0);
+    DSNodeValueSlot *slot = dslink_node_value_slot_create(&test_link, node);
+    assert_non_null(slot);
+
+    for (int i = 0; i < 100; ++i) {
+        assert_int_equal(dslink_node_value_slot_set_int(slot, i), 0);
+    }
+    assert_ptr_equal(test_link.dirty_value_slots, slot);
+    assert_null(slot->next_dirty);
+
+    dslink_node_value_slots_drain(&test_link);
+    assert_null(test_link.dirty_value_slots);
+    assert_int_equal(json_integer_value(node->value), 99);
+    assert_non_null(node->value_timestamp);
+
+    // nothing changed, nothing published
+    json_t *published = node->value;
+    dslink_node_value_slots_drain(&test_link);
+    assert_ptr_equal(node->value, published);
+
+    dslink_node_value_slot_free(slot);
+}
+
+static
+void value_slot_types_test(void **state) {
+    (void) state;
+
+    DSNodeValueSlot *slots[3];
+    for (int i = 0; i < 3; ++i) {
+        slots[i] = dslink_node_value_slot_create(&test_link, node_at(i));
+    }
+
+    dslink_node_value_slot_set_json(slots[0], json_string("dropped"));
+    dslink_node_value_slot_set_json(slots[0], json_string("latest"));
+    dslink_node_value_slot_set_bool(slots[1], 1);
+    dslink_node_value_slot_set_double(slots[2], 0.5);
+    dslink_node_value_slots_drain(&test_link);
+
+    assert_string_equal(json_string_value(node_at(0)->value), "latest");
+    assert_true(json_is_true(node_at(1)->value));
+    assert_true(json_real_value(node_at(2)->value) == 0.5);
+
+    // freeing a dirty slot is deferred to the drain
+    dslink_node_value_slot_set_int(slots[0], 1);
+    dslink_node_value_slot_free(slots[0]);
+    dslink_node_value_slots_drain(&test_link);
+    assert_string_equal(json_string_value(node_at(0)->value), "latest");
+
+    dslink_node_value_slot_free(slots[1]);
+    dslink_node_value_slot_free(slots[2]);
+}
+
+static DSNodeValueSlot *thread_slots[SLOT_TEST_NODES];
+
+static
+void value_slot_producer(void *arg) {
+    int id = *(int *) arg;
+    for (int i = 1; i <= SLOT_TEST_WRITES; ++i) {
+        int n = (id + i) % SLOT_TEST_NODES;
+        // the last write of every producer to a node is SLOT_TEST_WRITES
+        dslink_node_value_slot_set_int(thread_slots[n], i + SLOT_TEST_NODES > SLOT_TEST_WRITES
+                                                        ? SLOT_TEST_WRITES : i);
+    }
+}
+
+static
+void value_slot_threads_test(void **state) {
+    (void) state;
+
+    for (int i = 0; i < SLOT_TEST_NODES; ++i) {
+        thread_slots[i] = dslink_node_value_slot_create(&test_link, node_at(i));
+    }
+
+    uv_thread_t threads[SLOT_TEST_PRODUCERS];
+    int ids[SLOT_TEST_PRODUCERS];
+    for (int i = 0; i < SLOT_TEST_PRODUCERS; ++i) {
+        ids[i] = i;
+        uv_thread_create(&threads[i], value_slot_producer, &ids[i]);
+    }
+    // drain while the producers are running
+    for (int i = 0; i < 1000; ++i) {
+        dslink_node_value_slots_drain(&test_link);
+    }
+    for (int i = 0; i < SLOT_TEST_PRODUCERS; ++i) {
+        uv_thread_join(&threads[i]);
+    }
+    dslink_node_value_slots_drain(&test_link);
+
+    for (int i = 0; i < SLOT_TEST_NODES; ++i) {
+        assert_int_equal(json_integer_value(node_at(i)->value), SLOT_TEST_WRITES);
+        dslink_node_value_slot_free(thread_slots[i]);
+    }
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(value_slot_conflate_test),
+        cmocka_unit_test(value_slot_types_test),
+        cmocka_unit_test(value_slot_threads_test)
+    };
+
+    return cmocka_run_group_tests(tests, value_slot_setup, value_slot_teardown);
+}
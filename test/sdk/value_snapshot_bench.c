@@ -0,0 +1,152 @@
+/*
+ * Read throughput of node values from worker threads while the loop keeps
+ * updating them. Compares dslink_node_get_value_safe, which round-trips
+ * through the loop and copies the value, with value snapshots.
+ */
+
+#define LOG_TAG "value_snapshot_bench"
+
+#include <dslink/log.h>
+#include <dslink/dslink.h>
+#include <dslink/value_snapshot.h>
+#include <dslink/utils.h>
+#include <dslink/mem/mem.h>
+#include <stdio.h>
+#include <string.h>
+#include "responder_fixture.h"
+
+#define BENCH_NODES 64
+#define BENCH_SECONDS 1
+
+static DSLink bench_link;
+static Responder bench_responder;
+static DSNode *bench_nodes[BENCH_NODES];
+static uint64_t bench_deadline;
+static int bench_readers_running;
+static uint64_t bench_updates;
+
+typedef struct {
+    uint64_t reads;
+    uv_sem_t done;
+} BenchReader;
+
+static
+void bench_init_link() {
+    memset(&bench_link, 0, sizeof(DSLink));
+    uv_loop_init(&bench_link.loop);
+    bench_link.loop.data = &bench_link;
+    test_responder_init(&bench_link, &bench_responder);
+    for (int i = 0; i < BENCH_NODES; ++i) {
+        char name[16];
+        snprintf(name, sizeof(name), "node%d", i);
+        bench_nodes[i] = dslink_node_create(bench_responder.super_root, name, "node");
+        dslink_node_add_child(&bench_link, bench_nodes[i]);
+        dslink_node_update_value_new(&bench_link, bench_nodes[i], json_integer(0));
+        dslink_node_value_snapshot_enable(&bench_link, bench_nodes[i]);
+    }
+    dslink_async_tasks_init(&bench_link);
+}
+
+static
+void bench_update(uv_idle_t *handle) {
+    (void) handle;
+    if (!__atomic_load_n(&bench_readers_running, __ATOMIC_ACQUIRE)) {
+        uv_stop(&bench_link.loop);
+        return;
+    }
+    for (int i = 0; i < BENCH_NODES; ++i) {
+        dslink_node_update_value_new(&bench_link, bench_nodes[i],
+                                     json_integer((json_int_t) bench_updates));
+        ++bench_updates;
+    }
+}
+
+static
+void bench_get_callback(json_t *value, void *data) {
+    BenchReader *reader = data;
+    json_decref(value);
+    uv_sem_post(&reader->done);
+}
+
+static
+void bench_safe_reader(void *arg) {
+    BenchReader *reader = arg;
+    for (int i = 0; uv_hrtime() < bench_deadline; ++i) {
+        char path[32];
+        snprintf(path, sizeof(path), "/node%d", i % BENCH_NODES);
+        dslink_node_get_value_safe(&bench_link, dslink_strdup(path),
+                                   bench_get_callback, reader);
+        uv_sem_wait(&reader->done);
+        ++reader->reads;
+    }
+    __atomic_sub_fetch(&bench_readers_running, 1, __ATOMIC_RELEASE);
+}
+
+static
+void bench_snapshot_reader(void *arg) {
+    BenchReader *reader = arg;
+    json_int_t sum = 0;
+    for (int i = 0; uv_hrtime() < bench_deadline; ++i) {
+        DSNodeValueSnapshot *snapshot =
+            dslink_node_value_snapshot_acquire(bench_nodes[i % BENCH_NODES]);
+        sum += json_integer_value(snapshot->value);
+        dslink_node_value_snapshot_release(snapshot);
+        ++reader->reads;
+    }
+    (void) sum;
+    __atomic_sub_fetch(&bench_readers_running, 1, __ATOMIC_RELEASE);
+}
+
+static
+void bench_run(const char *name, uv_thread_cb reader_cb, int readers) {
+    BenchReader args[readers];
+    uv_thread_t threads[readers];
+    uv_idle_t idle;
+
+    bench_updates = 0;
+    bench_readers_running = readers;
+    bench_deadline = uv_hrtime() + BENCH_SECONDS * 1000000000ULL;
+
+    uv_idle_init(&bench_link.loop, &idle);
+    uv_idle_start(&idle, bench_update);
+    for (int i = 0; i < readers; ++i) {
+        args[i].reads = 0;
+        uv_sem_init(&args[i].done, 0);
+        uv_thread_create(&threads[i], reader_cb, &args[i]);
+    }
+
+    uv_run(&bench_link.loop, UV_RUN_DEFAULT);
+
+    uint64_t reads = 0;
+    for (int i = 0; i < readers; ++i) {
+        uv_thread_join(&threads[i]);
+        uv_sem_destroy(&args[i].done);
+        reads += args[i].reads;
+    }
+    uv_idle_stop(&idle);
+    uv_close((uv_handle_t *) &idle, NULL);
+    uv_run(&bench_link.loop, UV_RUN_NOWAIT);
+
+    printf("%-9s %7d  %10.0f  %10.0f\n", name, readers,
+           (double) reads / BENCH_SECONDS, (double) bench_updates / BENCH_SECONDS);
+}
+
+int main() {
+    bench_init_link();
+
+    int readers[] = { 1, 2, 4, 8, 16 };
+    printf("mode      readers     reads/s   updates/s\n");
+    for (size_t i = 0; i < sizeof(readers) / sizeof(readers[0]); ++i) {
+        bench_run("get_safe", bench_safe_reader, readers[i]);
+    }
+    for (size_t i = 0; i < sizeof(readers) / sizeof(readers[0]); ++i) {
+        bench_run("snapshot", bench_snapshot_reader, readers[i]);
+    }
+
+    uv_close((uv_handle_t *) &bench_link.async_tasks, NULL);
+    uv_run(&bench_link.loop, UV_RUN_NOWAIT);
+    dslink_async_tasks_free(&bench_link);
+    test_responder_free(&bench_link);
+    uv_loop_close(&bench_link.loop);
+    return 0;
+}
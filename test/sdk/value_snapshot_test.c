@@ -0,0 +1,155 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <uv.h>
+#include <dslink/dslink.h>
+#include <dslink/mem/mem.h>
+#include <dslink/value_snapshot.h>
+#include "cmocka_init.h"
+#include "responder_fixture.h"
+
+#define SNAPSHOT_TEST_READERS 4
+#define SNAPSHOT_TEST_UPDATES 100000
+
+static DSLink test_link;
+static Responder test_responder;
+
+static
+int value_snapshot_setup(void **state) {
+    (void) state;
+    memset(&test_link, 0, sizeof(DSLink));
+    return test_responder_init(&test_link, &test_responder);
+}
+
+static
+int value_snapshot_teardown(void **state) {
+    (void) state;
+    test_responder_free(&test_link);
+    return 0;
+}
+
+static
+void value_snapshot_disabled_test(void **state) {
+    (void) state;
+
+    DSNode *node = dslink_node_create(NULL, "/", "node");
+    dslink_node_update_value_new(NULL, node, json_integer(1));
+    assert_null(dslink_node_value_snapshot_acquire(node));
+    dslink_node_tree_free(&test_link, node);
+}
+
+static
+void value_snapshot_publish_test(void **state) {
+    (void) state;
+
+    DSNode *node = dslink_node_create(NULL, "/", "node");
+    assert_int_equal(dslink_node_value_snapshot_enable(&test_link, node), 0);
+    assert_null(dslink_node_value_snapshot_acquire(node));
+
+    dslink_node_update_value_new(NULL, node, json_integer(1));
+    DSNodeValueSnapshot *first = dslink_node_value_snapshot_acquire(node);
+    assert_non_null(first);
+    assert_int_equal(json_integer_value(first->value), 1);
+    assert_ptr_equal(first->ts, node->value_timestamp);
+
+    // the held snapshot stays valid across updates
+    dslink_node_update_value_new(NULL, node, json_integer(2));
+    DSNodeValueSnapshot *second = dslink_node_value_snapshot_acquire(node);
+    assert_int_equal(json_integer_value(second->value), 2);
+    assert_int_equal(json_integer_value(first->value), 1);
+    assert_int_equal(dslink_node_value_snapshots_reclaim(&test_link), 1);
+
+    dslink_node_value_snapshot_release(first);
+    assert_int_equal(dslink_node_value_snapshots_reclaim(&test_link), 0);
+
+    // freeing the node retires its snapshot
+    dslink_node_tree_free(&test_link, node);
+    assert_int_equal(dslink_node_value_snapshots_reclaim(&test_link), 1);
+    dslink_node_value_snapshot_release(second);
+    assert_int_equal(dslink_node_value_snapshots_reclaim(&test_link), 0);
+}
+
+static
+void value_snapshot_responder_test(void **state) {
+    (void) state;
+
+    // readers of another link don't hold back the snapshots of this one
+    DSLink other_link;
+    Responder other_responder;
+    memset(&other_link, 0, sizeof(DSLink));
+    assert_int_equal(test_responder_init(&other_link, &other_responder), 0);
+
+    DSNode *node = dslink_node_create(other_responder.super_root, "node", "node");
+    assert_int_equal(dslink_node_add_child(&other_link, node), 0);
+    assert_int_equal(dslink_node_value_snapshot_enable(&other_link, node), 0);
+    dslink_node_update_value_new(&other_link, node, json_integer(1));
+    DSNodeValueSnapshot *held = dslink_node_value_snapshot_acquire(node);
+    dslink_node_update_value_new(&other_link, node, json_integer(2));
+    assert_int_equal(dslink_node_value_snapshots_reclaim(&other_link), 1);
+    assert_int_equal(dslink_node_value_snapshots_reclaim(&test_link), 0);
+
+    // freeing the responder drains the snapshots still retired
+    dslink_node_value_snapshot_release(held);
+    test_responder_free(&other_link);
+    assert_null(other_responder.snapshots);
+}
+
+static DSNode *thread_node;
+static int thread_done;
+
+static
+void value_snapshot_reader(void *arg) {
+    int *failures = arg;
+    json_int_t last = 0;
+    while (!__atomic_load_n(&thread_done, __ATOMIC_ACQUIRE)) {
+        DSNodeValueSnapshot *snapshot = dslink_node_value_snapshot_acquire(thread_node);
+        if (!snapshot) {
+            continue;
+        }
+        json_int_t value = json_integer_value(snapshot->value);
+        if (value < last || !json_string_value(snapshot->ts)) {
+            ++*failures;
+        }
+        last = value;
+        dslink_node_value_snapshot_release(snapshot);
+    }
+}
+
+static
+void value_snapshot_threads_test(void **state) {
+    (void) state;
+
+    thread_node = dslink_node_create(NULL, "/", "node");
+    dslink_node_value_snapshot_enable(&test_link, thread_node);
+    thread_done = 0;
+
+    uv_thread_t threads[SNAPSHOT_TEST_READERS];
+    int failures[SNAPSHOT_TEST_READERS] = { 0 };
+    for (int i = 0; i < SNAPSHOT_TEST_READERS; ++i) {
+        uv_thread_create(&threads[i], value_snapshot_reader, &failures[i]);
+    }
+
+    for (int i = 1; i <= SNAPSHOT_TEST_UPDATES; ++i) {
+        dslink_node_update_value_new(NULL, thread_node, json_integer(i));
+    }
+    __atomic_store_n(&thread_done, 1, __ATOMIC_RELEASE);
+
+    for (int i = 0; i < SNAPSHOT_TEST_READERS; ++i) {
+        uv_thread_join(&threads[i]);
+        assert_int_equal(failures[i], 0);
+    }
+
+    dslink_node_tree_free(&test_link, thread_node);
+    assert_int_equal(dslink_node_value_snapshots_reclaim(&test_link), 0);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(value_snapshot_disabled_test),
+        cmocka_unit_test(value_snapshot_publish_test),
+        cmocka_unit_test(value_snapshot_responder_test),
+        cmocka_unit_test(value_snapshot_threads_test)
+    };
+
+    return cmocka_run_group_tests(tests, value_snapshot_setup, value_snapshot_teardown);
+}
@@ -0,0 +1,194 @@
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <wslay/wslay.h>
+
+#include <dslink/writable.h>
+#include <dslink/ws.h>
+#include <dslink/socket.h>
+#include <dslink/socket_private.h>
+#include <dslink/mem/mem.h>
+#include "cmocka_init.h"
+
+// An invoke stream producing rows as fast as the writable callbacks allow,
+// the broker side reads slowly from a socket pair.
+#define TEST_ROWS 4000
+#define TEST_ROW_SIZE 1000
+#define TEST_STREAM_HIGH (64 * 1024)
+#define TEST_STREAM_LOW (16 * 1024)
+#define TEST_LINK_HIGH (256 * 1024)
+
+typedef struct {
+    int fd;
+    uv_timer_t timer;
+    uint64_t received;
+
+    Stream stream;
+    json_t *row;
+    int sent_rows;
+    int stream_pauses;
+    int link_pauses;
+    size_t max_stream_queued;
+    size_t max_link_queued;
+} WritableTest;
+
+static WritableTest test;
+
+static
+void test_produce(DSLink *link) {
+    while (test.sent_rows < TEST_ROWS && dslink_stream_is_writable(&test.stream)) {
+        json_t *resp = json_pack("{s:s,s:[[O]]}", "stream", "open", "updates", test.row);
+        assert_int_equal(0, dslink_stream_send(link, &test.stream, resp));
+        json_decref(resp);
+        test.sent_rows++;
+
+        size_t queued = dslink_stream_queued_bytes(&test.stream);
+        if (queued > test.max_stream_queued) {
+            test.max_stream_queued = queued;
+        }
+        if (dslink_queued_bytes(link) > test.max_link_queued) {
+            test.max_link_queued = dslink_queued_bytes(link);
+        }
+    }
+}
+
+static
+void test_stream_writable(DSLink *link, Stream *stream, uint8_t writable) {
+    assert_ptr_equal(&test.stream, stream);
+    if (writable) {
+        test_produce(link);
+    } else {
+        test.stream_pauses++;
+    }
+}
+
+static
+void test_link_writable(DSLink *link, uint8_t writable) {
+    (void) link;
+    if (!writable) {
+        test.link_pauses++;
+    }
+}
+
+static
+void test_broker_read(uv_timer_t *timer) {
+    DSLink *link = timer->data;
+    char buf[16 * 1024];
+    ssize_t r = read(test.fd, buf, sizeof(buf));
+    if (r > 0) {
+        test.received += (uint64_t) r;
+    }
+
+    if (test.sent_rows == TEST_ROWS && dslink_queued_bytes(link) == 0
+        && !wslay_event_want_write(link->_ws)) {
+        while (read(test.fd, buf, sizeof(buf)) > 0);
+        uv_timer_stop(timer);
+        uv_close((uv_handle_t *) timer, NULL);
+        uv_stop(&link->loop);
+    }
+}
+
+static
+void test_ready(DSLink *link) {
+    uv_timer_init(&link->loop, &test.timer);
+    test.timer.data = link;
+    uv_timer_start(&test.timer, test_broker_read, 1, 1);
+
+    assert_int_equal(0, dslink_set_writable_cb(link, TEST_LINK_HIGH,
+                                               TEST_LINK_HIGH / 4,
+                                               test_link_writable));
+    assert_int_equal(0, dslink_stream_set_writable_cb(link, &test.stream,
+                                                      TEST_STREAM_HIGH,
+                                                      TEST_STREAM_LOW,
+                                                      test_stream_writable));
+    test_produce(link);
+}
+
+static
+void writable_stream_test(void **state) {
+    (void) state;
+    int sv[2];
+    assert_int_equal(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+    fcntl(sv[1], F_SETFL, fcntl(sv[1], F_GETFL) | O_NONBLOCK);
+
+    memset(&test, 0, sizeof(WritableTest));
+    test.fd = sv[1];
+    test.stream.type = INVOCATION_STREAM;
+    test.stream.rid = 5;
+    char row[TEST_ROW_SIZE];
+    memset(row, 'x', sizeof(row) - 1);
+    row[sizeof(row) - 1] = '\0';
+    test.row = json_string(row);
+
+    DSLink link;
+    uint32_t msg = 0;
+    memset(&link, 0, sizeof(DSLink));
+    uv_loop_init(&link.loop);
+    link.loop.data = &link;
+    link.msg = &msg;
+    link._socket = dslink_socket_init(0);
+    link._socket->socket_ctx.fd = sv[0];
+
+    dslink_handshake_handle_ws(&link, test_ready);
+
+    dslink_stream_writable_free(&test.stream);
+    dslink_writable_free(&link);
+    uv_run(&link.loop, UV_RUN_NOWAIT);
+    uv_loop_close(&link.loop);
+    dslink_free(link._socket);
+    close(sv[0]);
+    close(sv[1]);
+    json_decref(test.row);
+
+    assert_int_equal(TEST_ROWS, test.sent_rows);
+    assert_true(test.received > (uint64_t) TEST_ROWS * TEST_ROW_SIZE);
+    assert_true(test.stream_pauses > 0);
+    // bounded by the watermark, not by the size of the result
+    assert_true(test.max_stream_queued < TEST_STREAM_HIGH + 2 * TEST_ROW_SIZE);
+    assert_true(test.max_link_queued < TEST_LINK_HIGH);
+    assert_int_equal(0, test.link_pauses);
+}
+
+static int test_link_resumes;
+
+static
+void test_link_resume(DSLink *link, uint8_t writable) {
+    (void) link;
+    if (writable) {
+        test_link_resumes++;
+    }
+}
+
+static
+void writable_reconnect_test(void **state) {
+    (void) state;
+    DSLink link;
+    memset(&link, 0, sizeof(DSLink));
+    test_link_resumes = 0;
+    assert_int_equal(0, dslink_set_writable_cb(&link, 100, 10, test_link_resume));
+
+    // disconnected while the producer was paused
+    link.writable->unwritable = 1;
+    link.queued_total = 1000;
+    dslink_link_clear(&link);
+    assert_non_null(link.writable);
+    assert_false(dslink_is_writable(&link));
+
+    // resumed by the next connection, the callback was kept
+    dslink_writable_update(&link);
+    assert_int_equal(1, test_link_resumes);
+    assert_true(dslink_is_writable(&link));
+
+    dslink_writable_free(&link);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(writable_stream_test),
+        cmocka_unit_test(writable_reconnect_test)
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}